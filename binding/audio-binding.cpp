@@ -20,6 +20,7 @@
 */
 
 #include "audio.h"
+#include "soundemitter.h"
 #include "sharedstate.h"
 #include "binding-util.h"
 #include "exception.h"
@@ -162,6 +163,48 @@ DEF_FADE( me )
 
 DEF_PLAY_STOP( se )
 
+/* Takes any number of file names, or arrays of them */
+RB_METHOD(audioSePreload)
+{
+	RB_UNUSED_PARAM;
+
+	VALUE names = rb_ary_new4(argc, argv);
+	names = rb_funcall(names, rb_intern("flatten"), 0);
+
+	for (long i = 0; i < RARRAY_LEN(names); ++i)
+	{
+		VALUE name = rb_ary_entry(names, i);
+		shState->audio().sePreload(StringValueCStr(name));
+	}
+
+	return Qnil;
+}
+
+RB_METHOD(audioSeCacheStats)
+{
+	RB_UNUSED_PARAM;
+
+	SoundCacheStats stats = shState->audio().seCacheStats();
+
+	VALUE hash = rb_hash_new();
+	rb_hash_aset(hash, ID2SYM(rb_intern("hits")), UINT2NUM(stats.hits));
+	rb_hash_aset(hash, ID2SYM(rb_intern("misses")), UINT2NUM(stats.misses));
+	rb_hash_aset(hash, ID2SYM(rb_intern("entries")), UINT2NUM(stats.entries));
+	rb_hash_aset(hash, ID2SYM(rb_intern("bytes")), UINT2NUM(stats.bytes));
+	rb_hash_aset(hash, ID2SYM(rb_intern("limit")), UINT2NUM(stats.limit));
+
+	return hash;
+}
+
+RB_METHOD(audioSeResetCacheStats)
+{
+	RB_UNUSED_PARAM;
+
+	shState->audio().seResetCacheStats();
+
+	return Qnil;
+}
+
 RB_METHOD(audioSetupMidi)
 {
 	RB_UNUSED_PARAM;
@@ -213,6 +256,9 @@ audioBindingInit()
 	_rb_define_module_function(module, "setup_midi", audioSetupMidi);
 
 	BIND_PLAY_STOP( se )
+	_rb_define_module_function(module, "se_preload", audioSePreload);
+	_rb_define_module_function(module, "se_cache_stats", audioSeCacheStats);
+	_rb_define_module_function(module, "se_reset_cache_stats", audioSeResetCacheStats);
 
 	_rb_define_module_function(module, "__reset__", audioReset);
 }
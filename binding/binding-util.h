@@ -334,7 +334,8 @@ inline VALUE wrapProperty(VALUE self, void *prop, const char *iv,
     return propObj;
 }
 
-/* Implemented: oSszfibn| */
+/* Implemented: oSszfibn|
+ * (see RbArgs below for hot paths) */
 int rb_get_args(int argc, VALUE *argv, const char *format, ...);
 
 /* Always terminate 'rb_get_args' with this */
@@ -375,23 +376,6 @@ GFX_UNLOCK;                                                              \
 }
 
 
-template <class C>
-static inline VALUE objectLoad(int argc, VALUE *argv, VALUE self) {
-    const char *data;
-    int dataLen;
-    rb_get_args(argc, argv, "s", &data, &dataLen RB_ARG_END);
-    
-    VALUE obj = rb_obj_alloc(self);
-    
-    C *c = 0;
-    
-    c = C::deserialize(data, dataLen);
-    
-    setPrivateData(obj, c);
-    
-    return obj;
-}
-
 static inline VALUE rb_bool_new(bool value) { return value ? Qtrue : Qfalse; }
 
 inline void rb_float_arg(VALUE arg, double *out, int argPos = 0) {
@@ -441,6 +425,194 @@ inline void rb_bool_arg(VALUE arg, bool *out, int argPos = 0) {
     }
 }
 
+/* Compile time counterpart of the 'rb_get_args' format
+ * string, eg. RbArgs<'i', 'i', 'o', '|', 'b'>(). Supports
+ * the same specifiers, but the per call parsing is
+ * resolved into straight-line conversions, and output
+ * pointers are type checked (no RB_ARG_END needed) */
+template<char... format>
+struct RbArgs {};
+
+namespace RbArgsImpl {
+
+template<char c>
+struct Spec;
+
+template<>
+struct Spec<'o'> {
+    typedef VALUE type;
+    
+    static void get(VALUE arg, VALUE *out, int) {
+        *out = arg;
+    }
+};
+
+template<>
+struct Spec<'S'> {
+    typedef VALUE type;
+    
+    static void get(VALUE arg, VALUE *out, int argI) {
+        if (!RB_TYPE_P(arg, RUBY_T_STRING))
+            rb_raise(rb_eTypeError, "Argument %d: Expected string", argI);
+        
+        *out = arg;
+    }
+};
+
+template<>
+struct Spec<'z'> {
+    typedef const char *type;
+    
+    static void get(VALUE arg, const char **out, int argI) {
+        if (!RB_TYPE_P(arg, RUBY_T_STRING))
+            rb_raise(rb_eTypeError, "Argument %d: Expected string", argI);
+        
+        *out = RSTRING_PTR(arg);
+    }
+};
+
+template<>
+struct Spec<'f'> {
+    typedef double type;
+    
+    static void get(VALUE arg, double *out, int argI) {
+        rb_float_arg(arg, out, argI);
+    }
+};
+
+template<>
+struct Spec<'i'> {
+    typedef int type;
+    
+    static void get(VALUE arg, int *out, int argI) {
+        rb_int_arg(arg, out, argI);
+    }
+};
+
+template<>
+struct Spec<'b'> {
+    typedef bool type;
+    
+    static void get(VALUE arg, bool *out, int argI) {
+        rb_bool_arg(arg, out, argI);
+    }
+};
+
+template<>
+struct Spec<'n'> {
+    typedef ID type;
+    
+    static void get(VALUE arg, ID *out, int argI) {
+        if (!SYMBOL_P(arg))
+            rb_raise(rb_eTypeError, "Argument %d: Expected symbol", argI);
+        
+        *out = SYM2ID(arg);
+    }
+};
+
+/* Missing arguments are an error until '|' was passed */
+static inline bool present(int argc, int argI, bool opt) {
+    // FIXME print num of needed args vs provided
+    if (argc <= argI && !opt)
+        rb_raise(rb_eArgError, "wrong number of arguments");
+    
+    return argI < argc;
+}
+
+template<bool opt, char... format>
+struct Reader;
+
+template<bool opt>
+struct Reader<opt> {
+    static int read(int argc, VALUE *, int argI) {
+#ifndef NDEBUG
+        // FIXME print num of needed args vs provided
+        if (argc > argI)
+            rb_raise(rb_eArgError, "wrong number of arguments");
+#else
+        (void)argc;
+#endif
+        
+        return argI;
+    }
+};
+
+template<bool opt, char... rest>
+struct Reader<opt, '|', rest...> {
+    template<class... Outs>
+    static int read(int argc, VALUE *argv, int argI, Outs... outs) {
+        return Reader<true, rest...>::read(argc, argv, argI, outs...);
+    }
+};
+
+template<bool opt, char... rest>
+struct Reader<opt, 's', rest...> {
+    template<class... Outs>
+    static int read(int argc, VALUE *argv, int argI,
+                    const char **s, int *len, Outs... outs) {
+        if (!present(argc, argI, opt))
+            return argI;
+        
+        VALUE arg = argv[argI];
+        
+        if (!RB_TYPE_P(arg, RUBY_T_STRING))
+            rb_raise(rb_eTypeError, "Argument %d: Expected string", argI);
+        
+        *s = RSTRING_PTR(arg);
+        *len = RSTRING_LEN(arg);
+        
+        return Reader<opt, rest...>::read(argc, argv, argI + 1, outs...);
+    }
+};
+
+template<bool opt, char c, char... rest>
+struct Reader<opt, c, rest...> {
+    template<class... Outs>
+    static int read(int argc, VALUE *argv, int argI,
+                    typename Spec<c>::type *out, Outs... outs) {
+        if (!present(argc, argI, opt))
+            return argI;
+        
+        Spec<c>::get(argv[argI], out, argI);
+        
+        return Reader<opt, rest...>::read(argc, argv, argI + 1, outs...);
+    }
+};
+
+} // namespace RbArgsImpl
+
+template<char... format, class... Outs>
+inline int rb_get_args(int argc, VALUE *argv, RbArgs<format...>, Outs... outs) {
+    Exception *exc = 0;
+    
+    try {
+        return RbArgsImpl::Reader<false, format...>::read(argc, argv, 0, outs...);
+    } catch (const Exception &e) {
+        exc = new Exception(e);
+    }
+    
+    raiseRbExc(exc);
+    
+    return 0;
+}
+
+template <class C>
+static inline VALUE objectLoad(int argc, VALUE *argv, VALUE self) {
+    const char *data;
+    int dataLen;
+    rb_get_args(argc, argv, RbArgs<'s'>(), &data, &dataLen);
+    
+    VALUE obj = rb_obj_alloc(self);
+    
+    C *c = 0;
+    
+    c = C::deserialize(data, dataLen);
+    
+    setPrivateData(obj, c);
+    
+    return obj;
+}
+
 /* rb_check_argc and rb_error_arity are both
  * consistently called before any C++ objects are allocated,
  * so we can just call rb_raise directly in them */
@@ -28,6 +28,8 @@
 #include "sharedstate.h"
 #include "graphics.h"
 
+#include <limits.h>
+
 #if RAPI_FULL > 187
 DEF_TYPE(Bitmap);
 #else
@@ -137,8 +139,8 @@ RB_METHOD_GUARD(bitmapBlt) {
     Bitmap *src;
     Rect *srcRect;
     
-    rb_get_args(argc, argv, "iioo|i", &x, &y, &srcObj, &srcRectObj,
-                &opacity RB_ARG_END);
+    rb_get_args(argc, argv, RbArgs<'i', 'i', 'o', 'o', '|', 'i'>(),
+                &x, &y, &srcObj, &srcRectObj, &opacity);
     
     src = getPrivateDataCheck<Bitmap>(srcObj, BitmapType);
     if (src) {
@@ -162,8 +164,8 @@ RB_METHOD_GUARD(bitmapStretchBlt) {
     Bitmap *src;
     Rect *destRect, *srcRect;
     
-    rb_get_args(argc, argv, "ooo|i", &destRectObj, &srcObj, &srcRectObj,
-                &opacity RB_ARG_END);
+    rb_get_args(argc, argv, RbArgs<'o', 'o', 'o', '|', 'i'>(),
+                &destRectObj, &srcObj, &srcRectObj, &opacity);
     
     src = getPrivateDataCheck<Bitmap>(srcObj, BitmapType);
     if (src) {
@@ -188,7 +190,7 @@ RB_METHOD_GUARD(bitmapFillRect) {
         VALUE rectObj;
         Rect *rect;
         
-        rb_get_args(argc, argv, "oo", &rectObj, &colorObj RB_ARG_END);
+        rb_get_args(argc, argv, RbArgs<'o', 'o'>(), &rectObj, &colorObj);
         
         rect = getPrivateDataCheck<Rect>(rectObj, RectType);
         color = getPrivateDataCheck<Color>(colorObj, ColorType);
@@ -197,8 +199,8 @@ RB_METHOD_GUARD(bitmapFillRect) {
     } else {
         int x, y, width, height;
         
-        rb_get_args(argc, argv, "iiiio", &x, &y, &width, &height,
-                    &colorObj RB_ARG_END);
+        rb_get_args(argc, argv, RbArgs<'i', 'i', 'i', 'i', 'o'>(),
+                    &x, &y, &width, &height, &colorObj);
         
         color = getPrivateDataCheck<Color>(colorObj, ColorType);
         
@@ -225,7 +227,7 @@ RB_METHOD_GUARD(bitmapGetPixel) {
     
     int x, y;
     
-    rb_get_args(argc, argv, "ii", &x, &y RB_ARG_END);
+    rb_get_args(argc, argv, RbArgs<'i', 'i'>(), &x, &y);
     
     Color value;
     if (b->surface() || b->megaSurface())
@@ -239,6 +241,39 @@ RB_METHOD_GUARD(bitmapGetPixel) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD_GUARD(bitmapGetPixels) {
+    Bitmap *b = getPrivateData<Bitmap>(self);
+    
+    IntRect rect;
+    
+    if (argc == 1) {
+        VALUE rectObj;
+        
+        rb_get_args(argc, argv, RbArgs<'o'>(), &rectObj);
+        
+        rect = getPrivateDataCheck<Rect>(rectObj, RectType)->toIntRect();
+    } else {
+        rb_get_args(argc, argv, RbArgs<'i', 'i', 'i', 'i'>(), &rect.x, &rect.y, &rect.w, &rect.h);
+    }
+    
+    if (rect.w < 0 || rect.h < 0)
+        rb_raise(rb_eArgError, "negative rect size");
+    
+    // Computed in 64 bits; Bitmap::getPixels indexes with int,
+    // which also keeps it below the LONG_MAX of rb_str_new
+    int64_t size = (int64_t) rect.w * rect.h * 4;
+    
+    if (size > INT_MAX)
+        rb_raise(rb_eArgError, "rect size too large");
+    
+    VALUE ret = rb_str_new(0, (long) size);
+    
+    GFX_GUARD_EXC(b->getPixels(rect, RSTRING_PTR(ret)););
+    
+    return ret;
+}
+RB_METHOD_GUARD_END
+
 RB_METHOD_GUARD(bitmapSetPixel) {
     Bitmap *b = getPrivateData<Bitmap>(self);
     
@@ -247,7 +282,7 @@ RB_METHOD_GUARD(bitmapSetPixel) {
     
     Color *color;
     
-    rb_get_args(argc, argv, "iio", &x, &y, &colorObj RB_ARG_END);
+    rb_get_args(argc, argv, RbArgs<'i', 'i', 'o'>(), &x, &y, &colorObj);
     
     color = getPrivateDataCheck<Color>(colorObj, ColorType);
     
@@ -382,8 +417,8 @@ RB_METHOD_GUARD(bitmapGradientFillRect) {
         VALUE rectObj;
         Rect *rect;
         
-        rb_get_args(argc, argv, "ooo|b", &rectObj, &color1Obj, &color2Obj,
-                    &vertical RB_ARG_END);
+        rb_get_args(argc, argv, RbArgs<'o', 'o', 'o', '|', 'b'>(),
+                    &rectObj, &color1Obj, &color2Obj, &vertical);
         
         rect = getPrivateDataCheck<Rect>(rectObj, RectType);
         color1 = getPrivateDataCheck<Color>(color1Obj, ColorType);
@@ -394,8 +429,8 @@ RB_METHOD_GUARD(bitmapGradientFillRect) {
     } else {
         int x, y, width, height;
         
-        rb_get_args(argc, argv, "iiiioo|b", &x, &y, &width, &height, &color1Obj,
-                    &color2Obj, &vertical RB_ARG_END);
+        rb_get_args(argc, argv, RbArgs<'i', 'i', 'i', 'i', 'o', 'o', '|', 'b'>(),
+                    &x, &y, &width, &height, &color1Obj, &color2Obj, &vertical);
         
         color1 = getPrivateDataCheck<Color>(color1Obj, ColorType);
         color2 = getPrivateDataCheck<Color>(color2Obj, ColorType);
@@ -415,7 +450,7 @@ RB_METHOD_GUARD(bitmapClearRect) {
         VALUE rectObj;
         Rect *rect;
         
-        rb_get_args(argc, argv, "o", &rectObj RB_ARG_END);
+        rb_get_args(argc, argv, RbArgs<'o'>(), &rectObj);
         
         rect = getPrivateDataCheck<Rect>(rectObj, RectType);
         
@@ -423,7 +458,7 @@ RB_METHOD_GUARD(bitmapClearRect) {
     } else {
         int x, y, width, height;
         
-        rb_get_args(argc, argv, "iiii", &x, &y, &width, &height RB_ARG_END);
+        rb_get_args(argc, argv, RbArgs<'i', 'i', 'i', 'i'>(), &x, &y, &width, &height);
         
         GFX_GUARD_EXC(b->clearRect(x, y, width, height););
     }
@@ -799,6 +834,40 @@ RB_METHOD(bitmapGetMaxSize){
     return INT2NUM(Bitmap::maxSize());
 }
 
+RB_METHOD_GUARD(bitmapPrefetch) {
+    RB_UNUSED_PARAM;
+    
+    VALUE paths;
+    rb_get_args(argc, argv, "o", &paths RB_ARG_END);
+    
+    if (RB_TYPE_P(paths, RUBY_T_ARRAY)) {
+        for (long i = 0; i < RARRAY_LEN(paths); ++i) {
+            VALUE path = rb_ary_entry(paths, i);
+            SafeStringValue(path);
+            
+            Bitmap::prefetch(RSTRING_PTR(path));
+        }
+    }
+    else {
+        SafeStringValue(paths);
+        
+        Bitmap::prefetch(RSTRING_PTR(paths));
+    }
+    
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(bitmapIsPrefetched) {
+    RB_UNUSED_PARAM;
+    
+    char *path;
+    rb_get_args(argc, argv, "z", &path RB_ARG_END);
+    
+    return rb_bool_new(Bitmap::isPrefetched(path));
+}
+RB_METHOD_GUARD_END
+
 RB_METHOD_GUARD(bitmapInitializeCopy) {
     rb_check_argc(argc, 1);
     VALUE origObj = argv[0];
@@ -843,6 +912,7 @@ void bitmapBindingInit() {
     _rb_define_method(klass, "fill_rect", bitmapFillRect);
     _rb_define_method(klass, "clear", bitmapClear);
     _rb_define_method(klass, "get_pixel", bitmapGetPixel);
+    _rb_define_method(klass, "get_pixels", bitmapGetPixels);
     _rb_define_method(klass, "set_pixel", bitmapSetPixel);
     _rb_define_method(klass, "hue_change", bitmapHueChange);
     _rb_define_method(klass, "draw_text", bitmapDrawText);
@@ -859,6 +929,8 @@ void bitmapBindingInit() {
     
     _rb_define_method(klass, "mega?", bitmapGetMega);
     rb_define_singleton_method(klass, "max_size", RUBY_METHOD_FUNC(bitmapGetMaxSize), -1);
+    rb_define_singleton_method(klass, "prefetch", RUBY_METHOD_FUNC(bitmapPrefetch), -1);
+    rb_define_singleton_method(klass, "prefetched?", RUBY_METHOD_FUNC(bitmapIsPrefetched), -1);
     
     _rb_define_method(klass, "animated?", bitmapGetAnimated);
     _rb_define_method(klass, "playing", bitmapGetPlaying);
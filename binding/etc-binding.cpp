@@ -34,7 +34,7 @@ DEF_ALLOCFUNC(Tone);
 DEF_ALLOCFUNC(Rect);
 #endif
 
-#define ATTR_RW(Klass, Attr, arg_type, arg_t_s, value_fun)                     \
+#define ATTR_RW(Klass, Attr, arg_type, arg_spec, value_fun)                    \
   RB_METHOD(Klass##Get##Attr) {                                                \
     RB_UNUSED_PARAM                                                            \
     Klass *p = getPrivateData<Klass>(self);                                    \
@@ -43,14 +43,14 @@ DEF_ALLOCFUNC(Rect);
   RB_METHOD(Klass##Set##Attr) {                                                \
     Klass *p = getPrivateData<Klass>(self);                                    \
     arg_type arg;                                                              \
-    rb_get_args(argc, argv, arg_t_s, &arg RB_ARG_END);                         \
+    rb_get_args(argc, argv, arg_spec(), &arg);                                 \
     p->set##Attr(arg);                                                         \
     return *argv;                                                              \
   }
 
 #define ATTR_DOUBLE_RW(Klass, Attr)                                            \
-  ATTR_RW(Klass, Attr, double, "f", rb_float_new)
-#define ATTR_INT_RW(Klass, Attr) ATTR_RW(Klass, Attr, int, "i", rb_fix_new)
+  ATTR_RW(Klass, Attr, double, RbArgs<'f'>, rb_float_new)
+#define ATTR_INT_RW(Klass, Attr) ATTR_RW(Klass, Attr, int, RbArgs<'i'>, rb_fix_new)
 
 ATTR_DOUBLE_RW(Color, Red)
 ATTR_DOUBLE_RW(Color, Green)
@@ -97,14 +97,14 @@ EQUAL_FUN(Color)
 EQUAL_FUN(Tone)
 EQUAL_FUN(Rect)
 
-#define INIT_FUN(Klass, param_type, param_t_s, last_param_def)                 \
+#define INIT_FUN(Klass, param_type, param_args, last_param_def)                \
   RB_METHOD(Klass##Initialize) {                                               \
     Klass *k;                                                                  \
     if (argc == 0) {                                                           \
       k = new Klass();                                                         \
     } else {                                                                   \
       param_type p1, p2, p3, p4 = last_param_def;                              \
-      rb_get_args(argc, argv, param_t_s, &p1, &p2, &p3, &p4 RB_ARG_END);       \
+      rb_get_args(argc, argv, param_args(), &p1, &p2, &p3, &p4);               \
       k = new Klass(p1, p2, p3, p4);                                           \
     }                                                                          \
     Klass *orig = getPrivateDataNoRaise<Klass>(self);                          \
@@ -117,12 +117,16 @@ EQUAL_FUN(Rect)
     return self;                                                               \
   }
 
-INIT_FUN(Color, double, "fff|f", 255)
-INIT_FUN(Tone, double, "fff|f", 0)
-INIT_FUN(Rect, int, "iiii", 0)
+typedef RbArgs<'f', 'f', 'f', '|', 'f'> ColorArgs;
+typedef RbArgs<'f', 'f', 'f', '|', 'f'> ToneArgs;
+typedef RbArgs<'i', 'i', 'i', 'i'> RectArgs;
+
+INIT_FUN(Color, double, ColorArgs, 255)
+INIT_FUN(Tone, double, ToneArgs, 0)
+INIT_FUN(Rect, int, RectArgs, 0)
 
 #if RAPI_FULL > 187
-#define SET_FUN(Klass, param_type, param_t_s, last_param_def)                  \
+#define SET_FUN(Klass, param_type, param_args, last_param_def)                 \
   RB_METHOD(Klass##Set) {                                                      \
     Klass *k = getPrivateData<Klass>(self);                                    \
     if (argc == 1) {                                                           \
@@ -131,13 +135,13 @@ INIT_FUN(Rect, int, "iiii", 0)
       *k = *other;                                                             \
     } else {                                                                   \
       param_type p1, p2, p3, p4 = last_param_def;                              \
-      rb_get_args(argc, argv, param_t_s, &p1, &p2, &p3, &p4 RB_ARG_END);       \
+      rb_get_args(argc, argv, param_args(), &p1, &p2, &p3, &p4);               \
       k->set(p1, p2, p3, p4);                                                  \
     }                                                                          \
     return self;                                                               \
   }
 #else
-#define SET_FUN(Klass, param_type, param_t_s, last_param_def)                  \
+#define SET_FUN(Klass, param_type, param_args, last_param_def)                 \
   RB_METHOD(Klass##Set) {                                                      \
     Klass *k = getPrivateData<Klass>(self);                                    \
     if (argc == 1) {                                                           \
@@ -146,16 +150,16 @@ INIT_FUN(Rect, int, "iiii", 0)
       *k = *other;                                                             \
     } else {                                                                   \
       param_type p1, p2, p3, p4 = last_param_def;                              \
-      rb_get_args(argc, argv, param_t_s, &p1, &p2, &p3, &p4 RB_ARG_END);       \
+      rb_get_args(argc, argv, param_args(), &p1, &p2, &p3, &p4);               \
       k->set(p1, p2, p3, p4);                                                  \
     }                                                                          \
     return self;                                                               \
   }
 #endif
 
-SET_FUN(Color, double, "fff|f", 255)
-SET_FUN(Tone, double, "fff|f", 0)
-SET_FUN(Rect, int, "iiii", 0)
+SET_FUN(Color, double, ColorArgs, 255)
+SET_FUN(Tone, double, ToneArgs, 0)
+SET_FUN(Rect, int, RectArgs, 0)
 
 RB_METHOD(rectEmpty) {
   RB_UNUSED_PARAM;
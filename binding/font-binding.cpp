@@ -24,6 +24,7 @@
 #include "exception.h"
 #include "font.h"
 #include "sharedstate.h"
+#include "textruncache.h"
 
 #include <string.h>
 
@@ -63,6 +64,32 @@ RB_METHOD(fontDoesExist) {
   return rb_bool_new(Font::doesExist(name));
 }
 
+RB_METHOD(fontCacheStats) {
+  RB_UNUSED_PARAM;
+
+  rb_check_argc(argc, 0);
+
+  TextRunCache::Stats stats = shState->textRunCache().getStats();
+
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, ID2SYM(rb_intern("hits")), ULL2NUM(stats.hits));
+  rb_hash_aset(hash, ID2SYM(rb_intern("misses")), ULL2NUM(stats.misses));
+  rb_hash_aset(hash, ID2SYM(rb_intern("entries")), INT2NUM(stats.entries));
+  rb_hash_aset(hash, ID2SYM(rb_intern("bytes")), UINT2NUM(stats.memSize));
+
+  return hash;
+}
+
+RB_METHOD(fontResetCacheStats) {
+  RB_UNUSED_PARAM;
+
+  rb_check_argc(argc, 0);
+
+  shState->textRunCache().resetStats();
+
+  return Qnil;
+}
+
 RB_METHOD(FontSetName);
 
 RB_METHOD(fontInitialize) {
@@ -290,6 +317,8 @@ void fontBindingInit() {
   }
 
   rb_define_class_method(klass, "exist?", fontDoesExist);
+  rb_define_class_method(klass, "cache_stats", fontCacheStats);
+  rb_define_class_method(klass, "reset_cache_stats", fontResetCacheStats);
 
   _rb_define_method(klass, "initialize", fontInitialize);
   _rb_define_method(klass, "initialize_copy", fontInitializeCopy);
@@ -25,6 +25,10 @@
 #include "binding-util.h"
 #include "binding-types.h"
 #include "exception.h"
+#include "frameprofiler.h"
+#include "scene.h"
+
+#include <ctype.h>
 
 RB_METHOD(graphicsDelta) {
     RB_UNUSED_PARAM;
@@ -186,6 +190,94 @@ RB_METHOD(graphicsHeight)
     return rb_fix_new(shState->graphics().height());
 }
 
+RB_METHOD(graphicsGetFrameProfiler)
+{
+    RB_UNUSED_PARAM;
+    
+    return rb_bool_new(shState->frameProfiler().isEnabled());
+}
+
+RB_METHOD(graphicsSetFrameProfiler)
+{
+    RB_UNUSED_PARAM;
+    
+    bool value;
+    rb_get_args(argc, argv, "b", &value RB_ARG_END);
+    
+    shState->frameProfiler().setEnabled(value);
+    
+    return rb_bool_new(value);
+}
+
+/* Returns the most recent frames as hashes of times in milliseconds */
+RB_METHOD(graphicsFrameStats)
+{
+    RB_UNUSED_PARAM;
+    
+    int count = -1;
+    rb_get_args(argc, argv, "|i", &count RB_ARG_END);
+    
+    std::vector<FrameProfiler::Frame> frames;
+    shState->frameProfiler().getFrames(frames, count < 0 ? (size_t)-1 : (size_t)count);
+    
+    ID sectionIds[FrameProfiler::SectionCount];
+    
+    for (int i = 0; i < FrameProfiler::SectionCount; ++i) {
+        std::string name = FrameProfiler::sectionName((FrameProfiler::Section)i);
+        
+        for (size_t j = 0; j < name.size(); ++j)
+            name[j] = tolower(name[j]);
+        
+        sectionIds[i] = rb_intern(name.c_str());
+    }
+    
+    VALUE ary = rb_ary_new2(frames.size());
+    
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const FrameProfiler::Frame &frame = frames[i];
+        VALUE hash = rb_hash_new();
+        
+        rb_hash_aset(hash, ID2SYM(rb_intern("frame")), ULL2NUM(frame.index));
+        rb_hash_aset(hash, ID2SYM(rb_intern("start")), rb_float_new(frame.start / 1000));
+        rb_hash_aset(hash, ID2SYM(rb_intern("total")), rb_float_new(frame.total / 1000));
+        
+        for (int j = 0; j < FrameProfiler::SectionCount; ++j)
+            rb_hash_aset(hash, ID2SYM(sectionIds[j]), rb_float_new(frame.times[j] / 1000));
+        
+        rb_ary_push(ary, hash);
+    }
+    
+    return ary;
+}
+
+RB_METHOD_GUARD(graphicsDumpFrameTrace)
+{
+    RB_UNUSED_PARAM;
+    
+    const char *filename;
+    rb_get_args(argc, argv, "z", &filename RB_ARG_END);
+    
+    if (!shState->frameProfiler().writeTrace(filename))
+        throw Exception(Exception::IOError, "Failed to write frame trace to %s", filename);
+    
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+/* Returns how many scene elements the last frame drew and culled */
+RB_METHOD(graphicsCullStats)
+{
+    RB_UNUSED_PARAM;
+    
+    const Scene::CullStats &stats = Scene::getCullStats();
+    
+    VALUE hash = rb_hash_new();
+    rb_hash_aset(hash, ID2SYM(rb_intern("drawn")), rb_fix_new(stats.drawn));
+    rb_hash_aset(hash, ID2SYM(rb_intern("culled")), rb_fix_new(stats.culled));
+    
+    return hash;
+}
+
 RB_METHOD(graphicsDisplayWidth)
 {
     RB_UNUSED_PARAM;
@@ -429,6 +521,11 @@ void graphicsBindingInit()
     INIT_GRA_PROP_BIND( FrameRate,  "frame_rate"  );
     INIT_GRA_PROP_BIND( FrameCount, "frame_count" );
     _rb_define_module_function(module, "average_frame_rate", graphicsAverageFrameRate);
+    _rb_define_module_function(module, "frame_profiler", graphicsGetFrameProfiler);
+    _rb_define_module_function(module, "frame_profiler=", graphicsSetFrameProfiler);
+    _rb_define_module_function(module, "frame_stats", graphicsFrameStats);
+    _rb_define_module_function(module, "dump_frame_trace", graphicsDumpFrameTrace);
+    _rb_define_module_function(module, "cull_stats", graphicsCullStats);
 
     _rb_define_module_function(module, "width", graphicsWidth);
     _rb_define_module_function(module, "height", graphicsHeight);
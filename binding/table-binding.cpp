@@ -19,8 +19,10 @@
 ** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "binding-types.h"
 #include "binding-util.h"
 #include "serializable-binding.h"
+#include "etc.h"
 #include "table.h"
 #include <algorithm>
 
@@ -91,40 +93,45 @@ TABLE_SIZE(x, X)
 TABLE_SIZE(y, Y)
 TABLE_SIZE(z, Z)
 
-RB_METHOD_GUARD(tableGetAt) {
+/* Element access is hot (map and passability lookups in
+ * pathfinding loops), so these raise through rb_raise and
+ * skip the exception guard, and read cells directly */
+RB_METHOD(tableGetAt) {
   Table *t = getPrivateData<Table>(self);
 
   int x, y, z;
   x = y = z = 0;
 
-  x = NUM2INT(argv[0]);
-  if (argc > 1)
-    y = NUM2INT(argv[1]);
-  if (argc > 2)
+  switch (argc) {
+  case 3:
     z = NUM2INT(argv[2]);
-
-  if (argc > 3)
-    throw Exception(Exception::ArgumentError, "wrong number of arguments");
+    /* fall through */
+  case 2:
+    y = NUM2INT(argv[1]);
+    /* fall through */
+  case 1:
+    x = NUM2INT(argv[0]);
+    break;
+  default:
+    rb_raise(rb_eArgError, "wrong number of arguments");
+  }
 
   if (x < 0 || x >= t->xSize() || y < 0 || y >= t->ySize() || z < 0 ||
       z >= t->zSize()) {
     return Qnil;
   }
 
-  short result = t->get(x, y, z);
-
-  return INT2FIX(result); /* short always fits in a Fixnum */
+  return INT2FIX(t->at(x, y, z)); /* short always fits in a Fixnum */
 }
-RB_METHOD_GUARD_END
 
-RB_METHOD_GUARD(tableSetAt) {
+RB_METHOD(tableSetAt) {
   Table *t = getPrivateData<Table>(self);
 
   int x, y, z, value;
   x = y = z = 0;
 
   if (argc < 2)
-    throw Exception(Exception::ArgumentError, "wrong number of arguments");
+    rb_raise(rb_eArgError, "wrong number of arguments");
 
   switch (argc) {
   default:
@@ -152,6 +159,63 @@ RB_METHOD_GUARD(tableSetAt) {
 
   return argv[argc - 1];
 }
+
+RB_METHOD_GUARD(tableFill) {
+  Table *t = getPrivateData<Table>(self);
+
+  int value;
+  rb_get_args(argc, argv, RbArgs<'i'>(), &value);
+
+  t->fill(value);
+
+  return self;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(tableCopyRect) {
+  Table *t = getPrivateData<Table>(self);
+
+  int x, y;
+  VALUE srcObj, srcRectObj;
+
+  rb_get_args(argc, argv, RbArgs<'i', 'i', 'o', 'o'>(), &x, &y, &srcObj,
+              &srcRectObj);
+
+  Table *src = getPrivateDataCheck<Table>(srcObj, TableType);
+  Rect *srcRect = getPrivateDataCheck<Rect>(srcRectObj, RectType);
+
+  t->copyRect(*src, srcRect->x, srcRect->y, srcRect->width, srcRect->height,
+              x, y);
+
+  return self;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(tableGetRawData) {
+  RB_UNUSED_PARAM;
+
+  Table *t = getPrivateData<Table>(self);
+  VALUE ret = rb_str_new(0, t->rawSize());
+
+  t->getRaw(RSTRING_PTR(ret));
+
+  return ret;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(tableSetRawData) {
+  RB_UNUSED_PARAM;
+
+  VALUE str;
+  rb_scan_args(argc, argv, "1", &str);
+  SafeStringValue(str);
+
+  Table *t = getPrivateData<Table>(self);
+
+  t->replaceRaw(RSTRING_PTR(str), RSTRING_LEN(str));
+
+  return self;
+}
 RB_METHOD_GUARD_END
 
 MARSH_LOAD_FUN(Table)
@@ -184,4 +248,8 @@ void tableBindingInit() {
   _rb_define_method(klass, "zsize", tableZSize);
   _rb_define_method(klass, "[]", tableGetAt);
   _rb_define_method(klass, "[]=", tableSetAt);
+  _rb_define_method(klass, "fill", tableFill);
+  _rb_define_method(klass, "copy_rect", tableCopyRect);
+  _rb_define_method(klass, "raw_data", tableGetRawData);
+  _rb_define_method(klass, "raw_data=", tableSetRawData);
 }
@@ -1,9 +1,10 @@
 
+uniform sampler2D texture;
 uniform lowp float alpha;
 
-varying lowp vec4 v_color;
+varying vec2 v_texCoord;
 
 void main()
 {
-	gl_FragColor = vec4(v_color.rgb * alpha, 1);
+	gl_FragColor = vec4(texture2D(texture, v_texCoord).rgb * alpha, 1);
 }
@@ -0,0 +1,14 @@
+/* Accumulates glyph coverage into the channel
+ * selected by the vertex color, see GlyphCache */
+
+uniform sampler2D texture;
+
+varying vec2 v_texCoord;
+varying lowp vec4 v_color;
+
+void main()
+{
+	float coverage = texture2D(texture, v_texCoord).a;
+
+	gl_FragColor = vec4(v_color.rgb * coverage, 1.0);
+}
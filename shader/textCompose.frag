@@ -0,0 +1,34 @@
+/* Layers the coverage masks written by glyphMask.frag
+ * the same way Bitmap::drawText composes its SDL_ttf
+ * surfaces: text over its black drop shadow, then the
+ * result over the outline */
+
+uniform sampler2D texture;
+
+uniform lowp vec4 fillColor;
+uniform lowp vec4 outColor;
+uniform lowp float outline;
+
+varying vec2 v_texCoord;
+
+void main()
+{
+	/* r: outline, g: shadow, b: text */
+	vec3 mask = texture2D(texture, v_texCoord).rgb;
+
+	float txtA = mask.b + mask.g * (1.0 - mask.b);
+	vec3 txtRGB = fillColor.rgb;
+
+	if (txtA > 0.0)
+		txtRGB *= mask.b / txtA;
+
+	if (outline > 0.0)
+	{
+		gl_FragColor.rgb = txtRGB * txtA + outColor.rgb * (1.0 - txtA);
+		gl_FragColor.a = txtA + mask.r * (1.0 - txtA);
+	}
+	else
+	{
+		gl_FragColor = vec4(txtRGB, txtA);
+	}
+}
@@ -33,10 +33,10 @@
 
 #ifndef MKXPZ_RETRO
 #  include <SDL_mutex.h>
-#  include <SDL_thread.h>
-#  include <SDL_timer.h>
 #endif // MKXPZ_RETRO
 
+#include <algorithm>
+
 ALStream::ALStream(LoopMode loopMode,
 		           const std::string &threadId)
 	: looped(loopMode == Looped),
@@ -48,10 +48,15 @@ ALStream::ALStream(LoopMode loopMode,
 	  threadTermReq(false),
 	  needsRewind(false),
 #else
-	  thread(0),
+	  streaming(false),
+	  initPending(false),
+	  bufferMs(0),
 #endif // MKXPZ_RETRO
 	  preemptPause(false),
       pitch(1.0f)
+#ifndef MKXPZ_RETRO
+	, streamJob(this)
+#endif // MKXPZ_RETRO
 {
 	alSrc = AL::Source::gen();
 
@@ -64,8 +69,6 @@ ALStream::ALStream(LoopMode loopMode,
 
 #ifndef MKXPZ_RETRO
 	pauseMut = SDL_CreateMutex();
-
-	threadName = std::string("al_stream (") + threadId + ")";
 #endif // MKXPZ_RETRO
 }
 
@@ -318,15 +321,15 @@ void ALStream::stopStream()
 #else
 	threadTermReq.set();
 
-	if (thread)
+	if (streaming)
 	{
-		SDL_WaitThread(thread, 0);
-		thread = 0;
+		shState->audioThread().cancel(&streamJob);
+		streaming = false;
 		needsRewind.set();
 	}
 #endif // MKXPZ_RETRO
 
-	/* Need to stop the source _after_ the thread has terminated,
+	/* Need to stop the source _after_ the job has been cancelled,
 	 * because it might have accidentally started it again before
 	 * seeing the term request */
 	AL::Source::stop(alSrc);
@@ -355,8 +358,9 @@ void ALStream::startStream(double offset)
 #ifdef MKXPZ_RETRO
 	renderInit();
 #else
-	thread = createSDLThread
-		<ALStream, &ALStream::streamData>(this, threadName);
+	initPending = true;
+	streaming = true;
+	shState->audioThread().schedule(&streamJob);
 #endif // MKXPZ_RETRO
 }
 
@@ -423,7 +427,9 @@ void ALStream::renderInit() {
 	bool firstBuffer = true;
 	ALDataSource::Status status;
 
-	if (needsRewind)
+	/* A freshly opened source is at the start already,
+	 * but may still have been asked to begin elsewhere */
+	if (needsRewind || startOffset > 0)
 		source->seekToOffset(startOffset);
 
 	for (int i = 0; i < STREAM_BUFS; ++i)
@@ -549,31 +555,39 @@ void ALStream::render() {
 }
 
 #ifndef MKXPZ_RETRO
-/* thread func */
-void ALStream::streamData()
+/* audio thread job */
+int ALStream::streamData()
 {
 	if (threadTermReq)
-		return;
+		return -1;
 
-	/* Fill up queue */
-	renderInit();
+	if (initPending)
+	{
+		/* Fill up queue */
+		renderInit();
+		initPending = false;
 
-	if (threadTermReq)
-		return;
+		AL::Buffer::ID buf = alBuf[0];
+		ALint bits = AL::Buffer::getBits(buf);
+		ALint chan = AL::Buffer::getChannels(buf);
+		ALint freq = AL::Buffer::getFrequency(buf);
 
-	/* Wait for buffers to be consumed, then
-	 * refill and queue them up again */
-	do
+		if (bits != 0 && chan != 0 && freq != 0)
+			bufferMs = (int64_t) AL::Buffer::getSize(buf) / (bits / 8) / chan * 1000 / freq;
+	}
+	else
 	{
-		shState->rtData().syncPoint.passSecondarySync();
-
+		/* Refill and queue up again
+		 * whatever has been consumed */
 		render();
+	}
 
-		if (threadTermReq)
-			break;
+	if (threadTermReq || sourceExhausted)
+		return -1;
 
-		SDL_Delay(AUDIO_SLEEP);
-	}
-	while (!sourceExhausted);
+	/* There are two more buffers queued behind the playing
+	 * one, so checking a few times per buffer length leaves
+	 * plenty of headroom, even at raised pitch */
+	return std::max(bufferMs / 3, AUDIO_SLEEP);
 }
 #endif // MKXPZ_RETRO
@@ -24,6 +24,7 @@
 
 #include "al-util.h"
 #ifndef MKXPZ_RETRO
+#  include "audiothread.h"
 #  include "sdl-util.h"
 #  include <SDL_rwops.h>
 #endif // MKXPZ_RETRO
@@ -57,9 +58,15 @@ struct ALStream
 	bool threadTermReq;
 	bool needsRewind;
 #else
-	SDL_Thread *thread;
+	/* Set while the stream is scheduled
+	 * on the audio thread */
+	bool streaming;
 
-	std::string threadName;
+	/* Buffers are yet to be queued up */
+	bool initPending;
+
+	/* Playback length of one buffer */
+	int bufferMs;
 
 	SDL_mutex *pauseMut;
 
@@ -135,8 +142,10 @@ private:
 	void checkStopped();
 
 #ifndef MKXPZ_RETRO
-	/* thread func */
-	void streamData();
+	/* audio thread job */
+	int streamData();
+
+	AudioThreadJob<ALStream, &ALStream::streamData> streamJob;
 #endif // MKXPZ_RETRO
 };
 
@@ -32,9 +32,7 @@
 #include <vector>
 
 #ifndef MKXPZ_RETRO
-#  include "sdl-util.h"
-#  include <SDL_thread.h>
-#  include <SDL_timer.h>
+#  include "audiothread.h"
 #endif // MKXPZ_RETRO
 
 struct AudioPrivate
@@ -46,9 +44,6 @@ struct AudioPrivate
 
 	SoundEmitter se;
 
-#ifndef MKXPZ_RETRO
-	SyncPoint &syncPoint;
-#endif // MKXPZ_RETRO
     
     float volumeRatio;
 
@@ -68,10 +63,9 @@ struct AudioPrivate
 #ifndef MKXPZ_RETRO
 	struct
 	{
-		SDL_Thread *thread;
-		AtomicFlag termReq;
 		MeWatchState state;
 	} meWatch;
+
 #endif // MKXPZ_RETRO
 
 #ifdef MKXPZ_RETRO
@@ -83,9 +77,11 @@ struct AudioPrivate
 	      me(ALStream::NotLooped, "me"),
 #ifndef MKXPZ_RETRO
 	      se(rtData.config),
-	      syncPoint(rtData.syncPoint),
 #endif // MKXPZ_RETRO
           volumeRatio(1)
+#ifndef MKXPZ_RETRO
+	    , meWatchJob(this)
+#endif // MKXPZ_RETRO
 	{
 #ifdef MKXPZ_RETRO
         for (int i = 0; i < 16; i++) { // TODO: read BGM track count from config
@@ -98,16 +94,13 @@ struct AudioPrivate
         
 #ifndef MKXPZ_RETRO
 		meWatch.state = MeNotPlaying;
-		meWatch.thread = createSDLThread
-			<AudioPrivate, &AudioPrivate::meWatchFun>(this, "audio_mewatch");
 #endif // MKXPZ_RETRO
 	}
 
 	~AudioPrivate()
 	{
 #ifndef MKXPZ_RETRO
-		meWatch.termReq.set();
-		SDL_WaitThread(meWatch.thread, 0);
+		shState->audioThread().cancel(&meWatchJob);
 #endif // MKXPZ_RETRO
         for (auto track : bgmTracks)
             delete track;
@@ -122,187 +115,190 @@ struct AudioPrivate
     }
 
 #ifndef MKXPZ_RETRO
-	void meWatchFun()
+	/* audio thread job */
+	int meWatchFun()
 	{
 		const float fadeOutStep = 1.f / (200  / AUDIO_SLEEP);
 		const float fadeInStep  = 1.f / (1000 / AUDIO_SLEEP);
 
-		while (true)
+		switch (meWatch.state)
 		{
-			syncPoint.passSecondarySync();
-
-			if (meWatch.termReq)
-				return;
+		case MeNotPlaying:
+		{
+			me.lockStream();
 
-			switch (meWatch.state)
-			{
-			case MeNotPlaying:
+			if (me.stream.queryState() != ALStream::Playing)
 			{
-				me.lockStream();
-
-				if (me.stream.queryState() == ALStream::Playing)
-				{
-					/* ME playing detected. -> FadeOutBGM */
-                    for (auto track : bgmTracks)
-                        track->extPaused = true;
-                    
-					meWatch.state = BgmFadingOut;
-				}
-
+				/* Nothing to watch until the next ME */
 				me.unlockStream();
 
-				break;
+				return -1;
 			}
 
-			case BgmFadingOut :
-			{
-				me.lockStream();
+			/* ME playing detected. -> FadeOutBGM */
+            for (auto track : bgmTracks)
+                track->extPaused = true;
+
+			meWatch.state = BgmFadingOut;
 
-				if (me.stream.queryState() != ALStream::Playing)
-				{
-					/* ME has ended while fading OUT BGM. -> FadeInBGM */
-					me.unlockStream();
-					meWatch.state = BgmFadingIn;
+			me.unlockStream();
 
-					break;
-				}
+			break;
+		}
+
+		case BgmFadingOut :
+		{
+			me.lockStream();
+
+			if (me.stream.queryState() != ALStream::Playing)
+			{
+				/* ME has ended while fading OUT BGM. -> FadeInBGM */
+				me.unlockStream();
+				meWatch.state = BgmFadingIn;
+
+				break;
+			}
+            
+            bool shouldBreak = false;
+            
+            for (int i = 0; i < (int)(bgmTracks.size()); i++) {
+                AudioStream *track = bgmTracks[i];
+                
+                track->lockStream();
                 
-                bool shouldBreak = false;
+                float vol = track->getVolume(AudioStream::External);
+                vol -= fadeOutStep;
                 
-                for (int i = 0; i < (int)(bgmTracks.size()); i++) {
-                    AudioStream *track = bgmTracks[i];
+                if (vol < 0 || track->stream.queryState() != ALStream::Playing) {
+                    /* Either BGM has fully faded out, or stopped midway. -> MePlaying */
+                    track->setVolume(AudioStream::External, 0);
+                    track->stream.pause();
+                    track->unlockStream();
                     
+                    // check to see if there are any tracks still playing,
+                    // and if the last one was ended this round, this branch should exit
+                    std::vector<AudioStream*> playingTracks;
+                    for (auto t : bgmTracks)
+                        if (t->stream.queryState() == ALStream::Playing)
+                            playingTracks.push_back(t);
+                    
+                    
+                    if (playingTracks.size() <= 0 && !shouldBreak) shouldBreak = true;
+                    continue;
+                }
+                
+                track->setVolume(AudioStream::External, vol);
+                track->unlockStream();
+                
+            }
+            if (shouldBreak) {
+                meWatch.state = MePlaying;
+                me.unlockStream();
+                break;
+            }
+            
+			me.unlockStream();
+
+			break;
+		}
+
+		case MePlaying :
+		{
+			me.lockStream();
+
+			if (me.stream.queryState() != ALStream::Playing)
+            {
+                /* ME has ended */
+                for (auto track : bgmTracks) {
                     track->lockStream();
+                    track->extPaused = false;
                     
-                    float vol = track->getVolume(AudioStream::External);
-                    vol -= fadeOutStep;
+                    ALStream::State sState = track->stream.queryState();
                     
-                    if (vol < 0 || track->stream.queryState() != ALStream::Playing) {
-                        /* Either BGM has fully faded out, or stopped midway. -> MePlaying */
-                        track->setVolume(AudioStream::External, 0);
-                        track->stream.pause();
-                        track->unlockStream();
-                        
-                        // check to see if there are any tracks still playing,
-                        // and if the last one was ended this round, this branch should exit
-                        std::vector<AudioStream*> playingTracks;
-                        for (auto t : bgmTracks)
-                            if (t->stream.queryState() == ALStream::Playing)
-                                playingTracks.push_back(t);
+                    if (sState == ALStream::Paused) {
+                        /* BGM is paused. -> FadeInBGM */
+                        track->stream.play();
+                        meWatch.state = BgmFadingIn;
+                    }
+                    else {
+                        /* BGM is stopped. -> MeNotPlaying */
+                        track->setVolume(AudioStream::External, 1.0f);
                         
+                        if (!track->noResumeStop)
+                            track->stream.play();
                         
-                        if (playingTracks.size() <= 0 && !shouldBreak) shouldBreak = true;
-                        continue;
+                        meWatch.state = MeNotPlaying;
                     }
                     
-                    track->setVolume(AudioStream::External, vol);
                     track->unlockStream();
-                    
-                }
-                if (shouldBreak) {
-                    meWatch.state = MePlaying;
-                    me.unlockStream();
-                    break;
                 }
-                
-				me.unlockStream();
-
-				break;
 			}
 
-			case MePlaying :
-			{
-				me.lockStream();
-
-				if (me.stream.queryState() != ALStream::Playing)
-                {
-                    /* ME has ended */
-                    for (auto track : bgmTracks) {
-                        track->lockStream();
-                        track->extPaused = false;
-                        
-                        ALStream::State sState = track->stream.queryState();
-                        
-                        if (sState == ALStream::Paused) {
-                            /* BGM is paused. -> FadeInBGM */
-                            track->stream.play();
-                            meWatch.state = BgmFadingIn;
-                        }
-                        else {
-                            /* BGM is stopped. -> MeNotPlaying */
-                            track->setVolume(AudioStream::External, 1.0f);
-                            
-                            if (!track->noResumeStop)
-                                track->stream.play();
-                            
-                            meWatch.state = MeNotPlaying;
-                        }
-                        
-                        track->unlockStream();
-                    }
-				}
+            me.unlockStream();
 
-                me.unlockStream();
+			break;
+		}
 
-				break;
-			}
+		case BgmFadingIn :
+		{
+            for (auto track : bgmTracks)
+                track->lockStream();
 
-			case BgmFadingIn :
+			if (bgmTracks[0]->stream.queryState() == ALStream::Stopped)
 			{
+				/* BGM stopped midway fade in. -> MeNotPlaying */
                 for (auto track : bgmTracks)
-                    track->lockStream();
+                    track->setVolume(AudioStream::External, 1.0f);
+				meWatch.state = MeNotPlaying;
+                for (auto track : bgmTracks)
+                    track->unlockStream();
 
-				if (bgmTracks[0]->stream.queryState() == ALStream::Stopped)
-				{
-					/* BGM stopped midway fade in. -> MeNotPlaying */
-                    for (auto track : bgmTracks)
-                        track->setVolume(AudioStream::External, 1.0f);
-					meWatch.state = MeNotPlaying;
-                    for (auto track : bgmTracks)
-                        track->unlockStream();
-
-					break;
-				}
-
-				me.lockStream();
-
-				if (me.stream.queryState() == ALStream::Playing)
-				{
-					/* ME started playing midway BGM fade in. -> FadeOutBGM */
-                    for (auto track : bgmTracks)
-                        track->extPaused = true;
-					meWatch.state = BgmFadingOut;
-					me.unlockStream();
-                    for (auto track : bgmTracks)
-                        track->unlockStream();
-
-					break;
-				}
-
-				float vol = bgmTracks[0]->getVolume(AudioStream::External);
-				vol += fadeInStep;
-
-				if (vol >= 1)
-				{
-					/* BGM fully faded in. -> MeNotPlaying */
-					vol = 1.0f;
-					meWatch.state = MeNotPlaying;
-				}
+				break;
+			}
 
-                for (auto track : bgmTracks)
-                    track->setVolume(AudioStream::External, vol);
+			me.lockStream();
 
+			if (me.stream.queryState() == ALStream::Playing)
+			{
+				/* ME started playing midway BGM fade in. -> FadeOutBGM */
+                for (auto track : bgmTracks)
+                    track->extPaused = true;
+				meWatch.state = BgmFadingOut;
 				me.unlockStream();
                 for (auto track : bgmTracks)
                     track->unlockStream();
 
 				break;
 			}
+
+			float vol = bgmTracks[0]->getVolume(AudioStream::External);
+			vol += fadeInStep;
+
+			if (vol >= 1)
+			{
+				/* BGM fully faded in. -> MeNotPlaying */
+				vol = 1.0f;
+				meWatch.state = MeNotPlaying;
 			}
 
-			SDL_Delay(AUDIO_SLEEP);
+            for (auto track : bgmTracks)
+                track->setVolume(AudioStream::External, vol);
+
+			me.unlockStream();
+            for (auto track : bgmTracks)
+                track->unlockStream();
+
+			break;
+		}
 		}
+
+		return AUDIO_SLEEP;
 	}
+
+	/* Scheduled whenever an ME is started, and
+	 * runs for as long as it takes to hand playback
+	 * back to the BGM afterwards */
+	AudioThreadJob<AudioPrivate, &AudioPrivate::meWatchFun> meWatchJob;
 #endif // MKXPZ_RETRO
 };
 
@@ -412,6 +408,9 @@ void Audio::mePlay(const char *filename,
                    int pitch)
 {
 	p->me.play(filename, volume, pitch);
+#ifndef MKXPZ_RETRO
+	shState->audioThread().schedule(&p->meWatchJob);
+#endif // MKXPZ_RETRO
 }
 
 void Audio::meStop()
@@ -437,6 +436,21 @@ void Audio::seStop()
 	p->se.stop();
 }
 
+void Audio::sePreload(const char *filename)
+{
+	p->se.preload(filename);
+}
+
+SoundCacheStats Audio::seCacheStats()
+{
+	return p->se.getStats();
+}
+
+void Audio::seResetCacheStats()
+{
+	p->se.resetStats();
+}
+
 void Audio::setupMidi()
 {
 #ifndef MKXPZ_RETRO
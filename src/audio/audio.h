@@ -34,6 +34,7 @@
 
 struct AudioPrivate;
 struct RGSSThreadData;
+struct SoundCacheStats;
 
 class Audio
 {
@@ -71,6 +72,11 @@ public:
 	            int pitch = 100);
 	void seStop();
 
+	/* Non-standard extensions */
+	void sePreload(const char *filename);
+	SoundCacheStats seCacheStats();
+	void seResetCacheStats();
+
 	void setupMidi();
 	double bgmPos(int track = 0);
 	double bgsPos();
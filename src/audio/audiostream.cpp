@@ -25,8 +25,8 @@
 #include "exception.h"
 
 #ifndef MKXPZ_RETRO
+#  include "sharedstate.h"
 #  include <SDL_mutex.h>
-#  include <SDL_thread.h>
 #  include <SDL_timer.h>
 #endif // MKXPZ_RETRO
 
@@ -35,6 +35,9 @@ AudioStream::AudioStream(ALStream::LoopMode loopMode,
 	: extPaused(false),
 	  noResumeStop(false),
 	  stream(loopMode, threadId)
+#ifndef MKXPZ_RETRO
+	, fadeJob(this)
+#endif // MKXPZ_RETRO
 {
 	current.volume = 1.0f;
 	current.pitch = 1.0f;
@@ -43,11 +46,8 @@ AudioStream::AudioStream(ALStream::LoopMode loopMode,
 		volumes[i] = 1.0f;
 
 #ifndef MKXPZ_RETRO
-	fade.thread = 0;
-	fade.threadName = std::string("audio_fadeout (") + threadId + ")";
-
-	fadeIn.thread = 0;
-	fadeIn.threadName = std::string("audio_fadein (") + threadId + ")";
+	fade.active = false;
+	fadeIn.active = false;
 
 	streamMut = SDL_CreateMutex();
 #endif // MKXPZ_RETRO
@@ -56,17 +56,7 @@ AudioStream::AudioStream(ALStream::LoopMode loopMode,
 AudioStream::~AudioStream()
 {
 #ifndef MKXPZ_RETRO
-	if (fade.thread)
-	{
-		fade.reqTerm.set();
-		SDL_WaitThread(fade.thread, 0);
-	}
-
-	if (fadeIn.thread)
-	{
-		fadeIn.rqTerm.set();
-		SDL_WaitThread(fadeIn.thread, 0);
-	}
+	shState->audioThread().cancel(&fadeJob);
 #endif // MKXPZ_RETRO
 
 	lockStream();
@@ -209,21 +199,11 @@ void AudioStream::fadeOut(int duration)
 	}
 
 #ifndef MKXPZ_RETRO
-	if (fade.thread)
-	{
-		fade.reqFini.set();
-		SDL_WaitThread(fade.thread, 0);
-		fade.thread = 0;
-	}
-
-	fade.active.set();
+	fade.active = true;
 	fade.msStep = 1.0f / duration;
-	fade.reqFini.clear();
-	fade.reqTerm.clear();
 	fade.startTicks = SDL_GetTicks64();
 
-	fade.thread = createSDLThread
-		<AudioStream, &AudioStream::fadeOutThread>(this, fade.threadName);
+	shState->audioThread().schedule(&fadeJob);
 #endif // MKXPZ_RETRO
 
 	unlockStream();
@@ -282,106 +262,87 @@ void AudioStream::updateVolume()
 void AudioStream::finiFadeOutInt()
 {
 #ifndef MKXPZ_RETRO
-	if (fade.thread)
+	/* Finish both fades right away, the way they would
+	 * have finished on their own. The fade job notices
+	 * on its next run and drops out */
+	lockStream();
+
+	if (fade.active)
 	{
-		fade.reqFini.set();
-		SDL_WaitThread(fade.thread, 0);
-		fade.thread = 0;
+		if (stream.queryState() != ALStream::Paused)
+			stream.stop();
+
+		setVolume(FadeOut, 1.0f);
+		fade.active = false;
 	}
 
-	if (fadeIn.thread)
+	if (fadeIn.active)
 	{
-		fadeIn.rqFini.set();
-		SDL_WaitThread(fadeIn.thread, 0);
-		fadeIn.thread = 0;
+		setVolume(FadeIn, 1.0f);
+		fadeIn.active = false;
 	}
+
+	unlockStream();
 #endif // MKXPZ_RETRO
 }
 
 void AudioStream::startFadeIn()
 {
 #ifndef MKXPZ_RETRO
-	/* Previous fadein should always be terminated in play() */
-	assert(!fadeIn.thread);
-
-	fadeIn.rqFini.clear();
-	fadeIn.rqTerm.clear();
+	fadeIn.active = true;
 	fadeIn.startTicks = SDL_GetTicks64();
 
-	fadeIn.thread = createSDLThread
-		<AudioStream, &AudioStream::fadeInThread>(this, fadeIn.threadName);
+	shState->audioThread().schedule(&fadeJob);
 #endif // MKXPZ_RETRO
 }
 
 #ifndef MKXPZ_RETRO
-void AudioStream::fadeOutThread()
+int AudioStream::updateFades()
 {
-	while (true)
-	{
-		/* Just immediately terminate on request */
-		if (fade.reqTerm)
-			break;
+	lockStream();
 
-		lockStream();
+	ALStream::State state = stream.queryState();
 
+	if (fade.active)
+	{
 		uint64_t curDur = SDL_GetTicks64() - fade.startTicks;
 		float resVol = 1.0f - (curDur*fade.msStep);
 
-		ALStream::State state = stream.queryState();
-
-		if (state != ALStream::Playing
-		|| resVol < 0
-		|| fade.reqFini)
+		if (state != ALStream::Playing || resVol < 0)
 		{
 			if (state != ALStream::Paused)
 				stream.stop();
 
 			setVolume(FadeOut, 1.0f);
-			unlockStream();
-
-			break;
+			fade.active = false;
+		}
+		else
+		{
+			setVolume(FadeOut, resVol);
 		}
-
-		setVolume(FadeOut, resVol);
-
-		unlockStream();
-
-		SDL_Delay(AUDIO_SLEEP);
 	}
 
-	fade.active.clear();
-}
-
-void AudioStream::fadeInThread()
-{
-	while (true)
+	if (fadeIn.active)
 	{
-		if (fadeIn.rqTerm)
-			break;
-
-		lockStream();
-
 		/* Fade in duration is always 1 second */
 		uint64_t cur = SDL_GetTicks64() - fadeIn.startTicks;
 		float prog = cur / 1000.0f;
 
-		ALStream::State state = stream.queryState();
-
-		if (state != ALStream::Playing
-		||  prog >= 1.0f
-		||  fadeIn.rqFini)
+		if (state != ALStream::Playing || prog >= 1.0f)
 		{
 			setVolume(FadeIn, 1.0f);
-			unlockStream();
-
-			break;
+			fadeIn.active = false;
 		}
+		else
+		{
+			setVolume(FadeIn, prog);
+		}
+	}
 
-		setVolume(FadeIn, prog);
+	bool active = fade.active || fadeIn.active;
 
-		unlockStream();
+	unlockStream();
 
-		SDL_Delay(AUDIO_SLEEP);
-	}
+	return active ? AUDIO_SLEEP : -1;
 }
 #endif // MKXPZ_RETRO
@@ -85,22 +85,14 @@ struct AudioStream
 #ifndef MKXPZ_RETRO
 	SDL_mutex *streamMut;
 
+	/* Both fades are run by the audio thread,
+	 * and guarded by the stream lock */
+
 	/* Fade out */
 	struct
 	{
 		/* Fade out is in progress */
-		AtomicFlag active;
-
-		/* Request fade thread to finish and
-		 * cleanup (like it normally would) */
-		AtomicFlag reqFini;
-
-		/* Request fade thread to terminate
-		 * immediately */
-		AtomicFlag reqTerm;
-
-		SDL_Thread *thread;
-		std::string threadName;
+		bool active;
 
 		/* Amount of reduced absolute volume
 		 * per ms of fade time */
@@ -113,14 +105,15 @@ struct AudioStream
 	/* Fade in */
 	struct
 	{
-		AtomicFlag rqFini;
-		AtomicFlag rqTerm;
-
-		SDL_Thread *thread;
-		std::string threadName;
+		bool active;
 
 		uint64_t startTicks;
 	} fadeIn;
+
+	/* audio thread job */
+	int updateFades();
+
+	AudioThreadJob<AudioStream, &AudioStream::updateFades> fadeJob;
 #endif // MKXPZ_RETRO
 
 	AudioStream(ALStream::LoopMode loopMode,
@@ -152,11 +145,6 @@ private:
 
 	void finiFadeOutInt();
 	void startFadeIn();
-
-#ifndef MKXPZ_RETRO
-	void fadeOutThread();
-	void fadeInThread();
-#endif // MKXPZ_RETRO
 };
 
 #endif // AUDIOSTREAM_H
@@ -0,0 +1,175 @@
+/*
+** audiothread.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "audiothread.h"
+
+#include "eventthread.h"
+#include "sdl-util.h"
+
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <SDL_timer.h>
+
+#include <algorithm>
+
+AudioThread::Job::Job()
+    : scheduled(false),
+      rerun(false),
+      due(0),
+      pass(0)
+{}
+
+AudioThread::AudioThread(SyncPoint &syncPoint)
+    : syncPoint(syncPoint),
+      current(0),
+      passCount(0),
+      quit(false)
+{
+	mutex = SDL_CreateMutex();
+	workCond = SDL_CreateCond();
+	doneCond = SDL_CreateCond();
+
+	thread = createSDLThread
+		<AudioThread, &AudioThread::threadMain>(this, "audio");
+}
+
+AudioThread::~AudioThread()
+{
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondSignal(workCond);
+	SDL_UnlockMutex(mutex);
+
+	SDL_WaitThread(thread, 0);
+
+	SDL_DestroyCond(doneCond);
+	SDL_DestroyCond(workCond);
+	SDL_DestroyMutex(mutex);
+}
+
+void AudioThread::schedule(Job *job)
+{
+	SDL_LockMutex(mutex);
+
+	if (!job->scheduled)
+	{
+		job->scheduled = true;
+		jobs.push_back(job);
+	}
+
+	/* If it's running right now, it might be about to
+	 * report that it's done, not having seen what
+	 * prompted this call yet */
+	if (job == current)
+		job->rerun = true;
+
+	job->due = 0;
+
+	SDL_CondSignal(workCond);
+	SDL_UnlockMutex(mutex);
+}
+
+void AudioThread::cancel(Job *job)
+{
+	SDL_LockMutex(mutex);
+
+	while (current == job)
+		SDL_CondWait(doneCond, mutex);
+
+	unschedule(job);
+
+	SDL_UnlockMutex(mutex);
+}
+
+void AudioThread::unschedule(Job *job)
+{
+	if (!job->scheduled)
+		return;
+
+	jobs.erase(std::find(jobs.begin(), jobs.end(), job));
+	job->scheduled = false;
+}
+
+AudioThread::Job *AudioThread::nextDue(uint64_t now)
+{
+	for (size_t i = 0; i < jobs.size(); ++i)
+		if (jobs[i]->due <= now && jobs[i]->pass != passCount)
+			return jobs[i];
+
+	return 0;
+}
+
+void AudioThread::threadMain()
+{
+	SDL_LockMutex(mutex);
+
+	while (!quit)
+	{
+		if (jobs.empty())
+		{
+			SDL_CondWait(workCond, mutex);
+			continue;
+		}
+
+		uint64_t now = SDL_GetTicks64();
+		uint64_t next = jobs[0]->due;
+
+		for (size_t i = 1; i < jobs.size(); ++i)
+			next = std::min(next, jobs[i]->due);
+
+		if (next > now)
+		{
+			SDL_CondWaitTimeout(workCond, mutex, next - now);
+			continue;
+		}
+
+		SDL_UnlockMutex(mutex);
+		syncPoint.passSecondarySync();
+		SDL_LockMutex(mutex);
+
+		++passCount;
+
+		/* Jobs can come and go while another one runs,
+		 * so look for the next one afresh every time */
+		while (Job *job = nextDue(now))
+		{
+			job->pass = passCount;
+			job->rerun = false;
+			current = job;
+
+			SDL_UnlockMutex(mutex);
+			int delay = job->update();
+			SDL_LockMutex(mutex);
+
+			current = 0;
+			SDL_CondBroadcast(doneCond);
+
+			if (job->rerun)
+				job->due = 0;
+			else if (delay < 0)
+				unschedule(job);
+			else
+				job->due = SDL_GetTicks64() + delay;
+		}
+	}
+
+	SDL_UnlockMutex(mutex);
+}
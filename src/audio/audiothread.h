@@ -0,0 +1,113 @@
+/*
+** audiothread.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOTHREAD_H
+#define AUDIOTHREAD_H
+
+#include <vector>
+#include <stdint.h>
+
+struct SyncPoint;
+struct SDL_Thread;
+struct SDL_mutex;
+struct SDL_cond;
+
+/* The one thread that keeps all audio going: stream buffer
+ * refills, volume fades and the BGM/ME handoff are jobs it
+ * runs whenever they are due. With nothing scheduled it
+ * sleeps until woken, instead of every user of it polling
+ * on a thread of its own */
+class AudioThread
+{
+public:
+	struct Job
+	{
+		Job();
+		virtual ~Job() {}
+
+		/* Runs on the audio thread. Returns the number of
+		 * milliseconds until it wants to run again, or a
+		 * negative value once there is nothing left to do */
+		virtual int update() = 0;
+
+	private:
+		friend class AudioThread;
+
+		/* All guarded by the AudioThread mutex */
+		bool scheduled;
+		bool rerun;
+		uint64_t due;
+
+		/* Last pass of the thread loop that ran it */
+		uint64_t pass;
+	};
+
+	AudioThread(SyncPoint &syncPoint);
+	~AudioThread();
+
+	/* Runs 'job' as soon as possible, and from then on for as
+	 * long as it asks to. Scheduling a job that is already
+	 * scheduled only moves it to the front again */
+	void schedule(Job *job);
+
+	/* Stops running 'job', waiting for it to return first if
+	 * it's running right now. A job must not cancel itself */
+	void cancel(Job *job);
+
+private:
+	void threadMain();
+	void unschedule(Job *job);
+	Job *nextDue(uint64_t now);
+
+	SyncPoint &syncPoint;
+
+	std::vector<Job*> jobs;
+
+	/* Job being run outside the lock, if any */
+	Job *current;
+	uint64_t passCount;
+
+	SDL_Thread *thread;
+
+	SDL_mutex *mutex;
+	SDL_cond *workCond;
+	SDL_cond *doneCond;
+
+	bool quit;
+};
+
+/* Binds a job to a member function, like createSDLThread */
+template<class C, int (C::*func)()>
+struct AudioThreadJob : AudioThread::Job
+{
+	C *obj;
+
+	AudioThreadJob(C *obj)
+	    : obj(obj)
+	{}
+
+	int update()
+	{
+		return (obj->*func)();
+	}
+};
+
+#endif // AUDIOTHREAD_H
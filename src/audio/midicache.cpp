@@ -0,0 +1,364 @@
+/*
+** midicache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "midicache.h"
+
+#include "aldatasource.h"
+#include "al-util.h"
+#include "sharedstate.h"
+#include "sharedmidistate.h"
+#include "filesystem.h"
+#include "cachedir.h"
+#include "config.h"
+#include "exception.h"
+#include "debugwriter.h"
+#include "sdl-util.h"
+
+#include <SDL_mutex.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#define FORMAT_VER 1
+
+/* Frames streamed per buffer, same as live synthesis */
+#define BUF_FRAMES 32768
+
+static const char magic[8] = { 'M', 'K', 'X', 'P', 'M', 'I', 'D', FORMAT_VER };
+
+/* Followed by 'frames' frames of 16 bit stereo PCM */
+struct Header
+{
+	char magic[8];
+
+	/* Identity of the midi file and synth settings */
+	uint64_t key;
+	uint64_t dataSize;
+
+	uint64_t frames;
+	uint64_t loopStart;
+	uint64_t loopEnd;
+};
+
+struct PrerenderedSource : ALDataSource
+{
+	FILE *f;
+	Header hd;
+	bool looped;
+
+	/* Frame that the next read starts at */
+	uint64_t pos;
+
+	std::vector<int16_t> buf;
+
+	PrerenderedSource(FILE *f, const Header &hd, bool looped)
+	    : f(f),
+	      hd(hd),
+	      looped(looped),
+	      pos(0),
+	      buf(BUF_FRAMES * 2)
+	{
+		/* Songs without a usable loop repeat as a whole */
+		if (this->hd.loopEnd <= this->hd.loopStart || this->hd.loopEnd > hd.frames)
+		{
+			this->hd.loopStart = 0;
+			this->hd.loopEnd = hd.frames;
+		}
+	}
+
+	~PrerenderedSource()
+	{
+		fclose(f);
+	}
+
+	bool seekFrame(uint64_t frame)
+	{
+		pos = frame;
+
+		return fseek(f, sizeof(Header) + frame * 4, SEEK_SET) == 0;
+	}
+
+	Status fillBuffer(AL::Buffer::ID alBuffer)
+	{
+		uint64_t end = looped ? hd.loopEnd : hd.frames;
+		size_t count = std::min<uint64_t>(BUF_FRAMES, end - pos);
+
+		if (fread(&buf[0], 4, count, f) < count)
+			return Error;
+
+		pos += count;
+
+		Status status = NoError;
+
+		if (pos >= end)
+		{
+			if (!looped)
+				status = EndOfStream;
+			else if (seekFrame(hd.loopStart))
+				status = WrapAround;
+			else
+				status = Error;
+		}
+
+		AL::Buffer::uploadData(alBuffer, AL_FORMAT_STEREO16, &buf[0], count * 4, SYNTH_SAMPLERATE);
+
+		return status;
+	}
+
+	int sampleRate()
+	{
+		return SYNTH_SAMPLERATE;
+	}
+
+	void seekToOffset(double seconds)
+	{
+		uint64_t frame = std::max(seconds, 0.0) * SYNTH_SAMPLERATE;
+
+		if (looped && frame >= hd.loopEnd)
+			frame = hd.loopStart + (frame - hd.loopStart) % (hd.loopEnd - hd.loopStart);
+
+		seekFrame(std::min(frame, hd.frames - 1));
+	}
+
+	uint64_t loopStartFrames()
+	{
+		return hd.loopStart;
+	}
+
+	/* Pitch is left to OpenAL, like for any other sampled format */
+	bool setPitch(float)
+	{
+		return false;
+	}
+};
+
+MidiCache::MidiCache(const std::string &dir, const Config &conf)
+    : usedBytes(0),
+      limit((int64_t) conf.midi.cacheSize * 1024 * 1024),
+      soundFont(conf.midi.soundFont),
+      chorus(conf.midi.chorus),
+      reverb(conf.midi.reverb),
+      worker(0),
+      quit(false)
+{
+	mutex = SDL_CreateMutex();
+	workCond = SDL_CreateCond();
+
+	if (dir.empty())
+		return;
+
+	if (!mkxp_fs::createDirectories(dir.c_str()))
+	{
+		Debug() << "Midi cache disabled, can't create" << dir;
+		return;
+	}
+
+	this->dir = dir;
+	usedBytes = trimCacheDir(dir, ".pcm", limit);
+
+	worker = createSDLThread
+		<MidiCache, &MidiCache::workerMain>(this, "midicache");
+}
+
+MidiCache::~MidiCache()
+{
+	if (worker)
+	{
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondSignal(workCond);
+		SDL_UnlockMutex(mutex);
+
+		SDL_WaitThread(worker, 0);
+	}
+
+	SDL_DestroyCond(workCond);
+	SDL_DestroyMutex(mutex);
+}
+
+uint64_t MidiCache::makeKey(const std::vector<uint8_t> &data) const
+{
+	uint64_t hash = cacheHash(&data[0], data.size());
+
+	hash = cacheHash(soundFont.c_str(), soundFont.size() + 1, hash);
+	hash = cacheHash(&chorus, sizeof(chorus), hash);
+	hash = cacheHash(&reverb, sizeof(reverb), hash);
+
+	return hash;
+}
+
+std::string MidiCache::entryPath(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.pcm", (unsigned long long) key);
+
+	return dir + name;
+}
+
+ALDataSource *MidiCache::open(const std::vector<uint8_t> &data, bool looped)
+{
+	if (dir.empty() || !HAVE_FLUID)
+		return 0;
+
+	uint64_t key = makeKey(data);
+
+	if (FILE *f = fopen(entryPath(key).c_str(), "rb"))
+	{
+		Header hd;
+
+		if (fread(&hd, sizeof(hd), 1, f) == 1 &&
+		    memcmp(hd.magic, magic, sizeof(magic)) == 0 &&
+		    hd.key == key && hd.dataSize == data.size() && hd.frames > 0)
+			return new PrerenderedSource(f, hd, looped);
+
+		fclose(f);
+	}
+
+	SDL_LockMutex(mutex);
+
+	if (pending.insert(key).second)
+	{
+		queue.push_back(Request());
+		queue.back().key = key;
+		queue.back().data = data;
+
+		SDL_CondSignal(workCond);
+	}
+
+	SDL_UnlockMutex(mutex);
+
+	return 0;
+}
+
+void MidiCache::workerMain()
+{
+	SDL_LockMutex(mutex);
+
+	while (true)
+	{
+		while (!quit && queue.empty())
+			SDL_CondWait(workCond, mutex);
+
+		if (quit)
+			break;
+
+		Request req;
+		std::swap(req, queue.front());
+		queue.pop_front();
+
+		SDL_UnlockMutex(mutex);
+
+		render(req);
+
+		SDL_LockMutex(mutex);
+
+		pending.erase(req.key);
+	}
+
+	SDL_UnlockMutex(mutex);
+}
+
+struct FileSink : MidiRenderSink
+{
+	FILE *f;
+	uint64_t frames;
+
+	SDL_mutex *mutex;
+	const bool &quit;
+
+	FileSink(FILE *f, SDL_mutex *mutex, const bool &quit)
+	    : f(f),
+	      frames(0),
+	      mutex(mutex),
+	      quit(quit)
+	{}
+
+	bool write(const int16_t *samples, size_t count)
+	{
+		SDL_LockMutex(mutex);
+		bool stop = quit;
+		SDL_UnlockMutex(mutex);
+
+		if (stop || fwrite(samples, 4, count, f) < count)
+			return false;
+
+		frames += count;
+
+		return true;
+	}
+};
+
+void MidiCache::render(const Request &req)
+{
+	const std::string path = entryPath(req.key);
+	const std::string tmpPath = path + ".tmp";
+
+	FILE *f = fopen(tmpPath.c_str(), "wb");
+
+	if (!f)
+		return;
+
+	/* A synth of our own, so the ones
+	 * playing live are left alone */
+	fluid_synth_t *synth = fluid.new_synth(shState->midiState().flSettings);
+
+	if (!soundFont.empty())
+		fluid.synth_sfload(synth, soundFont.c_str(), 1);
+
+	Header hd;
+	memset(&hd, 0, sizeof(hd));
+
+	/* Written for real once the length is known */
+	bool ok = fwrite(&hd, sizeof(hd), 1, f) == 1;
+
+	FileSink sink(f, mutex, quit);
+
+	try
+	{
+		ok = ok && renderMidi(req.data, synth, sink, hd.loopStart, hd.loopEnd);
+	}
+	catch (const Exception &)
+	{
+		/* Unparsable files are played (and fail) live */
+		ok = false;
+	}
+
+	fluid.delete_synth(synth);
+
+	if (ok)
+	{
+		memcpy(hd.magic, magic, sizeof(magic));
+		hd.key = req.key;
+		hd.dataSize = req.data.size();
+		hd.frames = sink.frames;
+
+		ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&hd, sizeof(hd), 1, f) == 1;
+	}
+
+	if (!finishCacheFile(f, ok, tmpPath, path))
+		return;
+
+	usedBytes += sizeof(hd) + hd.frames * 4;
+
+	if (usedBytes > limit)
+		usedBytes = trimCacheDir(dir, ".pcm", limit);
+}
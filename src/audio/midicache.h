@@ -0,0 +1,114 @@
+/*
+** midicache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIDICACHE_H
+#define MIDICACHE_H
+
+#include "fluid-fun.h"
+
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct ALDataSource;
+struct Config;
+struct SDL_Thread;
+struct SDL_mutex;
+struct SDL_cond;
+
+/* Keeps midi files synthesized to raw 16 bit stereo PCM in
+ * a folder on disk, so playing them later costs no more than
+ * streaming a file instead of running fluidsynth live.
+ *
+ * Files are rendered once, on a background thread, the first
+ * time they're played; that first playback is synthesized live
+ * as usual. Entries are keyed on the file contents and on the
+ * soundfont, chorus and reverb settings. Once the files take
+ * up more than conf.midi.cacheSize megabytes, the oldest
+ * ones are deleted */
+class MidiCache
+{
+public:
+	/* 'dir' is created if missing. An empty
+	 * 'dir' disables the cache */
+	MidiCache(const std::string &dir, const Config &conf);
+	~MidiCache();
+
+	/* Returns a source streaming the prerendered 'data' if
+	 * there is one. Otherwise queues 'data' for rendering and
+	 * returns 0. Must be called on the RGSS thread */
+	ALDataSource *open(const std::vector<uint8_t> &data, bool looped);
+
+private:
+	struct Request
+	{
+		uint64_t key;
+		std::vector<uint8_t> data;
+	};
+
+	uint64_t makeKey(const std::vector<uint8_t> &data) const;
+	std::string entryPath(uint64_t key) const;
+
+	void workerMain();
+	void render(const Request &req);
+
+	std::string dir;
+
+	/* Only touched by the constructor and the worker */
+	int64_t usedBytes;
+	int64_t limit;
+
+	/* Synth settings that entries are keyed on */
+	std::string soundFont;
+	bool chorus;
+	bool reverb;
+
+	std::deque<Request> queue;
+
+	/* Keys of queued and rendering files */
+	std::set<uint64_t> pending;
+
+	SDL_Thread *worker;
+	SDL_mutex *mutex;
+	SDL_cond *workCond;
+
+	bool quit;
+};
+
+/* Receives synthesized 16 bit stereo samples */
+struct MidiRenderSink
+{
+	virtual ~MidiRenderSink() {}
+
+	/* Returning false aborts the rendering */
+	virtual bool write(const int16_t *samples, size_t frames) = 0;
+};
+
+/* Synthesizes the midi file 'data' once, start to end, through
+ * 'synth'. 'loopStart' and 'loopEnd' receive the frames between
+ * which a looped playback repeats. Safe to use on any thread.
+ * Implemented in midisource.cpp */
+bool renderMidi(const std::vector<uint8_t> &data, fluid_synth_t *synth,
+                MidiRenderSink &sink, uint64_t &loopStart, uint64_t &loopEnd);
+
+#endif // MIDICACHE_H
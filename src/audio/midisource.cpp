@@ -30,12 +30,15 @@
 #include "fluid-fun.h"
 
 #ifndef MKXPZ_RETRO
+#  include "midicache.h"
 #  include <SDL_rwops.h>
 #endif // MKXPZ_RETRO
 
 #include <assert.h>
 #include <math.h>
 #include <vector>
+#include <list>
+#include <memory>
 #include <algorithm>
 
 /* Vocabulary:
@@ -56,6 +59,7 @@
 #define TICK_FRAMES 32
 #define BUF_TICKS (STREAM_BUF_SIZE / TICK_FRAMES)
 #define DEFAULT_BPM 120
+#define SONG_CACHE_SIZE 8
 #define MAX_CHANNELS 16
 
 #define CC_CTRL_VOLUME       7
@@ -582,13 +586,11 @@ struct CCResetter
 	}
 };
 
-struct MidiSource : ALDataSource, MidiReadHandler
+/* Everything parsed out of a midi file. Sources copy the
+ * tracks (in their initial state) and play them back from
+ * there, so one parse can serve any number of sources */
+struct MidiSong : MidiReadHandler
 {
-	const uint16_t freq;
-	fluid_synth_t *synth;
-
-	int16_t synthBuf[BUF_TICKS*TICK_FRAMES*2];
-
 	std::vector<Track> tracks;
 	CCResetter<CC_CTRL_VOLUME>     volReset;
 	CCResetter<CC_CTRL_EXPRESSION> expReset;
@@ -596,67 +598,29 @@ struct MidiSource : ALDataSource, MidiReadHandler
 	/* Index of longest track */
 	uint8_t longestI;
 
-	bool looped;
-
 	/* Absolute delta at which we received the LOOP_MARKER CC event */
 	uint32_t loopDelta;
 
 	/* Deltas per beat */
 	uint16_t dpb;
 
-	int8_t pitchShift;
-
-	/* Deltas per tick */
-	float playbackSpeed;
-
-	float genDeltasCarry;
-
 	/* MidiReadHandler (track that's currently being read) */
 	int16_t curTrack;
 
-	MidiSource(
-#ifdef MKXPZ_RETRO
-		std::shared_ptr<struct FileSystem::File> ops,
-#else
-		SDL_RWops &ops,
-#endif // MKXPZ_RETRO
-	           bool looped)
-	    : freq(SYNTH_SAMPLERATE),
-	      looped(looped),
+	/* Identity of the file data, for the song cache */
+	uint64_t dataHash;
+	size_t dataSize;
+
+	MidiSong(const std::vector<uint8_t> &data, uint64_t dataHash)
+	    : longestI(0),
+	      loopDelta(0),
 	      dpb(480),
-	      pitchShift(0),
-	      genDeltasCarry(0),
-	      curTrack(-1)
+	      curTrack(-1),
+	      dataHash(dataHash),
+	      dataSize(data.size())
 	{
-#ifdef MKXPZ_RETRO
-		PHYSFS_Stat stat;
-		size_t dataLen = PHYSFS_stat(ops->path(), &stat) ? stat.filesize : 0;
-#else
-		size_t dataLen = SDL_RWsize(&ops);
-#endif // MKXPZ_RETRO
-		std::vector<uint8_t> data(dataLen);
-
-		if (
-#ifdef MKXPZ_RETRO
-			PHYSFS_readBytes(ops->get(), &data[0], dataLen) < dataLen
-#else
-			SDL_RWread(&ops, &data[0], 1, dataLen) < dataLen
-#endif // MKXPZ_RETRO
-		) {
-#ifndef MKXPZ_RETRO
-			SDL_RWclose(&ops);
-#endif // MKXPZ_RETRO
-			throw Exception(Exception::MKXPError, "Reading midi data failed");
-		}
-
-#ifndef MKXPZ_RETRO
-		SDL_RWclose(&ops);
-#endif // MKXPZ_RETRO
-
 		readMidi(this, data);
 
-		synth = shState->midiState().allocateSynth();
-
 		uint64_t longest = 0;
 
 		for (size_t i = 0; i < tracks.size(); ++i)
@@ -698,16 +662,168 @@ struct MidiSource : ALDataSource, MidiReadHandler
 			}
 		}
 
-		updatePlaybackSpeed(DEFAULT_BPM);
-
 		// FIXME: It would make the code in 'fillBuffer' a lot nicer if
 		// we could combine all tracks into one giant one on construction,
 		// instead of having to constantly iterate through all of them
 	}
 
+	/* MidiReadHandler */
+	void onMidiHeader(uint16_t midiType, uint16_t trackCount, uint16_t division)
+	{
+		if (midiType != 0 && midiType != 1)
+			throw Exception(Exception::MKXPError, "Midi: Type 2 not supported");
+
+		tracks.resize(trackCount);
+
+		// SMTP unhandled
+		if (division & 0x8000)
+			throw Exception(Exception::MKXPError, "Midi: SMTP parameters not supported");
+		else
+			dpb = division;
+	}
+
+	void onMidiTrackBegin()
+	{
+		++curTrack;
+	}
+
+	void onMidiEvent(const MidiEvent &e, uint32_t absDelta)
+	{
+		assert(curTrack >= 0 && curTrack < (int16_t) tracks.size());
+
+		Track &track = tracks[curTrack];
+
+		track.appendEvent(e);
+		volReset.handleEvent(e, track);
+		expReset.handleEvent(e, track);
+
+		if (e.type == CC && e.e.cc.ctrl == CC_CTRL_LOOP)
+			loopDelta = absDelta;
+	}
+};
+
+static uint64_t
+hashData(const std::vector<uint8_t> &data)
+{
+	/* FNV-1a */
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/* Returns the parsed song for 'data', parsing it only
+ * if it isn't among the most recently opened ones */
+static std::shared_ptr<MidiSong>
+loadSong(const std::vector<uint8_t> &data)
+{
+	std::list<std::shared_ptr<MidiSong> > &cache = shState->midiState().songCache;
+	uint64_t hash = hashData(data);
+
+	for (std::list<std::shared_ptr<MidiSong> >::iterator iter = cache.begin();
+	     iter != cache.end(); ++iter)
+	{
+		if ((*iter)->dataHash != hash || (*iter)->dataSize != data.size())
+			continue;
+
+		/* Mark as most recently used */
+		cache.splice(cache.begin(), cache, iter);
+
+		return cache.front();
+	}
+
+	std::shared_ptr<MidiSong> song(new MidiSong(data, hash));
+
+	cache.push_front(song);
+
+	if (cache.size() > SONG_CACHE_SIZE)
+		cache.pop_back();
+
+	return song;
+}
+
+struct MidiSource : ALDataSource
+{
+	const uint16_t freq;
+	fluid_synth_t *synth;
+
+	/* Whether 'synth' came from the shared pool */
+	bool pooledSynth;
+
+	int16_t synthBuf[BUF_TICKS*TICK_FRAMES*2];
+
+	std::shared_ptr<MidiSong> song;
+	std::vector<Track> tracks;
+
+	/* Index of longest track */
+	uint8_t longestI;
+
+	bool looped;
+
+	/* Deltas per beat */
+	uint16_t dpb;
+
+	int8_t pitchShift;
+
+	/* Deltas per tick */
+	float playbackSpeed;
+
+	float genDeltasCarry;
+
+	/* Playback progress since the last (re)start, and the frames
+	 * at which the loop marker and the end of the longest track
+	 * were reached (-1 until they are) */
+	uint64_t renderedFrames;
+	uint64_t playedDeltas;
+	int64_t loopStartFrame;
+	int64_t songEndFrame;
+
+	/* Passing 'renderSynth' plays through that synth instead of
+	 * one from the shared pool. Such sources don't touch any
+	 * shared state and can be used on other threads */
+	MidiSource(const std::vector<uint8_t> &data,
+	           bool looped,
+	           fluid_synth_t *renderSynth = 0)
+	    : freq(SYNTH_SAMPLERATE),
+	      synth(renderSynth),
+	      pooledSynth(renderSynth == 0),
+	      looped(looped),
+	      pitchShift(0),
+	      genDeltasCarry(0)
+	{
+		if (pooledSynth)
+			song = loadSong(data);
+		else
+			song.reset(new MidiSong(data, hashData(data)));
+
+		tracks = song->tracks;
+		longestI = song->longestI;
+		dpb = song->dpb;
+
+		if (pooledSynth)
+			synth = shState->midiState().allocateSynth();
+
+		updatePlaybackSpeed(DEFAULT_BPM);
+		resetProgress();
+	}
+
 	~MidiSource()
 	{
-		shState->midiState().releaseSynth(synth);
+		if (pooledSynth)
+			shState->midiState().releaseSynth(synth);
+	}
+
+	void resetProgress()
+	{
+		renderedFrames = 0;
+		playedDeltas = 0;
+		loopStartFrame = (song->loopDelta == 0) ? 0 : -1;
+		songEndFrame = -1;
 	}
 
 
@@ -768,42 +884,89 @@ struct MidiSource : ALDataSource, MidiReadHandler
 		fluid.synth_write_s16(synth, len, buffer, 0, 2, buffer, 1, 2);
 	}
 
-	/* MidiReadHandler */
-	void onMidiHeader(uint16_t midiType, uint16_t trackCount, uint16_t division)
+	/* Activates all events that are due, and returns the
+	 * number of ticks until the next one, capped at 'maxTicks'.
+	 * While seeking, notes are dropped and only the events that
+	 * change channel or tempo state are passed on */
+	size_t activateDueEvents(size_t maxTicks, bool seeking)
 	{
-		if (midiType != 0 && midiType != 1)
-			throw Exception(Exception::MKXPError, "Midi: Type 2 not supported");
+		/* Check for events that have to be activated now, activate them,
+		 * and schedule new ones if the queue isn't empty */
+		for (size_t i = 0; i < tracks.size(); ++i)
+		{
+			Track &track = tracks[i];
 
-		tracks.resize(trackCount);
+			/* We have to loop and ensure that the final scheduled
+			 * event lies in the future, as multiple events might
+			 * have to be activated at once */
+			while (true)
+			{
+				if (!track.valid || track.remDeltas > 0)
+					break;
 
-		// SMTP unhandled
-		if (division & 0x8000)
-			throw Exception(Exception::MKXPError, "Midi: SMTP parameters not supported");
-		else
-			dpb = division;
-	}
+				int32_t prevOffset = track.remDeltas;
 
-	void onMidiTrackBegin()
-	{
-		++curTrack;
+				if (!seeking || (track.event.type != NoteOn && track.event.type != NoteOff))
+					activateEvent(track.event);
+
+				track.valid = false;
+				track.scheduleEvent(looped);
+
+				/* Negative deltas from the previous event have to
+				 * be carried over into the next to stay in sync */
+				if (prevOffset < 0)
+					track.remDeltas += prevOffset;
+
+				/* Ensure it lies in the future */
+				if (track.remDeltas > 0)
+					break;
+			}
+		}
+
+		size_t nextEvent = (size_t) -1;
+		bool allInvalid = true;
+
+		/* Search all tracks for the temporally nearest event */
+		for (size_t i = 0; i < tracks.size(); ++i)
+		{
+			Track &track = tracks[i];
+
+			if (!track.valid)
+				continue;
+
+			allInvalid = false;
+
+			uint32_t remDelta = track.remDeltas / playbackSpeed;
+
+			/* We need to render at least one tick regardless to
+			 * avoid an endless loop of waiting for the next event
+			 * to become current */
+			if (remDelta < nextEvent)
+				nextEvent = std::max<uint32_t>(remDelta, 1);
+		}
+
+		return allInvalid ? maxTicks : std::min(maxTicks, nextEvent);
 	}
 
-	void onMidiEvent(const MidiEvent &e, uint32_t absDelta)
+	/* Moves all tracks 'ticks' forward in time */
+	void advanceTicks(size_t ticks)
 	{
-		assert(curTrack >= 0 && curTrack < (int16_t) tracks.size());
+		float genDeltas = (ticks * playbackSpeed) + genDeltasCarry;
 
-		Track &track = tracks[curTrack];
+		float intDeltas;
+		genDeltasCarry = modff(genDeltas, &intDeltas);
 
-		track.appendEvent(e);
-		volReset.handleEvent(e, track);
-		expReset.handleEvent(e, track);
+		playedDeltas += intDeltas;
 
-		if (e.type == CC && e.e.cc.ctrl == CC_CTRL_LOOP)
-			loopDelta = absDelta;
+		/* Substract integer part of consumed deltas while carrying
+		 * over the fractional amount into the next iteration */
+		for (size_t i = 0; i < tracks.size(); ++i)
+			if (tracks[i].valid)
+				tracks[i].remDeltas -= intDeltas;
 	}
 
-	/* ALDataSource */
-	Status fillBuffer(AL::Buffer::ID buf)
+	/* Synthesizes the next buffer worth of ticks into 'synthBuf' */
+	Status renderBuffer()
 	{
 		/* In case there is no currently scheduled one */
 		for (size_t i = 0; i < tracks.size(); ++i)
@@ -815,62 +978,18 @@ struct MidiSource : ALDataSource, MidiReadHandler
 		 * have been rendered */
 		while (remTicks > 0)
 		{
-			/* Check for events that have to be activated now, activate them,
-			 * and schedule new ones if the queue isn't empty */
-			for (size_t i = 0; i < tracks.size(); ++i)
-			{
-				Track &track = tracks[i];
-
-				/* We have to loop and ensure that the final scheduled
-				 * event lies in the future, as multiple events might
-				 * have to be activated at once */
-				while (true)
-				{
-					if (!track.valid || track.remDeltas > 0)
-						break;
-
-					int32_t prevOffset = track.remDeltas;
-
-					activateEvent(track.event);
-
-					track.valid = false;
-					track.scheduleEvent(looped);
-
-					/* Negative deltas from the previous event have to
-					 * be carried over into the next to stay in sync */
-					if (prevOffset < 0)
-						track.remDeltas += prevOffset;
-
-					/* Ensure it lies in the future */
-					if (track.remDeltas > 0)
-						break;
-				}
-			}
+			uint64_t frame = renderedFrames + (BUF_TICKS - remTicks) * TICK_FRAMES;
 
-			size_t nextEvent = (size_t) -1;
-			bool allInvalid = true;
-
-			/* Search all tracks for the temporally nearest event */
-			for (size_t i = 0; i < tracks.size(); ++i)
-			{
-				Track &track = tracks[i];
-
-				if (!track.valid)
-					continue;
-
-				allInvalid = false;
-
-				uint32_t remDelta = track.remDeltas / playbackSpeed;
-
-				/* We need to render at least one tick regardless to
-				 * avoid an endless loop of waiting for the next event
-				 * to become current */
-				if (remDelta < nextEvent)
-					nextEvent = std::max<uint32_t>(remDelta, 1);
-			}
+			/* The loop marker is an event itself,
+			 * so it always starts a new batch */
+			if (loopStartFrame < 0 && playedDeltas >= song->loopDelta)
+				loopStartFrame = frame;
 
 			/* Calculate amount of ticks we'll render next */
-			size_t genTicks = allInvalid ? remTicks : std::min(remTicks, nextEvent);
+			size_t genTicks = activateDueEvents(remTicks, false);
+
+			if (songEndFrame < 0 && tracks[longestI].atEnd)
+				songEndFrame = frame;
 
 			if (genTicks == 0)
 				continue;
@@ -878,20 +997,10 @@ struct MidiSource : ALDataSource, MidiReadHandler
 			renderTicks(genTicks, BUF_TICKS - remTicks);
 			remTicks -= genTicks;
 
-			float genDeltas = (genTicks * playbackSpeed) + genDeltasCarry;
-
-			float intDeltas;
-			genDeltasCarry = modff(genDeltas, &intDeltas);
-
-			/* Substract integer part of consumed deltas while carrying
-			 * over the fractional amount into the next iteration */
-			for (size_t i = 0; i < tracks.size(); ++i)
-				if (tracks[i].valid)
-					tracks[i].remDeltas -= intDeltas;
+			advanceTicks(genTicks);
 		}
 
-		/* Fill AL buffer */
-		AL::Buffer::uploadData(buf, AL_FORMAT_STEREO16, synthBuf, sizeof(synthBuf), freq);
+		renderedFrames += BUF_TICKS * TICK_FRAMES;
 
 		if (tracks[longestI].atEnd)
 			return EndOfStream;
@@ -899,13 +1008,23 @@ struct MidiSource : ALDataSource, MidiReadHandler
 		return NoError;
 	}
 
+	/* ALDataSource */
+	Status fillBuffer(AL::Buffer::ID buf)
+	{
+		Status status = renderBuffer();
+
+		/* Fill AL buffer */
+		AL::Buffer::uploadData(buf, AL_FORMAT_STEREO16, synthBuf, sizeof(synthBuf), freq);
+
+		return status;
+	}
+
 	int sampleRate()
 	{
 		return freq;
 	}
 
-	/* Midi sources cannot seek, and so always reset to beginning */
-	void seekToOffset(double)
+	void seekToOffset(double seconds)
 	{
 		/* Reset synth */
 		fluid.synth_system_reset(synth);
@@ -917,6 +1036,30 @@ struct MidiSource : ALDataSource, MidiReadHandler
 		/* Reset tracks */
 		for (size_t i = 0; i < tracks.size(); ++i)
 			tracks[i].reset();
+
+		resetProgress();
+
+		if (seconds <= 0)
+			return;
+
+		/* Walk the events up to the requested position without
+		 * synthesizing anything, so the synth ends up with the
+		 * same programs, controllers and tempo as if it had
+		 * played there. Notes that would still be sounding at
+		 * that point are not picked up again */
+		for (size_t i = 0; i < tracks.size(); ++i)
+			tracks[i].scheduleEvent(looped);
+
+		uint64_t remTicks = seconds * freq / TICK_FRAMES;
+
+		while (remTicks > 0)
+		{
+			size_t skipTicks = activateDueEvents(std::min<uint64_t>(remTicks, (size_t) -1), true);
+
+			remTicks -= skipTicks;
+
+			advanceTicks(skipTicks);
+		}
 	}
 
 	uint64_t loopStartFrames() { return 0; }
@@ -938,5 +1081,59 @@ ALDataSource *createMidiSource(
 #endif // MKXPZ_RETRO
                                bool looped)
 {
-	return new MidiSource(ops, looped);
+#ifdef MKXPZ_RETRO
+	PHYSFS_Stat stat;
+	size_t dataLen = PHYSFS_stat(ops->path(), &stat) ? stat.filesize : 0;
+#else
+	size_t dataLen = SDL_RWsize(&ops);
+#endif // MKXPZ_RETRO
+	std::vector<uint8_t> data(dataLen);
+
+	if (
+#ifdef MKXPZ_RETRO
+		PHYSFS_readBytes(ops->get(), &data[0], dataLen) < dataLen
+#else
+		SDL_RWread(&ops, &data[0], 1, dataLen) < dataLen
+#endif // MKXPZ_RETRO
+	) {
+#ifndef MKXPZ_RETRO
+		SDL_RWclose(&ops);
+#endif // MKXPZ_RETRO
+		throw Exception(Exception::MKXPError, "Reading midi data failed");
+	}
+
+#ifndef MKXPZ_RETRO
+	SDL_RWclose(&ops);
+
+	if (ALDataSource *cached = shState->midiCache().open(data, looped))
+		return cached;
+#endif // MKXPZ_RETRO
+
+	return new MidiSource(data, looped);
 }
+
+#ifndef MKXPZ_RETRO
+bool renderMidi(const std::vector<uint8_t> &data, fluid_synth_t *synth,
+                MidiRenderSink &sink, uint64_t &loopStart, uint64_t &loopEnd)
+{
+	MidiSource source(data, false, synth);
+
+	fluid.synth_system_reset(synth);
+
+	ALDataSource::Status status;
+
+	do
+	{
+		status = source.renderBuffer();
+
+		if (!sink.write(source.synthBuf, BUF_TICKS * TICK_FRAMES))
+			return false;
+	}
+	while (status != ALDataSource::EndOfStream);
+
+	loopEnd = source.songEndFrame;
+	loopStart = std::max<int64_t>(source.loopStartFrame, 0);
+
+	return true;
+}
+#endif // MKXPZ_RETRO
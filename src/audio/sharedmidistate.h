@@ -28,6 +28,8 @@
 
 #include <assert.h>
 #include <vector>
+#include <list>
+#include <memory>
 #include <string>
 
 #define SYNTH_INIT_COUNT 2
@@ -39,10 +41,16 @@ struct Synth
 	bool inUse;
 };
 
+struct MidiSong;
+
 struct SharedMidiState
 {
 	bool inited;
 	std::vector<Synth> synths;
+
+	/* Recently parsed midi files, most recently used first.
+	 * Only touched when midi sources are created */
+	std::list<std::shared_ptr<MidiSong> > songCache;
 #ifndef MKXPZ_RETRO
 	const std::string &soundFont;
 #endif // MKXPZ_RETRO
@@ -32,10 +32,18 @@
 #  include <sndfile.hh>
 #else
 #  include <SDL_sound.h>
+#  include <SDL_mutex.h>
+#  include "sdl-util.h"
 #endif // MKXPZ_RETRO
 
+#include <algorithm>
+
 #define SE_CACHE_MEM (10*1024*1024) // 10 MB
 
+/* SEs are short; two threads keep up with
+ * a whole battle's worth of first plays */
+#define SE_DECODE_THREADS 2
+
 struct SoundBuffer
 {
 	/* Uniquely identifies this or equal buffer */
@@ -80,6 +88,8 @@ private:
 	}
 };
 
+static SoundBuffer *decodeSound(const std::string &filename);
+
 /* Before: [a][b][c][d], After (index=1): [a][c][d][b] */
 static void
 arrayPushBack(std::vector<size_t> &array, size_t size, size_t index)
@@ -92,6 +102,28 @@ arrayPushBack(std::vector<size_t> &array, size_t size, size_t index)
 	array[size-1] = v;
 }
 
+#ifndef MKXPZ_RETRO
+struct SoundEmitter::DecodeRequest
+{
+	std::string filename;
+
+	struct Play
+	{
+		float volume;
+		float pitch;
+	};
+
+	/* Started as soon as the buffer is ready */
+	std::vector<Play> plays;
+
+	bool done;
+
+	/* Threads waiting for 'done'; the last one
+	 * to leave deletes the request */
+	int waiters;
+};
+#endif // MKXPZ_RETRO
+
 #ifdef MKXPZ_RETRO
 SoundEmitter::SoundEmitter()
 #else
@@ -99,13 +131,24 @@ SoundEmitter::SoundEmitter(const Config &conf)
 #endif // MKXPZ_RETRO
     : bufferBytes(0),
 #ifdef MKXPZ_RETRO
+      bufferLimit(SE_CACHE_MEM),
       srcCount(6), // TODO: get from config
 #else
+      bufferLimit(std::min<int64_t>((int64_t) std::max(conf.SE.cacheSize, 0) * 1024 * 1024,
+                                    UINT32_MAX)),
       srcCount(conf.SE.sourceCount),
 #endif // MKXPZ_RETRO
       alSrcs(srcCount),
       atchBufs(srcCount),
-      srcPrio(srcCount)
+      srcPrio(srcCount),
+      hits(0),
+#ifdef MKXPZ_RETRO
+      misses(0)
+#else
+      misses(0),
+      asyncDecode(conf.SE.asyncDecode),
+      quit(false)
+#endif // MKXPZ_RETRO
 {
 	for (size_t i = 0; i < srcCount; ++i)
 	{
@@ -113,10 +156,39 @@ SoundEmitter::SoundEmitter(const Config &conf)
 		atchBufs[i] = 0;
 		srcPrio[i] = i;
 	}
+
+#ifndef MKXPZ_RETRO
+	mutex = SDL_CreateMutex();
+	workCond = SDL_CreateCond();
+	doneCond = SDL_CreateCond();
+
+	for (int i = 0; i < SE_DECODE_THREADS; ++i)
+		workers.push_back(createSDLThread
+			<SoundEmitter, &SoundEmitter::workerMain>(this, "se_decode"));
+#endif // MKXPZ_RETRO
 }
 
 SoundEmitter::~SoundEmitter()
 {
+#ifndef MKXPZ_RETRO
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondBroadcast(workCond);
+	SDL_UnlockMutex(mutex);
+
+	for (size_t i = 0; i < workers.size(); ++i)
+		SDL_WaitThread(workers[i], 0);
+
+	/* Workers finish what they started, so only
+	 * never picked up requests are left */
+	for (size_t i = 0; i < queue.size(); ++i)
+		delete queue[i];
+
+	SDL_DestroyCond(doneCond);
+	SDL_DestroyCond(workCond);
+	SDL_DestroyMutex(mutex);
+#endif // MKXPZ_RETRO
+
 	for (size_t i = 0; i < srcCount; ++i)
 	{
 		AL::Source::stop(alSrcs[i]);
@@ -138,11 +210,100 @@ void SoundEmitter::play(const std::string &filename,
 	float _volume = clamp<int>(volume, 0, 100) / 100.0f;
 	float _pitch  = clamp<int>(pitch, 50, 150) / 100.0f;
 
+#ifdef MKXPZ_RETRO
 	SoundBuffer *buffer = allocateBuffer(filename);
 
-	if (!buffer)
+	if (buffer)
+		startPlayback(buffer, _volume, _pitch);
+#else
+	SDL_LockMutex(mutex);
+	SoundBuffer *buffer = lookupBuffer(filename);
+
+	if (buffer)
+	{
+		startPlayback(buffer, _volume, _pitch);
+		SDL_UnlockMutex(mutex);
+
 		return;
+	}
+
+	SDL_UnlockMutex(mutex);
+
+	/* Missing files still raise right away, as they
+	 * did when sounds were decoded on this thread */
+	struct ProbeHandler : FileSystem::OpenHandler
+	{
+		bool tryRead(SDL_RWops &ops, const char *)
+		{
+			SDL_RWclose(&ops);
+			return true;
+		}
+	} probe;
+
+	shState->fileSystem().openRead(probe, filename.c_str());
+
+	SDL_LockMutex(mutex);
 
+	/* A preload might have finished in the meantime */
+	buffer = bufferHash.value(filename, 0);
+
+	if (buffer)
+	{
+		startPlayback(buffer, _volume, _pitch);
+		SDL_UnlockMutex(mutex);
+
+		return;
+	}
+
+	DecodeRequest *req = queueDecode(filename);
+
+	DecodeRequest::Play play = { _volume, _pitch };
+	req->plays.push_back(play);
+
+	if (!asyncDecode)
+	{
+		std::deque<DecodeRequest*>::iterator queued =
+			std::find(queue.begin(), queue.end(), req);
+
+		if (queued != queue.end())
+		{
+			/* Don't wait behind other queued sounds */
+			queue.erase(queued);
+			SDL_UnlockMutex(mutex);
+
+			SoundBuffer *decoded = 0;
+
+			try
+			{
+				decoded = decodeSound(filename);
+			}
+			catch (const Exception &e)
+			{
+				/* Gone since we checked */
+				Debug() << "Unable to decode sound:" << e.msg;
+			}
+
+			SDL_LockMutex(mutex);
+			finishDecode(req, decoded);
+		}
+		else
+		{
+			++req->waiters;
+
+			while (!req->done)
+				SDL_CondWait(doneCond, mutex);
+
+			if (--req->waiters == 0)
+				delete req;
+		}
+	}
+
+	SDL_UnlockMutex(mutex);
+#endif // MKXPZ_RETRO
+}
+
+void SoundEmitter::startPlayback(SoundBuffer *buffer, float volume, float pitch)
+{
 	/* Try to find first free source */
 	size_t i;
 	for (i = 0; i < srcCount; ++i)
@@ -184,16 +345,76 @@ void SoundEmitter::play(const std::string &filename,
 	if (switchBuffer)
 		AL::Source::attachBuffer(src, buffer->alBuffer);
 
-	AL::Source::setVolume(src, _volume);
-	AL::Source::setPitch(src, _pitch);
+	AL::Source::setVolume(src, volume);
+	AL::Source::setPitch(src, pitch);
 
 	AL::Source::play(src);
 }
 
 void SoundEmitter::stop()
 {
+#ifndef MKXPZ_RETRO
+	SDL_LockMutex(mutex);
+
+	/* Sounds still being decoded shouldn't start later */
+	BoostHash<std::string, DecodeRequest*>::const_iterator iter;
+	for (iter = decoding.cbegin(); iter != decoding.cend(); ++iter)
+		iter->second->plays.clear();
+#endif // MKXPZ_RETRO
+
 	for (size_t i = 0; i < srcCount; i++)
 		AL::Source::stop(alSrcs[i]);
+
+#ifndef MKXPZ_RETRO
+	SDL_UnlockMutex(mutex);
+#endif // MKXPZ_RETRO
+}
+
+void SoundEmitter::preload(const std::string &filename)
+{
+#ifdef MKXPZ_RETRO
+	allocateBuffer(filename);
+#else
+	SDL_LockMutex(mutex);
+
+	if (!bufferHash.contains(filename))
+		queueDecode(filename);
+
+	SDL_UnlockMutex(mutex);
+#endif // MKXPZ_RETRO
+}
+
+SoundCacheStats SoundEmitter::getStats()
+{
+#ifndef MKXPZ_RETRO
+	SDL_LockMutex(mutex);
+#endif // MKXPZ_RETRO
+
+	SoundCacheStats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.entries = buffers.getSize();
+	stats.bytes = bufferBytes;
+	stats.limit = bufferLimit;
+
+#ifndef MKXPZ_RETRO
+	SDL_UnlockMutex(mutex);
+#endif // MKXPZ_RETRO
+
+	return stats;
+}
+
+void SoundEmitter::resetStats()
+{
+#ifndef MKXPZ_RETRO
+	SDL_LockMutex(mutex);
+#endif // MKXPZ_RETRO
+
+	hits = misses = 0;
+
+#ifndef MKXPZ_RETRO
+	SDL_UnlockMutex(mutex);
+#endif // MKXPZ_RETRO
 }
 
 struct SoundOpenHandler : FileSystem::OpenHandler
@@ -276,72 +497,177 @@ struct SoundOpenHandler : FileSystem::OpenHandler
 	}
 };
 
-SoundBuffer *SoundEmitter::allocateBuffer(const std::string &filename)
+/* Returns 0 (after logging why) if the sound can't be decoded */
+static SoundBuffer *decodeSound(const std::string &filename)
 {
-	SoundBuffer *buffer = bufferHash.value(filename, 0);
-
-	if (buffer)
-	{
-		/* Buffer still in cashe.
-		 * Move to front of priority list */
-		buffers.remove(buffer->link);
-		buffers.append(buffer->link);
-
-		return buffer;
-	}
-	else
-	{
-		/* Buffer not in cache, needs to be loaded */
-		SoundOpenHandler handler;
+	SoundOpenHandler handler;
 #ifdef MKXPZ_RETRO
-		std::string path("/mkxp-retro-game/");
-		path.append(filename);
-		mkxp_retro::fs->openRead(handler, path.c_str()); // TODO: move into shState
+	std::string path("/mkxp-retro-game/");
+	path.append(filename);
+	mkxp_retro::fs->openRead(handler, path.c_str()); // TODO: move into shState
 #else
-		shState->fileSystem().openRead(handler, filename.c_str());
+	shState->fileSystem().openRead(handler, filename.c_str());
 #endif // MKXPZ_RETRO
-		buffer = handler.buffer;
 
-		if (!buffer)
-		{
-			char buf[512];
-			snprintf(
-				buf,
-				sizeof(buf),
-				"Unable to decode sound: %s: %s",
-				filename.c_str(),
+	if (!handler.buffer)
+	{
+		char buf[512];
+		snprintf(
+			buf,
+			sizeof(buf),
+			"Unable to decode sound: %s: %s",
+			filename.c_str(),
 #ifdef MKXPZ_RETRO
-				sf_error_number(handler.errnum)
+			sf_error_number(handler.errnum)
 #else
-			        Sound_GetError()
+		        Sound_GetError()
 #endif // MKXPZ_RETRO
-			);
-			Debug() << buf;
+		);
+		Debug() << buf;
 
-			return 0;
-		}
+		return 0;
+	}
 
-		buffer->key = filename;
-		uint32_t wouldBeBytes = bufferBytes + buffer->bytes;
+	handler.buffer->key = filename;
 
-		/* If memory limit is reached, delete lowest priority buffer
-		 * until there is room or no buffers left */
-		while (wouldBeBytes > SE_CACHE_MEM && !buffers.isEmpty())
-		{
-			SoundBuffer *last = buffers.tail();
-			bufferHash.remove(last->key);
-			buffers.remove(last->link);
+	return handler.buffer;
+}
 
-			wouldBeBytes -= last->bytes;
+SoundBuffer *SoundEmitter::lookupBuffer(const std::string &filename)
+{
+	SoundBuffer *buffer = bufferHash.value(filename, 0);
 
-			SoundBuffer::deref(last);
-		}
+	if (!buffer)
+	{
+		++misses;
+		return 0;
+	}
+
+	++hits;
+
+	/* Buffer still in cache.
+	 * Move to front of priority list */
+	buffers.remove(buffer->link);
+	buffers.prepend(buffer->link);
+
+	return buffer;
+}
+
+void SoundEmitter::cacheBuffer(SoundBuffer *buffer)
+{
+	/* Wide, as the limit may be close to UINT32_MAX */
+	uint64_t wouldBeBytes = (uint64_t) bufferBytes + buffer->bytes;
 
-		bufferHash.insert(filename, buffer);
-		buffers.prepend(buffer->link);
+	/* If memory limit is reached, delete lowest priority buffer
+	 * until there is room or no buffers left */
+	while (wouldBeBytes > bufferLimit && !buffers.isEmpty())
+	{
+		SoundBuffer *last = buffers.tail();
+		bufferHash.remove(last->key);
+		buffers.remove(last->link);
+
+		wouldBeBytes -= last->bytes;
 
-		bufferBytes = wouldBeBytes;
+		SoundBuffer::deref(last);
+	}
+
+	bufferHash.insert(buffer->key, buffer);
+	buffers.prepend(buffer->link);
+
+	bufferBytes = wouldBeBytes;
+}
+
+#ifdef MKXPZ_RETRO
+SoundBuffer *SoundEmitter::allocateBuffer(const std::string &filename)
+{
+	SoundBuffer *buffer = lookupBuffer(filename);
 
+	if (buffer)
 		return buffer;
+
+	/* Buffer not in cache, needs to be loaded */
+	buffer = decodeSound(filename);
+
+	if (buffer)
+		cacheBuffer(buffer);
+
+	return buffer;
+}
+#else
+SoundEmitter::DecodeRequest *SoundEmitter::queueDecode(const std::string &filename)
+{
+	DecodeRequest *req = decoding.value(filename, 0);
+
+	if (req)
+		return req;
+
+	req = new DecodeRequest;
+	req->filename = filename;
+	req->done = false;
+	req->waiters = 0;
+
+	decoding.insert(filename, req);
+	queue.push_back(req);
+
+	SDL_CondSignal(workCond);
+
+	return req;
+}
+
+void SoundEmitter::finishDecode(DecodeRequest *req, SoundBuffer *buffer)
+{
+	decoding.remove(req->filename);
+
+	if (buffer)
+	{
+		cacheBuffer(buffer);
+
+		for (size_t i = 0; i < req->plays.size(); ++i)
+			startPlayback(buffer, req->plays[i].volume, req->plays[i].pitch);
 	}
+
+	req->done = true;
+	SDL_CondBroadcast(doneCond);
+
+	if (req->waiters == 0)
+		delete req;
+}
+
+void SoundEmitter::workerMain()
+{
+	SDL_LockMutex(mutex);
+
+	while (true)
+	{
+		while (!quit && queue.empty())
+			SDL_CondWait(workCond, mutex);
+
+		if (quit)
+			break;
+
+		DecodeRequest *req = queue.front();
+		queue.pop_front();
+
+		SDL_UnlockMutex(mutex);
+
+		SoundBuffer *buffer = 0;
+
+		try
+		{
+			buffer = decodeSound(req->filename);
+		}
+		catch (const Exception &e)
+		{
+			/* Only preloads get here, plays check
+			 * for the file beforehand */
+			Debug() << "Unable to preload sound:" << e.msg;
+		}
+
+		SDL_LockMutex(mutex);
+
+		finishDecode(req, buffer);
+	}
+
+	SDL_UnlockMutex(mutex);
 }
+#endif // MKXPZ_RETRO
@@ -28,20 +28,42 @@
 
 #include <string>
 #include <vector>
+#ifndef MKXPZ_RETRO
+#include <deque>
+#endif // MKXPZ_RETRO
 
 struct SoundBuffer;
 struct Config;
+#ifndef MKXPZ_RETRO
+struct SDL_Thread;
+struct SDL_mutex;
+struct SDL_cond;
+#endif // MKXPZ_RETRO
+
+struct SoundCacheStats
+{
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t entries;
+	uint32_t bytes;
+	uint32_t limit;
+};
 
 struct SoundEmitter
 {
 	typedef BoostHash<std::string, SoundBuffer*> BufferHash;
 
+	/* Most recently used first */
 	IntruList<SoundBuffer> buffers;
 	BufferHash bufferHash;
 
 	/* Byte count sum of all cached / playing buffers */
 	uint32_t bufferBytes;
 
+	/* Least recently used buffers are dropped
+	 * from the cache beyond this */
+	uint32_t bufferLimit;
+
 	const size_t srcCount;
 	std::vector<AL::Source::ID> alSrcs;
 	std::vector<SoundBuffer*> atchBufs;
@@ -56,14 +78,56 @@ struct SoundEmitter
 #endif // MKXPZ_RETRO
 	~SoundEmitter();
 
+	/* If the sound isn't cached yet, it is decoded in the
+	 * background and starts playing once that is done
+	 * (unless decoding asynchronously is disabled) */
 	void play(const std::string &filename,
 	          int volume,
 	          int pitch);
 
 	void stop();
 
+	/* Decodes 'filename' in the background so that a later
+	 * 'play()' finds it in the cache. Missing or broken
+	 * files are only logged */
+	void preload(const std::string &filename);
+
+	SoundCacheStats getStats();
+	void resetStats();
+
 private:
+	void startPlayback(SoundBuffer *buffer, float volume, float pitch);
+	void cacheBuffer(SoundBuffer *buffer);
+	SoundBuffer *lookupBuffer(const std::string &filename);
+
+	uint32_t hits;
+	uint32_t misses;
+
+#ifdef MKXPZ_RETRO
 	SoundBuffer *allocateBuffer(const std::string &filename);
+#else
+	struct DecodeRequest;
+
+	DecodeRequest *queueDecode(const std::string &filename);
+	void finishDecode(DecodeRequest *req, SoundBuffer *buffer);
+	void workerMain();
+
+	std::deque<DecodeRequest*> queue;
+
+	/* Requests that are queued or being decoded */
+	BoostHash<std::string, DecodeRequest*> decoding;
+
+	std::vector<SDL_Thread*> workers;
+
+	/* Guards everything above, as finished
+	 * decodes start playing from the workers */
+	SDL_mutex *mutex;
+	SDL_cond *workCond;
+	SDL_cond *doneCond;
+
+	bool asyncDecode;
+	bool quit;
+#endif // MKXPZ_RETRO
 };
 
 #endif // SOUNDEMITTER_H
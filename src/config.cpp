@@ -169,6 +169,11 @@ void Config::read(int argc, char *argv[]) {
         {"integerScalingActive", false},
         {"integerScalingLastMile", true},
         {"maxTextureSize", 0},
+        {"prepareThreads", 0},
+        {"textCacheSize", 256},
+        {"decodeThreads", 0},
+        {"frameProfiler", false},
+        {"spriteBatching", true},
         {"gameFolder", ""},
         {"anyAltToggleFS", false},
         {"enableReset", true},
@@ -181,10 +186,18 @@ void Config::read(int argc, char *argv[]) {
         {"midiSoundFont", ""},
         {"midiChorus", false},
         {"midiReverb", false},
+        {"midiPrerender", false},
+        {"midiCacheSize", 2048},
         {"SESourceCount", 6},
+        {"SECacheSize", 10},
+        {"SEAsyncDecode", true},
         {"BGMTrackCount", 1},
         {"customScript", ""},
         {"pathCache", true},
+        {"pathCacheSnapshot", false},
+        {"imageCache", false},
+        {"imageCacheSize", 1024},
+        {"shaderCache", true},
         {"useScriptNames", true},
         {"preloadScript", json::array({})},
         {"postloadScript", json::array({})},
@@ -245,6 +258,10 @@ try { exp } catch (...) {}
     SET_STRINGOPT(execName, execName);
     SET_OPT(allowSymlinks, boolean);
     SET_OPT(pathCache, boolean);
+    SET_OPT(pathCacheSnapshot, boolean);
+    SET_OPT(imageCache, boolean);
+    SET_OPT(imageCacheSize, integer);
+    SET_OPT(shaderCache, boolean);
     SET_OPT_CUSTOMKEY(jit.enabled, JITEnable, boolean);
     SET_OPT_CUSTOMKEY(jit.verboseLevel, JITVerboseLevel, integer);
     SET_OPT_CUSTOMKEY(jit.maxCache, JITMaxCache, integer);
@@ -304,13 +321,22 @@ try { exp } catch (...) {}
     SET_OPT_CUSTOMKEY(integerScaling.active, integerScalingActive, boolean);
     SET_OPT_CUSTOMKEY(integerScaling.lastMileScaling, integerScalingLastMile, boolean);
     SET_OPT(maxTextureSize, integer);
+    SET_OPT(prepareThreads, integer);
+    SET_OPT(textCacheSize, integer);
+    SET_OPT(decodeThreads, integer);
+    SET_OPT(frameProfiler, boolean);
+    SET_OPT(spriteBatching, boolean);
     SET_OPT(anyAltToggleFS, boolean);
     SET_OPT(enableReset, boolean);
     SET_OPT(enableSettings, boolean);
     SET_STRINGOPT(midi.soundFont, midiSoundFont);
     SET_OPT_CUSTOMKEY(midi.chorus, midiChorus, boolean);
     SET_OPT_CUSTOMKEY(midi.reverb, midiReverb, boolean);
+    SET_OPT_CUSTOMKEY(midi.prerender, midiPrerender, boolean);
+    SET_OPT_CUSTOMKEY(midi.cacheSize, midiCacheSize, integer);
     SET_OPT_CUSTOMKEY(SE.sourceCount, SESourceCount, integer);
+    SET_OPT_CUSTOMKEY(SE.cacheSize, SECacheSize, integer);
+    SET_OPT_CUSTOMKEY(SE.asyncDecode, SEAsyncDecode, boolean);
     SET_OPT_CUSTOMKEY(BGM.trackCount, BGMTrackCount, integer);
     SET_STRINGOPT(customScript, customScript);
     SET_OPT(useScriptNames, boolean);
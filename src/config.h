@@ -71,6 +71,11 @@ struct Config {
     bool subImageFix;
     bool enableBlitting;
     int maxTextureSize;
+    int prepareThreads;
+    int textCacheSize;
+    int decodeThreads;
+    bool frameProfiler;
+    bool spriteBatching;
     
     struct {
         bool active;
@@ -85,6 +90,10 @@ struct Config {
     bool enableSettings;
     bool allowSymlinks;
     bool pathCache;
+    bool pathCacheSnapshot;
+    bool imageCache;
+    int imageCacheSize;
+    bool shaderCache;
     
     std::string dataPathOrg;
     std::string dataPathApp;
@@ -97,10 +106,14 @@ struct Config {
         std::string soundFont;
         bool chorus;
         bool reverb;
+        bool prerender;
+        int cacheSize;
     } midi;
     
     struct {
         int sourceCount;
+        int cacheSize;
+        bool asyncDecode;
     } SE;
     
     struct {
@@ -34,6 +34,9 @@
 #include "binding-sandbox.h"
 #include "core.h"
 #include "filesystem.h"
+#include "sharedstate.h"
+#include "scene.h"
+#include "softraster.h"
 
 using namespace mkxp_retro;
 using namespace mkxp_sandbox;
@@ -265,6 +268,15 @@ static bool init_sandbox() {
     return true;
 }
 
+static void render_frame() {
+    SoftRaster &raster = shState->softRaster();
+    raster.bind(frame_buf, softFrameWidth, softFrameHeight, softFrameWidth);
+    raster.clear();
+
+    shState->prepareDraw();
+    shState->screen()->composite();
+}
+
 extern "C" RETRO_API void retro_set_environment(retro_environment_t cb) {
     environment = cb;
 
@@ -312,7 +324,7 @@ extern "C" RETRO_API void retro_set_input_state(retro_input_state_t cb) {
 }
 
 extern "C" RETRO_API void retro_init() {
-    frame_buf = (uint32_t *)std::calloc(640 * 480, sizeof *frame_buf);
+    frame_buf = (uint32_t *)std::calloc(softFrameWidth * softFrameHeight, sizeof *frame_buf);
     sound_buf = (int16_t *)malloc_align(16, 735 * 2 * sizeof *sound_buf);
 }
 
@@ -341,11 +353,11 @@ extern "C" RETRO_API void retro_get_system_av_info(struct retro_system_av_info *
         .sample_rate = 44100.0,
     };
     info->geometry = {
-        .base_width = 640,
-        .base_height = 480,
-        .max_width = 640,
-        .max_height = 480,
-        .aspect_ratio = 640.0f / 480.0f,
+        .base_width = softFrameWidth,
+        .base_height = softFrameHeight,
+        .max_width = softFrameWidth,
+        .max_height = softFrameHeight,
+        .aspect_ratio = (float)softFrameWidth / (float)softFrameHeight,
     };
 }
 
@@ -372,9 +384,11 @@ extern "C" RETRO_API void retro_run() {
             deinit_sandbox();
             return;
         }
+
+        render_frame();
     }
 
-    video_refresh(frame_buf, 640, 480, 640 * 4);
+    video_refresh(frame_buf, softFrameWidth, softFrameHeight, softFrameWidth * sizeof *frame_buf);
 
     if (mkxp_retro::sandbox.has_value()) {
         audio->render();
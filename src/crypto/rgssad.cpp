@@ -26,6 +26,22 @@
 #include <string.h>
 
 #include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define RGSSAD_SSE2
+#endif
 
 /* Equivalent Linear Congruential Generator (LCG) constants for iteration 2^n
  * all the way up to 2^32/4 (the largest dword offset possible in
@@ -60,30 +76,200 @@ struct RGSS_entryData
 	uint32_t startMagic;
 };
 
+/* Read-only mapping of a whole archive file. Entries of mapped
+ * archives are decrypted straight from it into the caller's
+ * buffer, without any syscalls */
+struct RGSS_mapping
+{
+	const uint8_t *data;
+	uint64_t size;
+
+#ifdef _WIN32
+	HANDLE mapHandle;
+#endif
+
+	RGSS_mapping()
+	    : data(0),
+	      size(0)
+	{}
+};
+
+static void
+unmapArchive(RGSS_mapping &map)
+{
+	if (!map.data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(map.data);
+	CloseHandle(map.mapHandle);
+#else
+	munmap(const_cast<uint8_t*>(map.data), map.size);
+#endif
+
+	map.data = 0;
+	map.size = 0;
+}
+
+/* 'path' is only a hint (archives nested in other archives
+ * have no real file); the mapping is used if it matches the
+ * size and header of what 'io' reads */
+static void
+mapArchive(RGSS_mapping &map, const char *path, PHYSFS_Io *io)
+{
+	PHYSFS_sint64 length = io->length(io);
+
+	if (!path || length <= 0 || (uint64_t) length != (size_t) length)
+		return;
+
+#ifdef _WIN32
+	int wlen = MultiByteToWideChar(CP_UTF8, 0, path, -1, 0, 0);
+	std::vector<wchar_t> wpath(wlen > 0 ? wlen : 1);
+
+	if (wlen <= 0 || !MultiByteToWideChar(CP_UTF8, 0, path, -1, &wpath[0], wlen))
+		return;
+
+	HANDLE file = CreateFileW(&wpath[0], GENERIC_READ, FILE_SHARE_READ, 0,
+	                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart != length)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	/* The mapping keeps the file open on its own */
+	HANDLE mapHandle = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(file);
+
+	if (!mapHandle)
+		return;
+
+	void *data = MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		CloseHandle(mapHandle);
+		return;
+	}
+
+	map.mapHandle = mapHandle;
+#else
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return;
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size != length)
+	{
+		close(fd);
+		return;
+	}
+
+	void *data = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return;
+#endif
+
+	map.data = static_cast<const uint8_t*>(data);
+	map.size = length;
+
+	/* Make sure we mapped the file 'io' is reading */
+	char header[8];
+	PHYSFS_sint64 pos = io->tell(io);
+
+	bool same = io->seek(io, 0) &&
+	            io->read(io, header, sizeof(header)) == sizeof(header) &&
+	            memcmp(header, map.data, sizeof(header)) == 0;
+
+	io->seek(io, pos);
+
+	if (!same)
+	{
+		unmapArchive(map);
+		return;
+	}
+}
+
+/* Decrypted data is read ahead in blocks of this size,
+ * so that small sequential reads (eg. by image and audio
+ * decoders) don't each cost a syscall */
+#define READ_AHEAD_SIZE (64 * 1024)
+
 struct RGSS_entryHandle
 {
 	const RGSS_entryData data;
-	uint32_t currentMagic;
 	uint64_t currentOffset;
+
+	/* Encrypted entry data within the archive mapping,
+	 * 0 if the archive isn't mapped */
+	const uint8_t *mapped;
+
+	/* Only opened when not mapped */
 	PHYSFS_Io *io;
 
-	RGSS_entryHandle(const RGSS_entryData &data, PHYSFS_Io *archIo)
+	/* Position of 'io' relative to the archive start,
+	 * so we only seek when reads aren't sequential */
+	uint64_t ioOffset;
+
+	/* Decrypted bytes [bufOffset, bufOffset + bufSize) */
+	std::vector<uint8_t> buf;
+	uint64_t bufOffset;
+	uint64_t bufSize;
+
+	RGSS_entryHandle(const RGSS_entryData &data, PHYSFS_Io *archIo,
+	                 const RGSS_mapping &map)
 	    : data(data),
-	      currentMagic(data.startMagic),
-	      currentOffset(0)
+	      currentOffset(0),
+	      mapped(0),
+	      io(0),
+	      ioOffset(UINT64_MAX),
+	      bufOffset(0),
+	      bufSize(0)
+	{
+		if (map.data && data.offset >= 0 && (uint64_t) data.offset <= map.size &&
+		    data.size <= map.size - data.offset)
+			mapped = map.data + data.offset;
+		else
+			io = archIo->duplicate(archIo);
+	}
+
+	RGSS_entryHandle(const RGSS_entryHandle &other)
+	    : data(other.data),
+	      currentOffset(other.currentOffset),
+	      mapped(other.mapped),
+	      io(0),
+	      ioOffset(UINT64_MAX),
+	      bufOffset(0),
+	      bufSize(0)
 	{
-		io = archIo->duplicate(archIo);
+		if (other.io)
+			io = other.io->duplicate(other.io);
 	}
 
 	~RGSS_entryHandle()
 	{
-		io->destroy(io);
+		if (io)
+			io->destroy(io);
 	}
+
+private:
+	RGSS_entryHandle &operator=(const RGSS_entryHandle &);
 };
 
 struct RGSS_archiveData
 {
 	PHYSFS_Io *archiveIo;
+	RGSS_mapping map;
 
 	/* Maps: file path
 	 * to:   entry data */
@@ -142,100 +328,222 @@ advanceMagicN(uint32_t &magic, uint32_t n) {
     return old;
 }
 
-static PHYSFS_sint64
-RGSS_ioRead(PHYSFS_Io *self, void *buffer, PHYSFS_uint64 len)
+#ifdef RGSSAD_SSE2
+/* SSE2 lacks a 32 bit lane multiply (pmulld is SSE4.1) */
+static inline __m128i
+mul32(__m128i a, __m128i b)
 {
-	RGSS_entryHandle *entry = static_cast<RGSS_entryHandle*>(self->opaque);
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
 
-	PHYSFS_Io *io = entry->io;
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+	                          _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
 
-	uint64_t toRead = std::min<uint64_t>(entry->data.size - entry->currentOffset, len);
-	uint64_t offs = entry->currentOffset;
-
-	io->seek(io, entry->data.offset + offs);
-
-	/* We divide up the bytes to be read in 3 categories:
-	 *
-	 * preAlign: If the current read address is not dword
-	 *   aligned, this is the number of bytes to read til
-	 *   we reach alignment again (therefore can only be
-	 *   3 or less).
-	 *
-	 * align: The number of aligned dwords we can read
-	 *   times 4 (= number of bytes).
-	 *
-	 * postAlign: The number of bytes to read after the
-	 *   last aligned dword. Always 3 or less.
-	 *
-	 * Treating the pre- and post aligned reads specially,
-	 * we can read all aligned dwords in one syscall directly
-	 * into the write buffer and then run the xor chain on
-	 * it afterwards. */
-
-	uint8_t preAlign = 4 - (offs % 4);
-
-	if (preAlign == 4)
-		preAlign = 0;
-	else
-		preAlign = std::min<uint64_t>(preAlign, len);
+/* Xors 'size' bytes of little endian dwords with the key stream
+ * starting at 'magic'. Instead of walking the LCG one step at a
+ * time, a number of consecutive magics are computed up front and
+ * each of them then jumps ahead by that number of steps using the
+ * LCG_TABLE constants, which keeps the lanes independent */
+static void
+decryptDwords(uint8_t *dest, const uint8_t *src, uint64_t size, uint32_t magic)
+{
+	uint64_t i = 0;
 
-	uint8_t postAlign = (len > preAlign) ? (offs + len) % 4 : 0;
+#ifdef RGSSAD_SSE2
+	uint32_t init[4];
 
-	uint64_t align = len - (preAlign + postAlign);
+	for (int k = 0; k < 4; ++k)
+		init[k] = advanceMagic(magic);
 
-	/* Byte buffer pointer */
-	uint8_t *bBufferP = static_cast<uint8_t*>(buffer);
+	/* Jump 4 = 2^2 steps */
+	const __m128i mul = _mm_set1_epi32((int) LCG_TABLE[2][0]);
+	const __m128i add = _mm_set1_epi32((int) LCG_TABLE[2][1]);
+	__m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(init));
 
-	if (preAlign > 0)
+	for (; i + 16 <= size; i += 16)
 	{
-		uint32_t dword;
-		io->read(io, &dword, preAlign);
+		__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
 
-		/* Need to align the bytes with the
-		 * magic before xoring */
-		dword <<= 8 * (offs % 4);
-		dword ^= entry->currentMagic;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_xor_si128(in, lanes));
+		lanes = _mm_add_epi32(mul32(lanes, mul), add);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(init), lanes);
+	magic = init[0];
+#else
+	uint32_t lanes[8];
+
+	for (int k = 0; k < 8; ++k)
+		lanes[k] = advanceMagic(magic);
+
+	/* Jump 8 = 2^3 steps */
+	for (; i + 32 <= size; i += 32)
+	{
+		uint32_t block[8];
+		memcpy(block, src + i, sizeof(block));
 
-		/* Shift them back to normal */
-		dword >>= 8 * (offs % 4);
-		memcpy(bBufferP, &dword, preAlign);
+		for (int k = 0; k < 8; ++k)
+		{
+			block[k] ^= lanes[k];
+			lanes[k] = lanes[k] * LCG_TABLE[3][0] + LCG_TABLE[3][1];
+		}
+
+		memcpy(dest + i, block, sizeof(block));
+	}
 
-		bBufferP += preAlign;
+	magic = lanes[0];
+#endif
 
-		/* Only advance the magic if we actually
-		 * reached the next alignment */
-		if ((offs+preAlign) % 4 == 0)
-			advanceMagic(entry->currentMagic);
+	for (; i + 4 <= size; i += 4)
+	{
+		uint32_t dword;
+		memcpy(&dword, src + i, 4);
+		dword ^= advanceMagic(magic);
+		memcpy(dest + i, &dword, 4);
 	}
 
-	if (align > 0)
+	/* Trailing bytes of an entry not ending on a dword */
+	for (int k = 0; i < size; ++i, ++k)
+		dest[i] = src[i] ^ ((magic >> (8 * k)) & 0xFF);
+}
+
+/* Decrypts bytes [offset, offset + size) of the entry whose
+ * (encrypted) data starts at 'entrySrc' into 'dest' */
+static void
+decryptRange(uint8_t *dest, const uint8_t *entrySrc, uint64_t offset,
+             uint64_t size, uint32_t startMagic)
+{
+	uint32_t magic = startMagic;
+	advanceMagicN(magic, (uint32_t) (offset / 4));
+
+	/* Bytes before the next dword boundary */
+	while (size > 0 && offset % 4 != 0)
 	{
-		/* Double word buffer pointer */
-		uint32_t *dwBufferP = reinterpret_cast<uint32_t*>(bBufferP);
+		*dest++ = entrySrc[offset] ^ ((magic >> (8 * (offset % 4))) & 0xFF);
+		--size;
 
-		/* Read aligned dwords in one go */
-		io->read(io, bBufferP, align);
+		if (++offset % 4 == 0)
+			advanceMagic(magic);
+	}
 
-		/* Then xor them */
-		for (uint64_t i = 0; i < (align / 4); ++i)
-			dwBufferP[i] ^= advanceMagic(entry->currentMagic);
+	decryptDwords(dest, entrySrc + offset, size, magic);
+}
 
-		bBufferP += align;
+/* Reads 'size' raw bytes at 'offset' of the entry */
+static bool
+readRaw(RGSS_entryHandle *entry, uint64_t offset, void *dest, uint64_t size)
+{
+	PHYSFS_Io *io = entry->io;
+
+	if (entry->ioOffset != entry->data.offset + offset)
+	{
+		if (!io->seek(io, entry->data.offset + offset))
+		{
+			entry->ioOffset = UINT64_MAX;
+			return false;
+		}
 	}
 
-	if (postAlign > 0)
+	PHYSFS_sint64 count = io->read(io, dest, size);
+
+	if (count != (PHYSFS_sint64) size)
 	{
-		uint32_t dword;
-		io->read(io, &dword, postAlign);
+		entry->ioOffset = UINT64_MAX;
+		return false;
+	}
+
+	entry->ioOffset = entry->data.offset + offset + size;
+
+	return true;
+}
 
-		/* Bytes are already aligned with magic */
-		dword ^= entry->currentMagic;
-		memcpy(bBufferP, &dword, postAlign);
+/* Reads and decrypts a block of the entry, starting at the dword
+ * containing 'offset', into the read ahead buffer */
+static bool
+fillBuffer(RGSS_entryHandle *entry, uint64_t offset)
+{
+	const uint64_t start = offset & ~(uint64_t) 3;
+	const uint64_t size = std::min<uint64_t>(READ_AHEAD_SIZE, entry->data.size - start);
+
+	entry->buf.resize(READ_AHEAD_SIZE);
+	entry->bufSize = 0;
+
+	if (!readRaw(entry, start, &entry->buf[0], size))
+		return false;
+
+	uint32_t magic = entry->data.startMagic;
+	advanceMagicN(magic, (uint32_t) (start / 4));
+
+	decryptDwords(&entry->buf[0], &entry->buf[0], size, magic);
+
+	entry->bufOffset = start;
+	entry->bufSize = size;
+
+	return true;
+}
+
+static PHYSFS_sint64
+RGSS_ioRead(PHYSFS_Io *self, void *buffer, PHYSFS_uint64 len)
+{
+	RGSS_entryHandle *entry = static_cast<RGSS_entryHandle*>(self->opaque);
+
+	uint64_t toRead = std::min<uint64_t>(entry->data.size - entry->currentOffset, len);
+	uint64_t remaining = toRead;
+
+	/* Byte buffer pointer */
+	uint8_t *bBufferP = static_cast<uint8_t*>(buffer);
+
+	if (entry->mapped)
+	{
+		decryptRange(bBufferP, entry->mapped, entry->currentOffset,
+		             toRead, entry->data.startMagic);
+
+		entry->currentOffset += toRead;
+
+		return toRead;
 	}
 
-	entry->currentOffset += toRead;
+	while (remaining > 0)
+	{
+		const uint64_t offs = entry->currentOffset;
+		uint64_t count;
 
-	return toRead;
+		if (offs >= entry->bufOffset && offs < entry->bufOffset + entry->bufSize)
+		{
+			/* Served from the read ahead buffer */
+			count = std::min<uint64_t>(remaining, entry->bufOffset + entry->bufSize - offs);
+			memcpy(bBufferP, &entry->buf[offs - entry->bufOffset], count);
+		}
+		else if (offs % 4 == 0 && remaining >= READ_AHEAD_SIZE)
+		{
+			/* Large aligned reads go straight into
+			 * the caller's buffer, in one syscall */
+			count = remaining & ~(uint64_t) 3;
+
+			if (!readRaw(entry, offs, bBufferP, count))
+				break;
+
+			uint32_t magic = entry->data.startMagic;
+			advanceMagicN(magic, (uint32_t) (offs / 4));
+
+			decryptDwords(bBufferP, bBufferP, count, magic);
+		}
+		else
+		{
+			if (!fillBuffer(entry, offs))
+				break;
+
+			continue;
+		}
+
+		bBufferP += count;
+		remaining -= count;
+		entry->currentOffset += count;
+	}
+
+	return toRead - remaining;
 }
 
 static int
@@ -249,22 +557,9 @@ RGSS_ioSeek(PHYSFS_Io *self, PHYSFS_uint64 offset)
 	if (offset > entry->data.size-1)
 		return 0;
 
-	/* If rewinding, we need to rewind to begining */
-	if (offset < entry->currentOffset)
-	{
-		entry->currentOffset = 0;
-		entry->currentMagic = entry->data.startMagic;
-	}
-
-	/* For each overstepped alignment, advance magic */
-	uint64_t currentDword = entry->currentOffset / 4;
-	uint64_t targetDword  = offset / 4;
-	uint64_t dwordsSought = targetDword - currentDword;
-
-	advanceMagicN(entry->currentMagic, (uint32_t) dwordsSought);
-
+	/* The key stream position is derived from the
+	 * offset on every read, so nothing else to do */
 	entry->currentOffset = offset;
-	entry->io->seek(entry->io, entry->data.offset + entry->currentOffset);
 
 	return 1;
 }
@@ -376,7 +671,7 @@ verifyHeader(PHYSFS_Io *io, char version)
 }
 
 static void*
-RGSS_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
+RGSS_openArchive(PHYSFS_Io *io, const char *name, int forWrite, int *claimed)
 {
 	if (forWrite)
 		return NULL;
@@ -407,11 +702,13 @@ RGSS_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 		nameLen ^= advanceMagic(magic);
 
 		static char nameBuf[512];
+
+		if (nameLen >= sizeof(nameBuf) || !IO_READ(io, nameBuf, nameLen))
+			break;
+
 		for (uint32_t i = 0; i < nameLen; ++i)
 		{
-			char c;
-			io->read(io, &c, 1);
-			nameBuf[i] = c ^ (advanceMagic(magic) & 0xFF);
+			nameBuf[i] ^= advanceMagic(magic) & 0xFF;
 			if (nameBuf[i] == '\\')
 				nameBuf[i] = '/';
 		}
@@ -433,6 +730,8 @@ RGSS_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 		io->seek(io, entry.offset + entry.size);
 	}
 
+	mapArchive(data->map, name, io);
+
 	return data;
 }
 
@@ -466,7 +765,7 @@ RGSS_openRead(void *opaque, const char *filename)
 		return 0;
 
 	RGSS_entryHandle *entry =
-	        new RGSS_entryHandle(data->entryHash[filename], data->archiveIo);
+	        new RGSS_entryHandle(data->entryHash[filename], data->archiveIo, data->map);
 
 	PHYSFS_Io *io = PHYSFS_ALLOC(PHYSFS_Io);
 
@@ -516,6 +815,8 @@ RGSS_closeArchive(void *opaque)
 {
 	RGSS_archiveData *data = static_cast<RGSS_archiveData*>(opaque);
 
+	unmapArchive(data->map);
+
 	delete data;
 }
 
@@ -585,7 +886,7 @@ readUint32AndXor(PHYSFS_Io *io, uint32_t &result, uint32_t key)
 }
 
 static void*
-RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
+RGSS3_openArchive(PHYSFS_Io *io, const char *name, int forWrite, int *claimed)
 {
 	if (forWrite)
 		return NULL;
@@ -659,6 +960,8 @@ RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 		return NULL;
 	}
 
+	mapArchive(data->map, name, io);
+
 	return data;
 }
 
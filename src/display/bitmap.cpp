@@ -43,10 +43,17 @@
 #ifndef MKXPZ_RETRO
 #include "texpool.h"
 #include "shader.h"
-#include "filesystem.h"
 #endif // MKXPZ_RETRO
+#include "filesystem.h"
 #include "font.h"
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+#include "softraster.h"
+#include "softpng.h"
+#else
+#include "glyphcache.h"
+#include "textruncache.h"
+#include "imagedecoder.h"
+#include "imagecache.h"
 #include "eventthread.h"
 #endif // MKXPZ_RETRO
 #include "graphics.h"
@@ -60,7 +67,9 @@
 #include "sigslot/signal.hpp"
 
 #include <math.h>
+#include <limits.h>
 #include <algorithm>
+#include <vector>
 
 extern "C" {
 #include "libnsgif/libnsgif.h"
@@ -89,6 +98,10 @@ throw Exception(Exception::MKXPError, \
 
 #define OUTLINE_SIZE 1
 
+/* Granularity at which the getPixel cache
+ * is invalidated and read back */
+#define READBACK_TILE 64
+
 /* Normalize (= ensure width and
  * height are positive) */
 static IntRect normalizedRect(const IntRect &rect)
@@ -232,7 +245,11 @@ struct BitmapPrivate
     
     sigslot::connection prepareCon;
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    /* Pixels live in client memory and are
+     * composited by SoftRaster */
+    SoftSurface soft;
+#else
     TEXFBO gl;
 #endif // MKXPZ_RETRO
     
@@ -245,10 +262,14 @@ struct BitmapPrivate
     SDL_Surface *megaSurface;
     
     /* A cached version of the bitmap in client memory, for
-     * getPixel calls. Is invalidated any time the bitmap
-     * is modified */
+     * getPixel calls. Modifications mark the READBACK_TILE
+     * sized tiles they touch as stale, and only those are
+     * read back again when their pixels are asked for */
     SDL_Surface *surface;
 #ifndef MKXPZ_RETRO
+    std::vector<bool> staleTiles;
+    size_t staleTileCount;
+
     SDL_PixelFormat *format;
     
     /* The 'tainted' area describes which parts of the
@@ -273,6 +294,10 @@ struct BitmapPrivate
     surface(0),
     assumingRubyGC(false)
     {
+#ifndef MKXPZ_RETRO
+        staleTileCount = 0;
+#endif // MKXPZ_RETRO
+
 #ifndef MKXPZ_RETRO
         format = SDL_AllocFormat(SDL_PIXELFORMAT_ABGR8888);
 #endif // MKXPZ_RETRO
@@ -440,7 +465,9 @@ struct BitmapPrivate
     {
         bindFBO();
         
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+        SoftRaster::fill(soft, normalizedRect(rect), softPackColor(color));
+#else
         glState.scissorTest.pushSet(true);
         glState.scissorBox.pushSet(normalizedRect(rect));
         glState.clearColor.pushSet(color);
@@ -465,21 +492,215 @@ struct BitmapPrivate
     }
 #endif // MKXPZ_RETRO
     
-    void onModified(bool freeSurface = true)
+#ifndef MKXPZ_RETRO
+    int readbackTilesX() const
+    {
+        return (gl.width + READBACK_TILE - 1) / READBACK_TILE;
+    }
+    
+    int readbackTilesY() const
+    {
+        return (gl.height + READBACK_TILE - 1) / READBACK_TILE;
+    }
+    
+    /* Clips 'rect' to the bitmap and converts it to a
+     * range of readback tiles. Returns false if empty */
+    bool readbackTileRange(const IntRect &rect, IntRect &tiles) const
+    {
+        IntRect norm = normalizedRect(rect);
+        
+        int x1 = std::max(norm.x, 0);
+        int y1 = std::max(norm.y, 0);
+        int x2 = std::min(norm.x + norm.w, gl.width);
+        int y2 = std::min(norm.y + norm.h, gl.height);
+        
+        if (x1 >= x2 || y1 >= y2)
+            return false;
+        
+        tiles.x = x1 / READBACK_TILE;
+        tiles.y = y1 / READBACK_TILE;
+        tiles.w = (x2 - 1) / READBACK_TILE - tiles.x + 1;
+        tiles.h = (y2 - 1) / READBACK_TILE - tiles.y + 1;
+        
+        return true;
+    }
+    
+    void freeSurface()
+    {
+        if (!surface)
+            return;
+        
+        SDL_FreeSurface(surface);
+        surface = 0;
+        
+        staleTiles.clear();
+        staleTileCount = 0;
+    }
+    
+    void markSurfaceStale(const IntRect &rect)
+    {
+        IntRect tiles;
+        
+        if (!surface || !readbackTileRange(rect, tiles))
+            return;
+        
+        for (int ty = tiles.y; ty < tiles.y + tiles.h; ++ty)
+            for (int tx = tiles.x; tx < tiles.x + tiles.w; ++tx)
+            {
+                std::vector<bool>::reference stale = staleTiles[ty * readbackTilesX() + tx];
+                
+                if (stale)
+                    continue;
+                
+                stale = true;
+                ++staleTileCount;
+            }
+        
+        /* Reading everything back later costs the same,
+         * and we don't hold on to the memory meanwhile */
+        if (staleTileCount == staleTiles.size())
+            freeSurface();
+    }
+    
+    /* Brings the part of 'surface' covered by 'rect' up to
+     * date, reading stale tiles back from the texture */
+    void readbackSurface(const IntRect &rect)
     {
-        if (surface && freeSurface)
+        if (!surface)
         {
+            allocSurface();
+            
+            if (!surface)
+                throw Exception(Exception::SDLError, "Error creating readback surface: %s", SDL_GetError());
+            
+            staleTiles.assign(readbackTilesX() * readbackTilesY(), true);
+            staleTileCount = staleTiles.size();
+        }
+        
+        IntRect tiles;
+        
+        if (staleTileCount == 0 || !readbackTileRange(rect, tiles))
+            return;
+        
+        FBO::bind(gl.fbo);
+        glState.viewport.pushSet(IntRect(0, 0, gl.width, gl.height));
+        
+        const int tilesX = readbackTilesX();
+        std::vector<uint8_t> buffer;
+        
+        for (int ty = tiles.y; ty < tiles.y + tiles.h; ++ty)
+        {
+            int tx = tiles.x;
+            
+            while (tx < tiles.x + tiles.w)
+            {
+                if (!staleTiles[ty * tilesX + tx])
+                {
+                    ++tx;
+                    continue;
+                }
+                
+                /* Read runs of adjacent stale tiles in one go */
+                int runStart = tx;
+                
+                while (tx < tiles.x + tiles.w && staleTiles[ty * tilesX + tx])
+                {
+                    staleTiles[ty * tilesX + tx] = false;
+                    --staleTileCount;
+                    ++tx;
+                }
+                
+                int x = runStart * READBACK_TILE;
+                int y = ty * READBACK_TILE;
+                int w = std::min(tx * READBACK_TILE, gl.width) - x;
+                int h = std::min(y + READBACK_TILE, gl.height) - y;
+                
+                uint8_t *dst = (uint8_t*) surface->pixels + y * surface->pitch + x * 4;
+                
+                /* Full rows are contiguous in the surface */
+                if (w == gl.width)
+                {
+                    ::gl.ReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, dst);
+                    continue;
+                }
+                
+                buffer.resize(w * h * 4);
+                ::gl.ReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &buffer[0]);
+                
+                for (int row = 0; row < h; ++row)
+                    memcpy(dst + row * surface->pitch, &buffer[row * w * 4], w * 4);
+            }
+        }
+        
+        glState.viewport.pop();
+    }
+    
+    /* The cached surface, if it is entirely up to date */
+    SDL_Surface *cleanSurface() const
+    {
+        return (staleTileCount == 0) ? surface : 0;
+    }
+#endif // MKXPZ_RETRO
+    
+    void onModified(bool freeSurface = true)
+    {
 #ifndef MKXPZ_RETRO
-            SDL_FreeSurface(surface);
+        if (freeSurface)
+            this->freeSurface();
+#endif // MKXPZ_RETRO
+        
+        self->modified();
+    }
+    
+    /* Only 'changed' has to be read back again */
+    void onModified(const IntRect &changed)
+    {
+#ifndef MKXPZ_RETRO
+        markSurfaceStale(changed);
 #endif // MKXPZ_RETRO
-            surface = 0;
-        }
         
         self->modified();
     }
 };
 
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+/* Only reads the file; decoding happens once there is
+ * a BitmapPrivate to decode into */
+struct BitmapOpenHandler : FileSystem::OpenHandler
+{
+    std::vector<uint8_t> data;
+    std::string error;
+    
+    bool tryRead(std::shared_ptr<struct FileSystem::File> ops, const char *)
+    {
+        PHYSFS_sint64 size = PHYSFS_fileLength(ops->get());
+        
+        if (size < 0)
+        {
+            error = PHYSFS_getErrorByCode(PHYSFS_getLastErrorCode());
+            return false;
+        }
+        
+        data.resize(size);
+        
+        if (size > 0 && PHYSFS_readBytes(ops->get(), &data[0], size) < size)
+        {
+            error = "Error reading file";
+            data.clear();
+            return false;
+        }
+        
+        if (!SoftPNG::isPNG(dataPtr(data), data.size()))
+        {
+            error = "Unsupported image format (only PNG images can be loaded)";
+            data.clear();
+            return false;
+        }
+        
+        return true;
+    }
+};
+#else
 struct BitmapOpenHandler : FileSystem::OpenHandler
 {
     // Non-GIF
@@ -541,7 +762,7 @@ struct BitmapOpenHandler : FileSystem::OpenHandler
                 return false;
             }
         } else {
-            surface = IMG_LoadTyped_RW(&ops, 1, ext);
+            surface = shState->imageCache().decode(ops, ext, resolvedPath);
         }
         return (surface || gif);
     }
@@ -553,21 +774,53 @@ Bitmap::Bitmap(const char *filename)
     std::string hiresPrefix = "Hires/";
     std::string filenameStd = filename;
     Bitmap *hiresBitmap = nullptr;
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    BitmapOpenHandler handler;
+    std::string path("/mkxp-retro-game/");
+    path.append(filename);
+    mkxp_retro::fs->openRead(handler, path.c_str());
+    
+    if (handler.data.empty())
+        throw Exception(Exception::MKXPError, "Error loading image '%s': %s",
+                        filename, handler.error.c_str());
+#else
+    ImageDecoder &decoder = shState->imageDecoder();
+    
     // TODO: once C++20 is required, switch to filenameStd.starts_with(hiresPrefix)
     if (shState->config().enableHires && filenameStd.compare(0, hiresPrefix.size(), hiresPrefix) != 0) {
         // Look for a high-res version of the file.
         std::string hiresFilename = hiresPrefix + filenameStd;
-        try {
-            hiresBitmap = new Bitmap(hiresFilename.c_str());
-            hiresBitmap->setLores(this);
-        }
-        catch (const Exception &e)
-        {
-            Debug() << "No high-res Bitmap found at" << hiresFilename;
-            hiresBitmap = nullptr;
+        SDL_Surface *hiresSurf;
+        
+        switch (decoder.take(hiresFilename.c_str(), hiresSurf)) {
+            case ImageDecoder::Ready:
+                hiresBitmap = new Bitmap(hiresSurf, nullptr);
+                hiresBitmap->setLores(this);
+                break;
+                
+            case ImageDecoder::NotFound:
+                // Already known not to exist, no need to probe again.
+                break;
+                
+            default:
+                try {
+                    hiresBitmap = new Bitmap(hiresFilename.c_str());
+                    hiresBitmap->setLores(this);
+                }
+                catch (const Exception &e)
+                {
+                    Debug() << "No high-res Bitmap found at" << hiresFilename;
+                    hiresBitmap = nullptr;
+                }
         }
     }
+    
+    SDL_Surface *prefetched;
+    
+    if (decoder.take(filename, prefetched) == ImageDecoder::Ready) {
+        initFromSurface(prefetched, hiresBitmap, false);
+        return;
+    }
 
     BitmapOpenHandler handler;
     try {
@@ -598,7 +851,18 @@ Bitmap::Bitmap(const char *filename)
         
 #endif // MKXPZ_RETRO
         p = new BitmapPrivate(this);
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+        const char *error;
+        
+        if (!SoftPNG::decode(dataPtr(handler.data), handler.data.size(), p->soft, error))
+        {
+            delete p;
+            throw Exception(Exception::MKXPError, "Error loading image '%s': %s",
+                            filename, error);
+        }
+        
+        p->addTaintedArea(rect());
+#else
         
         p->selfHires = hiresBitmap;
         
@@ -726,7 +990,9 @@ Bitmap::Bitmap(int width, int height, bool isHires)
 #endif // MKXPZ_RETRO
     
     p = new BitmapPrivate(this);
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    p->soft.alloc(width, height);
+#else
     p->gl = tex;
     p->selfHires = hiresBitmap;
     if (p->selfHires != nullptr) {
@@ -774,7 +1040,14 @@ Bitmap::Bitmap(void *pixeldata, int width, int height)
         
 #endif // MKXPZ_RETRO
         p = new BitmapPrivate(this);
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+        p->soft.alloc(width, height);
+        
+        /* Source data is RGBA, same as what getRaw() returns */
+        const uint8_t *src = (const uint8_t*) pixeldata;
+        for (int i = 0; i < width * height; ++i, src += 4)
+            p->soft.pixels[i] = (src[3] << 24) | (src[0] << 16) | (src[1] << 8) | src[2];
+#else
         p->gl = tex;
         
         TEX::bind(p->gl.tex);
@@ -802,7 +1075,11 @@ Bitmap::Bitmap(const Bitmap &other, int frame)
     
     // TODO: Clean me up
     if (!other.isAnimated() || frame >= -1) {
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+        p->soft.alloc(other.width(), other.height());
+        memcpy(p->soft.pixels, other.p->soft.pixels,
+               (size_t) p->soft.width * p->soft.height * sizeof(uint32_t));
+#else
         try {
             p->gl = shState->texPool().request(other.width(), other.height());
         } catch (const Exception &e) {
@@ -970,7 +1247,7 @@ int Bitmap::width() const
     guardDisposed();
     
 #ifdef MKXPZ_RETRO
-    return 32; // TODO: implement
+    return p->soft.width;
 #else
     if (p->megaSurface) {
         return p->megaSurface->w;
@@ -989,7 +1266,7 @@ int Bitmap::height() const
     guardDisposed();
     
 #ifdef MKXPZ_RETRO
-    return 32; // TODO: implement
+    return p->soft.height;
 #else
     if (p->megaSurface)
         return p->megaSurface->h;
@@ -1174,10 +1451,13 @@ void Bitmap::stretchBlt(IntRect destRect,
     if(shrinkRects(sourceRect.y, sourceRect.h, source.height(), destRect.y, destRect.h, height()))
         return;
     
+#ifdef MKXPZ_RETRO
+    SoftRaster::blt(p->soft, destRect, source.p->soft, sourceRect, opacity);
+#else
     SDL_Surface *srcSurf = source.megaSurface();
     SDL_Surface *blitTemp = 0;
     bool touchesTaintedArea = p->touchesTaintedArea(destRect);
-#ifndef MKXPZ_RETRO
+
     bool unpack_subimage = srcSurf && gl.unpack_subimage;
 
     const bool scaleIsOne = sourceRect.w == destRect.w && sourceRect.h == destRect.h;
@@ -1413,7 +1693,7 @@ void Bitmap::stretchBlt(IntRect destRect,
 #endif // MKXPZ_RETRO
     
     p->addTaintedArea(destRect);
-    p->onModified();
+    p->onModified(destRect);
 }
 
 void Bitmap::fillRect(int x, int y,
@@ -1449,7 +1729,7 @@ void Bitmap::fillRect(const IntRect &rect, const Vec4 &color)
     /* Fill op */
         p->addTaintedArea(rect);
     
-    p->onModified();
+    p->onModified(rect);
 }
 
 void Bitmap::gradientFillRect(int x, int y,
@@ -1513,7 +1793,7 @@ void Bitmap::gradientFillRect(const IntRect &rect,
     
     p->addTaintedArea(rect);
     
-    p->onModified();
+    p->onModified(rect);
 }
 
 void Bitmap::clearRect(int x, int y, int width, int height)
@@ -1540,7 +1820,7 @@ void Bitmap::clearRect(const IntRect &rect)
 
     p->fillRect(rect, Vec4());
     
-    p->onModified();
+    p->onModified(rect);
 }
 
 void Bitmap::blur()
@@ -1713,7 +1993,9 @@ void Bitmap::clear()
 
     p->bindFBO();
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    SoftRaster::fill(p->soft, rect(), 0);
+#else
     glState.clearColor.pushSet(Vec4());
     
     FBO::clear();
@@ -1743,9 +2025,15 @@ Color Bitmap::getPixel(int x, int y) const
     GUARD_MEGA;
     GUARD_ANIMATED;
     
-    if (hasHires()) {
+    if (hasHires())
         Debug() << "GAME BUG: Game is calling getPixel on low-res Bitmap; you may want to patch the game to improve graphics quality.";
+    
+    return readPixel(x, y);
+}
 
+Color Bitmap::readPixel(int x, int y) const
+{
+    if (hasHires()) {
         int xHires = x * p->selfHires->width() / width();
         int yHires = y * p->selfHires->height() / height();
 
@@ -1789,24 +2077,16 @@ Color Bitmap::getPixel(int x, int y) const
     if (x < 0 || y < 0 || x >= width() || y >= height())
         return Vec4();
 
-    if (!p->surface)
-    {
-        p->allocSurface();
-        
-#ifndef MKXPZ_RETRO
-        FBO::bind(p->gl.fbo);
-        
-        glState.viewport.pushSet(IntRect(0, 0, width(), height()));
-        
-        gl.ReadPixels(0, 0, width(), height(), GL_RGBA, GL_UNSIGNED_BYTE, p->surface->pixels);
-        
-        glState.viewport.pop();
-#endif // MKXPZ_RETRO
-    }
-    
 #ifdef MKXPZ_RETRO
-    return Color(); // TODO: implement
+    uint32_t pixel = p->soft.row(y)[x];
+    
+    return Color((pixel >> 16) & 0xFF,
+                 (pixel >> 8) & 0xFF,
+                 pixel & 0xFF,
+                 pixel >> 24);
 #else
+    p->readbackSurface(IntRect(x, y, 1, 1));
+    
     uint32_t pixel = getPixelAt(p->surface, p->format, x, y);
     
     return Color((pixel >> p->format->Rshift) & 0xFF,
@@ -1816,6 +2096,69 @@ Color Bitmap::getPixel(int x, int y) const
 #endif // MKXPZ_RETRO
 }
 
+void Bitmap::getPixels(const IntRect &rect, void *output) const
+{
+    guardDisposed();
+    
+    GUARD_MEGA;
+    GUARD_ANIMATED;
+    
+    if (rect.w < 0 || rect.h < 0 || (int64_t) rect.w * rect.h * 4 > INT_MAX)
+        throw Exception(Exception::ArgumentError, "invalid rect size %dx%d", rect.w, rect.h);
+    
+    uint8_t *out = (uint8_t*) output;
+    memset(out, 0, rect.w * rect.h * 4);
+    
+    if (hasHires()) {
+        Debug() << "GAME BUG: Game is calling getPixels on low-res Bitmap; you may want to patch the game to improve graphics quality.";
+        
+        for (int y = 0; y < rect.h; ++y)
+            for (int x = 0; x < rect.w; ++x)
+            {
+                Color c = readPixel(rect.x + x, rect.y + y);
+                uint8_t *pixel = out + (y * rect.w + x) * 4;
+                
+                pixel[0] = c.getRed();
+                pixel[1] = c.getGreen();
+                pixel[2] = c.getBlue();
+                pixel[3] = c.getAlpha();
+            }
+        
+        return;
+    }
+    
+    /* Pixels outside of the bitmap are left zeroed */
+    int x1 = std::max(rect.x, 0);
+    int y1 = std::max(rect.y, 0);
+    int x2 = std::min(rect.x + rect.w, width());
+    int y2 = std::min(rect.y + rect.h, height());
+    
+    if (x1 >= x2 || y1 >= y2)
+        return;
+    
+#ifdef MKXPZ_RETRO
+    for (int y = y1; y < y2; ++y)
+    {
+        const uint32_t *src = p->soft.row(y);
+        uint8_t *dst = out + ((y - rect.y) * rect.w + (x1 - rect.x)) * 4;
+        
+        for (int x = x1; x < x2; ++x, dst += 4)
+        {
+            dst[0] = (src[x] >> 16) & 0xFF;
+            dst[1] = (src[x] >> 8) & 0xFF;
+            dst[2] = src[x] & 0xFF;
+            dst[3] = src[x] >> 24;
+        }
+    }
+#else
+    p->readbackSurface(IntRect(x1, y1, x2 - x1, y2 - y1));
+    
+    for (int y = y1; y < y2; ++y)
+        memcpy(out + ((y - rect.y) * rect.w + (x1 - rect.x)) * 4,
+               &getPixelAt(p->surface, p->format, x1, y), (x2 - x1) * 4);
+#endif // MKXPZ_RETRO
+}
+
 void Bitmap::setPixel(int x, int y, const Color &color)
 {
     guardDisposed();
@@ -1849,7 +2192,10 @@ void Bitmap::setPixel(int x, int y, const Color &color)
         (uint8_t) clamp<double>(color.alpha, 0, 255)
     };
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (x >= 0 && y >= 0 && x < width() && y < height())
+        p->soft.row(y)[x] = (pixel[3] << 24) | (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
+#else
     TEX::bind(p->gl.tex);
     TEX::uploadSubImage(x, y, 1, 1, &pixel, GL_RGBA);
 #endif // MKXPZ_RETRO
@@ -1881,7 +2227,7 @@ bool Bitmap::getRaw(void *output, int output_size)
     }
 
 #ifndef MKXPZ_RETRO
-    if (!p->animation.enabled && (p->surface || p->megaSurface)) {
+    if (!p->animation.enabled && (p->cleanSurface() || p->megaSurface)) {
         void *src = (p->megaSurface) ? p->megaSurface->pixels : p->surface->pixels;
         memcpy(output, src, output_size);
     }
@@ -1928,9 +2274,14 @@ void Bitmap::saveToFile(const char *filename)
     }
 
     SDL_Surface *surf;
+#ifndef MKXPZ_RETRO
+    SDL_Surface *cached = p->cleanSurface();
+#else
+    SDL_Surface *cached = 0;
+#endif // MKXPZ_RETRO
     
-    if (p->surface || p->megaSurface) {
-        surf = (p->surface) ? p->surface : p->megaSurface;
+    if (cached || p->megaSurface) {
+        surf = (cached) ? cached : p->megaSurface;
     }
     else {
 #ifndef MKXPZ_RETRO
@@ -1976,7 +2327,7 @@ void Bitmap::saveToFile(const char *filename)
             break;
     }
     
-    if (!p->surface && !p->megaSurface)
+    if (!cached && !p->megaSurface)
         SDL_FreeSurface(surf);
     
     if (rc) throw Exception(Exception::SDLError, "%s", SDL_GetError());
@@ -2138,6 +2489,112 @@ static void applyShadow(SDL_Surface *&in, const SDL_PixelFormat &fm, const SDL_C
     SDL_FreeSurface(in);
     in = out;
 }
+
+/* Renders the whole string through SDL_ttf; used when
+ * the glyph cache can't handle it. 'rawH' receives the
+ * height of the text without shadow and outline */
+static SDL_Surface *renderTextSurface(TTF_Font *font, const char *str,
+                                      Font &fontObj, const SDL_PixelFormat &fm,
+                                      const SDL_Color &c, int outlineSize, int &rawH)
+{
+    SDL_Surface *txtSurf;
+    
+    if (fontObj.isSolid())
+        txtSurf = TTF_RenderUTF8_Solid(font, str, c);
+    else
+        txtSurf = TTF_RenderUTF8_Blended(font, str, c);
+    
+    BitmapPrivate::ensureFormat(txtSurf, SDL_PIXELFORMAT_ABGR8888);
+    
+    rawH = txtSurf->h;
+    
+    if (fontObj.getShadow())
+        applyShadow(txtSurf, fm, c);
+    
+    /* outline using TTF_Outline and blending it together with SDL_BlitSurface
+     * FIXME: outline is forced to have the same opacity as the font color */
+    if (outlineSize > 0)
+    {
+        SDL_Color co = fontObj.getOutColor().toSDLColor();
+        co.a = 255;
+        SDL_Surface *outline;
+        /* set the next font render to render the outline */
+        TTF_SetFontOutline(font, outlineSize);
+        if (fontObj.isSolid())
+            outline = TTF_RenderUTF8_Solid(font, str, co);
+        else
+            outline = TTF_RenderUTF8_Blended(font, str, co);
+        
+        BitmapPrivate::ensureFormat(outline, SDL_PIXELFORMAT_ABGR8888);
+        SDL_Rect outRect = {outlineSize, outlineSize, txtSurf->w, txtSurf->h};
+        
+        SDL_SetSurfaceBlendMode(txtSurf, SDL_BLENDMODE_BLEND);
+        SDL_BlitSurface(txtSurf, NULL, outline, &outRect);
+        SDL_FreeSurface(txtSurf);
+        txtSurf = outline;
+        /* reset outline to 0 */
+        TTF_SetFontOutline(font, 0);
+    }
+    
+    return txtSurf;
+}
+
+/* Blends a text run composed by the glyph cache into the bitmap,
+ * following the same paths stretchBlt takes for surface sources */
+static void blitTextRun(BitmapPrivate *p, TEXFBO &run,
+                        const IntRect &sourceRect, const IntRect &destRect,
+                        int opacity, bool smooth)
+{
+    if (opacity == 255 && !p->touchesTaintedArea(destRect))
+    {
+        GLMeta::blitBegin(p->getGLTypes());
+        GLMeta::blitSource(run);
+        GLMeta::blitRectangle(sourceRect, destRect, smooth);
+        GLMeta::blitEnd();
+        
+        return;
+    }
+    
+    float normOpacity = (float) opacity / 255.0f;
+    
+    TEXFBO &gpTex = shState->gpTexFBO(destRect.w, destRect.h);
+    
+    GLMeta::blitBegin(gpTex, false, SameScale);
+    GLMeta::blitSource(p->getGLTypes(), SameScale);
+    GLMeta::blitRectangle(destRect, IntRect(0, 0, destRect.w, destRect.h));
+    GLMeta::blitEnd();
+    
+    FloatRect bltSubRect((float) sourceRect.x / run.width,
+                         (float) sourceRect.y / run.height,
+                         ((float) run.width / sourceRect.w) * ((float) destRect.w / gpTex.width),
+                         ((float) run.height / sourceRect.h) * ((float) destRect.h / gpTex.height));
+    
+    BltShader &shader = shState->shaders().blt;
+    shader.bind();
+    TEX::bind(run.tex);
+    shader.setTexSize(Vec2i(run.width, run.height));
+    shader.setSource();
+    shader.setDestination(gpTex.tex);
+    shader.setSubRect(bltSubRect);
+    shader.setOpacity(normOpacity);
+    
+    Quad &quad = shState->gpQuad();
+    quad.setTexPosRect(sourceRect, destRect);
+    quad.setColor(Vec4(1, 1, 1, normOpacity));
+    
+    p->bindFBO();
+    p->pushSetViewport(shader);
+    
+    if (smooth)
+        TEX::setSmooth(true);
+    
+    p->blitQuad(quad);
+    
+    p->popViewport();
+    
+    if (smooth)
+        TEX::setSmooth(false);
+}
 #endif // MKXPZ_RETRO
 
 void Bitmap::drawText(const IntRect &rect, const char *str, int align)
@@ -2188,48 +2645,50 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
     SDL_Color c = fontColor.toSDLColor();
     c.a = 255;
     
-    SDL_Surface *txtSurf;
-    
-    if (p->font->isSolid())
-        txtSurf = TTF_RenderUTF8_Solid(font, str, c);
-    else
-        txtSurf = TTF_RenderUTF8_Blended(font, str, c);
+    int scaledOutlineSize = 0;
     
-    p->ensureFormat(txtSurf, SDL_PIXELFORMAT_ABGR8888);
-    
-    int rawTxtSurfH = txtSurf->h;
-    
-    if (p->font->getShadow())
-        applyShadow(txtSurf, *p->format, c);
-    
-    /* outline using TTF_Outline and blending it together with SDL_BlitSurface
-     * FIXME: outline is forced to have the same opacity as the font color */
     if (p->font->getOutline())
     {
-        SDL_Color co = outColor.toSDLColor();
-        co.a = 255;
-        SDL_Surface *outline;
         // Handle high-res for outline.
-        int scaledOutlineSize = OUTLINE_SIZE;
+        scaledOutlineSize = OUTLINE_SIZE;
         if (p->selfLores) {
             scaledOutlineSize = scaledOutlineSize * width() / p->selfLores->width();
         }
-        /* set the next font render to render the outline */
-        TTF_SetFontOutline(font, scaledOutlineSize);
-        if (p->font->isSolid())
-            outline = TTF_RenderUTF8_Solid(font, str, co);
-        else
-            outline = TTF_RenderUTF8_Blended(font, str, co);
-        
-        p->ensureFormat(outline, SDL_PIXELFORMAT_ABGR8888);
-        SDL_Rect outRect = {scaledOutlineSize, scaledOutlineSize, txtSurf->w, txtSurf->h};
+    }
+    
+    GlyphCache::Style style;
+    style.solid = p->font->isSolid();
+    style.shadow = p->font->getShadow();
+    style.outline = scaledOutlineSize;
+    style.color = Vec4(c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, 1);
+    style.outColor = Vec4(outColor.norm.x, outColor.norm.y, outColor.norm.z, 1);
+    
+    /* Lay the text out from cached glyphs where possible,
+     * and only have SDL_ttf render the whole string otherwise */
+    GlyphCache::Run run;
+    SDL_Surface *txtSurf = 0;
+    Vec2i txtSize;
+    int rawTxtSurfH;
+    
+    TextRunCache &runCache = shState->textRunCache();
+    
+    if (runCache.lookupRun(font, str, style, run))
+    {
+        txtSize = run.size;
+        rawTxtSurfH = run.textHeight;
+    }
+    else if (shState->glyphCache().render(font, str, style, run))
+    {
+        runCache.storeRun(font, str, style, run);
         
-        SDL_SetSurfaceBlendMode(txtSurf, SDL_BLENDMODE_BLEND);
-        SDL_BlitSurface(txtSurf, NULL, outline, &outRect);
-        SDL_FreeSurface(txtSurf);
-        txtSurf = outline;
-        /* reset outline to 0 */
-        TTF_SetFontOutline(font, 0);
+        txtSize = run.size;
+        rawTxtSurfH = run.textHeight;
+    }
+    else
+    {
+        txtSurf = renderTextSurface(font, str, *p->font, *p->format, c,
+                                    scaledOutlineSize, rawTxtSurfH);
+        txtSize = Vec2i(txtSurf->w, txtSurf->h);
     }
     
     int alignX = rect.x;
@@ -2241,11 +2700,11 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
             break;
             
         case Center :
-            alignX += (rect.w - txtSurf->w) / 2;
+            alignX += (rect.w - txtSize.x) / 2;
             break;
             
         case Right :
-            alignX += rect.w - txtSurf->w;
+            alignX += rect.w - txtSize.x;
             break;
     }
     
@@ -2254,14 +2713,14 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
     
     int alignY = rect.y + (rect.h - rawTxtSurfH) / 2;
     
-    float squeeze = (float) rect.w / txtSurf->w;
+    float squeeze = (float) rect.w / txtSize.x;
     
     if (squeeze > 1)
         squeeze = 1;
     
     IntRect destRect(alignX, alignY, 0, 0);
-    destRect.w = std::min(rect.w, (int)(txtSurf->w * squeeze));
-    destRect.h = std::min(rect.h, txtSurf->h);
+    destRect.w = std::min(rect.w, (int)(txtSize.x * squeeze));
+    destRect.h = std::min(rect.h, txtSize.y);
     
     destRect.w = std::min(destRect.w, width() - destRect.x);
     destRect.h = std::min(destRect.h, height() - destRect.y);
@@ -2270,9 +2729,31 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
     sourceRect.w = destRect.w / squeeze;
     sourceRect.h = destRect.h;
     
-    Bitmap txtBitmap(txtSurf, nullptr, true);
     bool smooth = squeeze != 1.0f;
-    stretchBlt(destRect, txtBitmap, sourceRect, fontColor.alpha, smooth);
+    
+    if (txtSurf)
+    {
+        Bitmap txtBitmap(txtSurf, nullptr, true);
+        stretchBlt(destRect, txtBitmap, sourceRect, fontColor.alpha, smooth);
+        
+        return;
+    }
+    
+    /* Same clipping stretchBlt would apply */
+    int opacity = clamp<int>(fontColor.alpha, 0, 255);
+    
+    if (opacity == 0)
+        return;
+    
+    if (shrinkRects(sourceRect.x, sourceRect.w, txtSize.x, destRect.x, destRect.w, width()))
+        return;
+    if (shrinkRects(sourceRect.y, sourceRect.h, txtSize.y, destRect.y, destRect.h, height()))
+        return;
+    
+    blitTextRun(p, *run.tex, sourceRect, destRect, opacity, smooth);
+    
+    p->addTaintedArea(destRect);
+    p->onModified(destRect);
 #endif // MKXPZ_RETRO
 }
 
@@ -2338,6 +2819,12 @@ IntRect Bitmap::textSize(const char *str)
     std::string fixed = fixupString(str);
     str = fixed.c_str();
     
+    TextRunCache &runCache = shState->textRunCache();
+    IntRect size;
+    
+    if (runCache.lookupSize(font, str, size))
+        return size;
+    
     int w, h;
     TTF_SizeUTF8(font, str, &w, &h);
     
@@ -2350,7 +2837,10 @@ IntRect Bitmap::textSize(const char *str)
     if (p->font->getItalic() && *endPtr == '\0')
         TTF_GlyphMetrics(font, ucs2, 0, 0, 0, 0, &w);
     
-    return IntRect(0, 0, w, h);
+    size = IntRect(0, 0, w, h);
+    runCache.storeSize(font, str, size);
+    
+    return size;
 #endif // MKXPZ_RETRO
 }
 
@@ -2380,7 +2870,12 @@ void Bitmap::setInitFont(Font *value)
     p->font = value;
 }
 
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+const SoftSurface &Bitmap::getSoftSurface() const
+{
+    return p->soft;
+}
+#else
 TEXFBO &Bitmap::getGLTypes() const
 {
     return p->getGLTypes();
@@ -2393,7 +2888,11 @@ SDL_Surface *Bitmap::surface() const
         Debug() << "BUG: High-res Bitmap surface not implemented";
     }
 
+#ifdef MKXPZ_RETRO
     return p->surface;
+#else
+    return p->cleanSurface();
+#endif // MKXPZ_RETRO
 }
 
 SDL_Surface *Bitmap::megaSurface() const
@@ -2577,16 +3076,14 @@ int Bitmap::addFrame(Bitmap &source, int position)
         
         p->animation.frames.push_back(p->gl);
         
-        if (p->surface)
-            SDL_FreeSurface(p->surface);
+        p->freeSurface();
         p->gl = TEXFBO();
     }
     
     if (source.surface()) {
         TEX::bind(newframe.tex);
         TEX::uploadImage(source.width(), source.height(), source.surface()->pixels, GL_RGBA);
-        SDL_FreeSurface(p->surface);
-        p->surface = 0;
+        p->freeSurface();
     }
     else {
         GLMeta::blitBegin(newframe, false, SameScale);
@@ -2789,6 +3286,33 @@ void Bitmap::taintArea(const IntRect &rect)
 int Bitmap::maxSize(){
     return glState.caps.maxTexSize;
 }
+
+void Bitmap::prefetch(const char *filename)
+{
+    ImageDecoder &decoder = shState->imageDecoder();
+    std::string filenameStd = filename;
+    std::string hiresPrefix = "Hires/";
+    
+    decoder.prefetch(filename);
+    
+    if (shState->config().enableHires && filenameStd.compare(0, hiresPrefix.size(), hiresPrefix) != 0)
+        decoder.prefetch((hiresPrefix + filenameStd).c_str());
+}
+
+bool Bitmap::isPrefetched(const char *filename)
+{
+    ImageDecoder &decoder = shState->imageDecoder();
+    std::string filenameStd = filename;
+    std::string hiresPrefix = "Hires/";
+    
+    if (!decoder.isDone(filename))
+        return false;
+    
+    if (shState->config().enableHires && filenameStd.compare(0, hiresPrefix.size(), hiresPrefix) != 0)
+        return decoder.isDone((hiresPrefix + filenameStd).c_str());
+    
+    return true;
+}
 #endif // MKXPZ_RETRO
 
 void Bitmap::assumeRubyGC()
@@ -32,6 +32,7 @@ class Font;
 class ShaderBase;
 struct TEXFBO;
 struct SDL_Surface;
+struct SoftSurface;
 
 struct BitmapPrivate;
 // FIXME make this class use proper RGSS classes again
@@ -93,6 +94,10 @@ public:
 	void clear();
 
 	Color getPixel(int x, int y) const;
+	/* Writes 'rect' as packed RGBA bytes to 'output', which
+	 * must hold rect.w * rect.h * 4 bytes. Pixels outside
+	 * of the bitmap read as zero */
+	void getPixels(const IntRect &rect, void *output) const;
 	void setPixel(int x, int y, const Color &color);
     
     bool getRaw(void *output, int output_size);
@@ -125,6 +130,7 @@ public:
 
 	/* <internal> */
 	TEXFBO &getGLTypes() const;
+	const SoftSurface &getSoftSurface() const;
     SDL_Surface *surface() const;
 	SDL_Surface *megaSurface() const;
 	void ensureNonMega() const;
@@ -167,10 +173,20 @@ public:
 
 	static int maxSize();
 
+	/* Queues 'filename' (and its high-res version) to be decoded
+	 * in the background; a later Bitmap(filename) then only has
+	 * to upload it, waiting for the decode if still in progress */
+	static void prefetch(const char *filename);
+	static bool isPrefetched(const char *filename);
+
     void assumeRubyGC();
 
 private:
 	void releaseResources();
+
+	/* getPixel without the guards and the low-res warning */
+	Color readPixel(int x, int y) const;
+
 	sigslot::connection loresDispCon;
 	const char *klassName() const { return "bitmap"; }
 
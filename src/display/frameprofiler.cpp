@@ -0,0 +1,222 @@
+/*
+** frameprofiler.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "frameprofiler.h"
+
+#include "sharedstate.h"
+
+#include <SDL_timer.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+static const char *sectionNames[] =
+{
+	"Script",
+	"Prepare",
+	"Flush",
+	"Composite",
+	"Submit",
+	"Swap",
+	"Sleep"
+};
+
+FrameProfiler::Scope::Scope(Section section)
+    : section(section),
+      start(0)
+{
+	if (shState->frameProfiler().isEnabled())
+		start = SDL_GetPerformanceCounter();
+}
+
+void FrameProfiler::Scope::stop()
+{
+	if (!start)
+		return;
+
+	shState->frameProfiler().record(section, start, SDL_GetPerformanceCounter());
+	start = 0;
+}
+
+FrameProfiler::FrameProfiler(bool enabled)
+    : enabled(false),
+      baseTicks(SDL_GetPerformanceCounter()),
+      ticksPerMicro(SDL_GetPerformanceFrequency() / 1000000.0),
+      frameIndex(0)
+{
+	SDL_AtomicSet(&frameHead, 0);
+	SDL_AtomicSet(&eventHead, 0);
+
+	setEnabled(enabled);
+}
+
+void FrameProfiler::setEnabled(bool value)
+{
+	if (value && !enabled)
+	{
+		/* Start over with a fresh frame */
+		frameStart = updateStart = SDL_GetPerformanceCounter();
+		memset(times, 0, sizeof(times));
+		scriptNested = 0;
+		inUpdate = false;
+	}
+
+	enabled = value;
+}
+
+void FrameProfiler::updateBegin()
+{
+	if (!enabled)
+		return;
+
+	updateStart = SDL_GetPerformanceCounter();
+	inUpdate = true;
+
+	Event &ev = events[(unsigned int) SDL_AtomicGet(&eventHead) % EventCapacity];
+	ev.start = frameStart;
+	ev.end = updateStart;
+	ev.section = Script;
+	SDL_AtomicAdd(&eventHead, 1);
+}
+
+void FrameProfiler::updateEnd()
+{
+	/* Also skips updates that began while disabled */
+	if (!enabled || !inUpdate)
+		return;
+
+	uint64_t now = SDL_GetPerformanceCounter();
+	uint64_t script = updateStart - frameStart;
+
+	times[Script] = script - std::min(script, scriptNested);
+
+	Frame &frame = frames[(unsigned int) SDL_AtomicGet(&frameHead) % FrameCapacity];
+	frame.index = frameIndex++;
+	frame.start = toMicros(frameStart - baseTicks);
+	frame.total = toMicros(now - frameStart);
+
+	for (int i = 0; i < SectionCount; ++i)
+		frame.times[i] = toMicros(times[i]);
+
+	SDL_AtomicAdd(&frameHead, 1);
+
+	frameStart = now;
+	memset(times, 0, sizeof(times));
+	scriptNested = 0;
+	inUpdate = false;
+}
+
+void FrameProfiler::record(Section section, uint64_t start, uint64_t end)
+{
+	if (!enabled)
+		return;
+
+	times[section] += end - start;
+
+	if (!inUpdate)
+		scriptNested += end - start;
+
+	Event &ev = events[(unsigned int) SDL_AtomicGet(&eventHead) % EventCapacity];
+	ev.start = start;
+	ev.end = end;
+	ev.section = section;
+	SDL_AtomicAdd(&eventHead, 1);
+}
+
+template<typename T>
+void FrameProfiler::readRing(const T *ring, size_t capacity, const SDL_atomic_t &head,
+                             std::vector<T> &out, size_t max)
+{
+	unsigned int first = (unsigned int) SDL_AtomicGet(const_cast<SDL_atomic_t*>(&head));
+	size_t count = std::min<size_t>(std::min<size_t>(first, capacity), max);
+
+	std::vector<T> copy(count);
+
+	for (size_t i = 0; i < count; ++i)
+		copy[i] = ring[(first - count + i) % capacity];
+
+	/* The writer may have reused the oldest slots meanwhile,
+	 * including the one it is filling right now */
+	unsigned int last = (unsigned int) SDL_AtomicGet(const_cast<SDL_atomic_t*>(&head));
+	size_t span = (size_t) (last - first) + count + 1;
+	size_t lost = (span > capacity) ? std::min(span - capacity, count) : 0;
+
+	out.assign(copy.begin() + lost, copy.end());
+}
+
+void FrameProfiler::getFrames(std::vector<Frame> &out, size_t max) const
+{
+	readRing(frames, FrameCapacity, frameHead, out, max);
+}
+
+bool FrameProfiler::writeTrace(const char *filename) const
+{
+	std::vector<Frame> frameList;
+	std::vector<Event> eventList;
+
+	readRing(frames, FrameCapacity, frameHead, frameList, FrameCapacity);
+	readRing(events, EventCapacity, eventHead, eventList, EventCapacity);
+
+	FILE *f = fopen(filename, "w");
+
+	if (!f)
+		return false;
+
+	fprintf(f, "{\"traceEvents\":[\n"
+	           "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Frames\"}},\n"
+	           "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"RGSS\"}}");
+
+	for (size_t i = 0; i < frameList.size(); ++i)
+	{
+		const Frame &fr = frameList[i];
+
+		fprintf(f, ",\n{\"name\":\"Frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+		           "\"ts\":%.3f,\"dur\":%.3f}",
+		        (unsigned long long) fr.index, fr.start, fr.total);
+	}
+
+	for (size_t i = 0; i < eventList.size(); ++i)
+	{
+		const Event &ev = eventList[i];
+
+		fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"
+		           "\"ts\":%.3f,\"dur\":%.3f}",
+		        sectionName(ev.section), toMicros(ev.start - baseTicks),
+		        toMicros(ev.end - ev.start));
+	}
+
+	fprintf(f, "\n]}\n");
+
+	bool ok = !ferror(f);
+
+	return (fclose(f) == 0) && ok;
+}
+
+const char *FrameProfiler::sectionName(Section section)
+{
+	return sectionNames[section];
+}
+
+double FrameProfiler::toMicros(uint64_t ticks) const
+{
+	return ticks / ticksPerMicro;
+}
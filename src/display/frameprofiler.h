@@ -0,0 +1,162 @@
+/*
+** frameprofiler.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include <SDL_atomic.h>
+
+/* Records how long each frame spent in the major stages of
+ * the frame loop, so that drops can be attributed to one.
+ * Only CPU time on the RGSS thread is measured; GL work the
+ * driver defers shows up wherever it ends up blocking
+ * (usually Swap).
+ *
+ * Written by the RGSS thread only. Readers on any thread get
+ * consistent copies without locking: records are published
+ * by bumping a counter, and ones overwritten while being
+ * copied are dropped */
+class FrameProfiler
+{
+public:
+	enum Section
+	{
+		/* Between two Graphics.update calls, minus the
+		 * other sections run from there (eg. transitions) */
+		Script,
+
+		/* 'prepareDraw' handlers (tilemaps, animated bitmaps) */
+		Prepare,
+
+		/* PrepareQueue builds and buffer uploads */
+		Flush,
+
+		/* Rendering the scene graph */
+		Composite,
+
+		/* Scaling the frame into the window */
+		Submit,
+
+		/* SDL_GL_SwapWindow */
+		Swap,
+
+		/* Frame limiter delay */
+		Sleep,
+
+		SectionCount
+	};
+
+	struct Frame
+	{
+		uint64_t index;
+
+		/* In microseconds, 'start' relative to
+		 * the creation of the profiler */
+		double start;
+		double total;
+		double times[SectionCount];
+	};
+
+	/* Times the section from construction to 'stop()'
+	 * or destruction, if the profiler is enabled */
+	class Scope
+	{
+	public:
+		Scope(Section section);
+		~Scope() { stop(); }
+
+		void stop();
+
+	private:
+		Section section;
+		uint64_t start;
+	};
+
+	FrameProfiler(bool enabled);
+
+	bool isEnabled() const { return enabled; }
+	void setEnabled(bool value);
+
+	/* Bracket Graphics.update; a frame ends with it */
+	void updateBegin();
+	void updateEnd();
+
+	/* Copies up to 'max' of the most recent frames, oldest first */
+	void getFrames(std::vector<Frame> &out, size_t max) const;
+
+	/* Writes the recorded frames and sections in the Chrome
+	 * trace event format (chrome://tracing, Perfetto) */
+	bool writeTrace(const char *filename) const;
+
+	static const char *sectionName(Section section);
+
+private:
+	struct Event
+	{
+		uint64_t start;
+		uint64_t end;
+		Section section;
+	};
+
+	/* Powers of two, so indices stay consistent
+	 * when the counters wrap around */
+	enum
+	{
+		FrameCapacity = 1024,
+		EventCapacity = 16384
+	};
+
+	void record(Section section, uint64_t start, uint64_t end);
+
+	template<typename T>
+	static void readRing(const T *ring, size_t capacity, const SDL_atomic_t &head,
+	                     std::vector<T> &out, size_t max);
+
+	double toMicros(uint64_t ticks) const;
+
+	bool enabled;
+
+	const uint64_t baseTicks;
+	const double ticksPerMicro;
+
+	Frame frames[FrameCapacity];
+	Event events[EventCapacity];
+
+	/* Number of records ever published */
+	SDL_atomic_t frameHead;
+	SDL_atomic_t eventHead;
+
+	/* Frame in progress */
+	uint64_t frameIndex;
+	uint64_t frameStart;
+	uint64_t updateStart;
+	uint64_t times[SectionCount];
+
+	/* Section time recorded outside of Graphics.update */
+	uint64_t scriptNested;
+	bool inUpdate;
+};
+
+#endif // FRAMEPROFILER_H
@@ -177,6 +177,20 @@ void initGLFunctions()
         GL_VAO_FUN;
     }
     
+    /* Program binary entrypoints */
+    if (HAVE_EXT(ARB_get_program_binary) || (gles && glMajor >= 3))
+    {
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+        GL_PROGRAM_BINARY_FUN;
+    }
+    else if (HAVE_EXT(OES_get_program_binary))
+    {
+#undef EXT_SUFFIX
+#define EXT_SUFFIX "OES"
+        GL_PROGRAM_BINARY_FUN;
+    }
+    
     /* Debug callback entrypoints */
     if (HAVE_EXT(KHR_debug))
     {
@@ -0,0 +1,181 @@
+/*
+** programcache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "programcache.h"
+
+#include "filesystem.h"
+#include "cachedir.h"
+#include "debugwriter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define FORMAT_VER 1
+
+static const char magic[8] = { 'M', 'K', 'X', 'P', 'P', 'R', 'G', FORMAT_VER };
+
+/* Followed by 'length' bytes of program binary */
+struct Header
+{
+	char magic[8];
+
+	/* Identity of the sources and driver */
+	uint64_t key;
+
+	uint32_t format;
+	uint32_t length;
+};
+
+static std::string glString(GLenum name)
+{
+	const char *str = (const char*) gl.GetString(name);
+
+	return str ? str : "";
+}
+
+ProgramCache::ProgramCache(const std::string &dir)
+{
+	if (dir.empty() || !gl.GetProgramBinary || !gl.ProgramBinary)
+		return;
+
+	/* Drivers may expose the entrypoints without
+	 * supporting a single binary format */
+	GLint formatCount = 0;
+	gl.GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	if (formatCount <= 0)
+		return;
+
+	if (!mkxp_fs::createDirectories(dir.c_str()))
+	{
+		Debug() << "Shader cache disabled, can't create" << dir;
+		return;
+	}
+
+	this->dir = dir;
+
+	driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+}
+
+uint64_t ProgramCache::makeKey(const std::string &source) const
+{
+	uint64_t hash = cacheHash(driver.c_str(), driver.size() + 1);
+
+	return cacheHash(source.c_str(), source.size(), hash);
+}
+
+std::string ProgramCache::entryPath(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long) key);
+
+	return dir + name;
+}
+
+bool ProgramCache::load(GLuint program, const std::string &source)
+{
+	if (dir.empty())
+		return false;
+
+	uint64_t key = makeKey(source);
+	FILE *f = fopen(entryPath(key).c_str(), "rb");
+
+	if (!f)
+		return false;
+
+	Header hd;
+	std::vector<uint8_t> binary;
+
+	bool ok = fread(&hd, sizeof(hd), 1, f) == 1 &&
+	          memcmp(hd.magic, magic, sizeof(magic)) == 0 &&
+	          hd.key == key && hd.length > 0 &&
+	          hd.length <= (unsigned long) cacheBytesLeft(f);
+
+	if (ok)
+	{
+		binary.resize(hd.length);
+		ok = fread(&binary[0], 1, hd.length, f) == hd.length;
+	}
+
+	fclose(f);
+
+	if (!ok)
+		return false;
+
+	gl.ProgramBinary(program, hd.format, &binary[0], hd.length);
+
+	/* The driver is free to refuse binaries it
+	 * wrote itself, eg. after a hardware change */
+	GLint success;
+	gl.GetProgramiv(program, GL_LINK_STATUS, &success);
+
+	return success;
+}
+
+void ProgramCache::prepareLink(GLuint program)
+{
+	/* Without the hint, some desktop drivers report
+	 * a binary length of 0 after linking */
+	if (!dir.empty() && gl.ProgramParameteri)
+		gl.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(GLuint program, const std::string &source)
+{
+	if (dir.empty())
+		return;
+
+	GLint length = 0;
+	gl.GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (length <= 0)
+		return;
+
+	std::vector<uint8_t> binary(length);
+	GLenum format;
+
+	gl.GetProgramBinary(program, length, &length, &format, &binary[0]);
+
+	if (length <= 0)
+		return;
+
+	Header hd;
+	memset(&hd, 0, sizeof(hd));
+	memcpy(hd.magic, magic, sizeof(magic));
+	hd.key = makeKey(source);
+	hd.format = format;
+	hd.length = length;
+
+	const std::string path = entryPath(hd.key);
+	const std::string tmpPath = path + ".tmp";
+
+	FILE *f = fopen(tmpPath.c_str(), "wb");
+
+	if (!f)
+		return;
+
+	bool ok = fwrite(&hd, sizeof(hd), 1, f) == 1 &&
+	          fwrite(&binary[0], 1, hd.length, f) == hd.length;
+
+	finishCacheFile(f, ok, tmpPath, path);
+}
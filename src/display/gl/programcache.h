@@ -0,0 +1,67 @@
+/*
+** programcache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include "gl-fun.h"
+
+#include <string>
+#include <stdint.h>
+
+/* Keeps linked shader programs on disk as driver specific
+ * binaries (glGetProgramBinary), so later launches can skip
+ * compiling and linking them. Entries are keyed on the full
+ * shader sources and the GL vendor, renderer and version
+ * strings; a driver update simply leaves them unused.
+ *
+ * Does nothing if the driver has no program binary support */
+class ProgramCache
+{
+public:
+	/* 'dir' is created if missing. An empty
+	 * 'dir' disables the cache */
+	ProgramCache(const std::string &dir);
+
+	/* Loads the binary stored for 'source' into 'program'.
+	 * Returns false if there is none or the driver rejected
+	 * it, in which case 'program' has to be linked as usual */
+	bool load(GLuint program, const std::string &source);
+
+	/* To be called before linking 'program', so that
+	 * the driver keeps its binary around for 'store' */
+	void prepareLink(GLuint program);
+
+	/* Stores the binary of the linked 'program' for 'source' */
+	void store(GLuint program, const std::string &source);
+
+private:
+	uint64_t makeKey(const std::string &source) const;
+	std::string entryPath(uint64_t key) const;
+
+	std::string dir;
+
+	/* Vendor, renderer and version */
+	std::string driver;
+};
+
+#endif // PROGRAMCACHE_H
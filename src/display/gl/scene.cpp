@@ -21,6 +21,11 @@
 
 #include "scene.h"
 #include "sharedstate.h"
+#ifndef MKXPZ_RETRO
+#include "spritebatch.h"
+#endif // MKXPZ_RETRO
+
+Scene::CullStats Scene::cullStats;
 
 Scene::Scene()
 {}
@@ -34,48 +39,87 @@ Scene::~Scene()
 	{
 		iter->data->scene = 0;
 	}
+
+	while (!pending.isEmpty())
+		pending.remove(*pending.begin());
+}
+
+bool Scene::ElementLess::operator()(const SceneElement *a, const SceneElement *b) const
+{
+	return *a < *b;
+}
+
+void Scene::linkIndexed(SceneElement &element)
+{
+	/* Every indexed element is already in its place,
+	 * so we go right in front of the next one */
+	Index::iterator iter = element.indexIter;
+	++iter;
+
+	if (iter == index.end())
+		elements.append(element.link);
+	else
+		elements.insertBefore(element.link, (*iter)->link);
 }
 
 void Scene::insert(SceneElement &element)
 {
-	IntruListLink<SceneElement> *iter;
+	element.indexIter = index.insert(&element).first;
+	linkIndexed(element);
+}
 
-	for (iter = elements.begin(); iter != elements.end(); iter = iter->next)
+void Scene::insertAfter(SceneElement &element, SceneElement &after)
+{
+	/* 'after' only serves as a hint here */
+	if (!after.link.next || after.pendingLink.next)
 	{
-		SceneElement *e = iter->data;
-
-		if (element < *e)
-		{
-			elements.insertBefore(element.link, *iter);
-			return;
-		}
+		insert(element);
+		return;
 	}
 
-	elements.append(element.link);
+	Index::iterator hint = after.indexIter;
+	element.indexIter = index.insert(++hint, &element);
+	linkIndexed(element);
 }
 
-void Scene::insertAfter(SceneElement &element, SceneElement &after)
+void Scene::remove(SceneElement &element)
 {
-	IntruListLink<SceneElement> *iter;
+	if (element.pendingLink.next)
+		pending.remove(element.pendingLink);
+	else if (element.link.next)
+		index.erase(element.indexIter);
 
-	for (iter = &after.link; iter != elements.end(); iter = iter->next)
-	{
-		SceneElement *e = iter->data;
+	elements.remove(element.link);
+}
 
-		if (element < *e)
-		{
-			elements.insertBefore(element.link, *iter);
-			return;
-		}
+void Scene::reinsert(SceneElement &element)
+{
+	if (!element.link.next)
+	{
+		insert(element);
+		return;
 	}
 
-	elements.append(element.link);
+	if (element.pendingLink.next)
+		return;
+
+	/* Erasing by iterator doesn't compare keys, so
+	 * the changed ones can't confuse the tree */
+	index.erase(element.indexIter);
+	pending.append(element.pendingLink);
 }
 
-void Scene::reinsert(SceneElement &element)
+void Scene::sortPending()
 {
-	elements.remove(element.link);
-	insert(element);
+	while (!pending.isEmpty())
+	{
+		SceneElement &element = *pending.begin()->data;
+
+		pending.remove(element.pendingLink);
+		elements.remove(element.link);
+
+		insert(element);
+	}
 }
 
 void Scene::notifyGeometryChange()
@@ -92,18 +136,48 @@ void Scene::composite()
 {
 	IntruListLink<SceneElement> *iter;
 
+	sortPending();
+
+#ifndef MKXPZ_RETRO
+	SpriteBatch &batch = shState->spriteBatch();
+#endif // MKXPZ_RETRO
+
 	for (iter = elements.begin(); iter != elements.end(); iter = iter->next)
 	{
 		SceneElement *e = iter->data;
 
-		if (e->visible)
-			e->draw();
+		if (!e->visible)
+			continue;
+
+#ifndef MKXPZ_RETRO
+		IntRect bounds;
+
+		if (e->getBounds(bounds) && !bounds.intersects(geometry.rect))
+		{
+			++cullStats.culled;
+			continue;
+		}
+
+		++cullStats.drawn;
+
+		if (!e->batchable())
+			batch.flush();
+#endif // MKXPZ_RETRO
+
+		e->draw();
 	}
+
+#ifndef MKXPZ_RETRO
+	/* Whatever is drawn after us (eg. viewport effects)
+	 * expects our elements to be on screen already */
+	batch.flush();
+#endif // MKXPZ_RETRO
 }
 
 
 SceneElement::SceneElement(Scene &scene, int z, int spriteY)
     : link(this),
+      pendingLink(this),
       creationStamp(shState->genTimeStamp()),
       z(z),
       visible(true),
@@ -198,5 +272,5 @@ void SceneElement::setSpriteY(int value)
 void SceneElement::unlink()
 {
 	if (scene)
-		scene->elements.remove(link);
+		scene->remove(*this);
 }
@@ -27,6 +27,8 @@
 #include "etc.h"
 #include "etc-internal.h"
 
+#include <set>
+
 class SceneElement;
 class Viewport;
 class WindowVX;
@@ -61,21 +63,69 @@ public:
 
 	const Geometry &getGeometry() const { return geometry; }
 
+	struct CullStats
+	{
+		/* Visible elements that were drawn */
+		int drawn;
+
+		/* Visible elements that were skipped because
+		 * they couldn't have drawn anything, eg. lying
+		 * outside their scene */
+		int culled;
+	};
+
+	/* Totals of the last screen composite */
+	static const CullStats &getCullStats() { return cullStats; }
+
 protected:
 	void insert(SceneElement &element);
 	void insertAfter(SceneElement &element, SceneElement &after);
+	void remove(SceneElement &element);
+
+	/* To be called right after the element's Z or sprite Y
+	 * changed. The element keeps its old place in 'elements'
+	 * until the next 'sortPending()', so moving many elements
+	 * in one frame only costs a tree insertion each */
 	void reinsert(SceneElement &element);
 
+	/* Moves all elements passed to 'reinsert()' to their
+	 * new place. Done before each composite, and by tilemaps
+	 * before they look for neighbouring zlayers */
+	void sortPending();
+
 	/* Notify all elements that geometry has changed */
 	void notifyGeometryChange();
 
+	struct ElementLess
+	{
+		bool operator()(const SceneElement *a, const SceneElement *b) const;
+	};
+
+	typedef std::set<SceneElement*, ElementLess> Index;
+
+	/* In draw order */
 	IntruList<SceneElement> elements;
+
+	/* Finds an element's place in 'elements' in O(log n).
+	 * Holds every element in 'elements' except for the
+	 * ones in 'pending' */
+	Index index;
+	IntruList<SceneElement> pending;
+
 	Geometry geometry;
 
+	/* Reset by the screen before each composite.
+	 * The libretro core doesn't cull */
+	static CullStats cullStats;
+
 	friend class SceneElement;
 	friend class Window;
 	friend class WindowVX;
 	friend struct ZLayer;
+	friend struct TilemapPrivate;
+
+private:
+	void linkIndexed(SceneElement &element);
 };
 
 class SceneElement
@@ -112,6 +162,17 @@ protected:
 	 */
 	virtual void draw() = 0;
 
+	/* Elements that may append to the SpriteBatch instead of
+	 * drawing right away. They must flush the batch themselves
+	 * before drawing anything else; for all other elements,
+	 * Scene flushes it before calling 'draw()' */
+	virtual bool batchable() const { return false; }
+
+	/* The area the element may draw to, in the coordinates
+	 * of its scene's rect. Elements that can't tell cheaply
+	 * return false and are never culled */
+	virtual bool getBounds(IntRect &) const { return false; }
+
 	// FIXME: This should be a signal
 	virtual void onGeometryChange(const Scene::Geometry &) {}
 
@@ -123,6 +184,8 @@ protected:
 	void unlink();
 
 	IntruListLink<SceneElement> link;
+	IntruListLink<SceneElement> pendingLink;
+	Scene::Index::iterator indexIter;
 	const unsigned int creationStamp;
 	int z;
 	bool visible;
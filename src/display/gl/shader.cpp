@@ -46,6 +46,8 @@
 #include "simpleAlphaUni.frag.xxd"
 #include "tilemap.frag.xxd"
 #include "flashMap.frag.xxd"
+#include "glyphMask.frag.xxd"
+#include "textCompose.frag.xxd"
 #include "bicubic.frag.xxd"
 #include "lanczos3.frag.xxd"
 #ifdef MKXPZ_SSL
@@ -143,14 +145,14 @@ std::string &Shader::commonHeader() {
 }
 #endif
 
-static void setupShaderSource(GLuint shader, GLenum type,
-                              const unsigned char *body, int bodySize)
+/* Assembles the full source of a shader from our defines,
+ * the common header and its body; returns the part count */
+static size_t shaderSourceParts(GLenum type, const unsigned char *body, int bodySize,
+                                const GLchar *shaderSrc[4], GLint shaderSrcSize[4])
 {
 	static const char glesDefine[] = "#define GLSLES\n";
 	static const char fragDefine[] = "#define FRAGMENT_SHADER\n";
 
-	const GLchar *shaderSrc[4];
-	GLint shaderSrcSize[4];
 	size_t i = 0;
 
 	if (gl.glsles)
@@ -180,7 +182,46 @@ static void setupShaderSource(GLuint shader, GLenum type,
 	shaderSrcSize[i] = bodySize;
 	++i;
 
-	gl.ShaderSource(shader, i, shaderSrc, shaderSrcSize);
+	return i;
+}
+
+static void setupShaderSource(GLuint shader, GLenum type,
+                              const unsigned char *body, int bodySize)
+{
+	const GLchar *shaderSrc[4];
+	GLint shaderSrcSize[4];
+
+	size_t count = shaderSourceParts(type, body, bodySize, shaderSrc, shaderSrcSize);
+
+	gl.ShaderSource(shader, count, shaderSrc, shaderSrcSize);
+}
+
+/* Everything a linked program depends on, for ProgramCache */
+static std::string programSource(const unsigned char *vert, int vertSize,
+                                 const unsigned char *frag, int fragSize)
+{
+	std::string source;
+
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const unsigned char *bodies[] = { vert, frag };
+	const int bodySizes[] = { vertSize, fragSize };
+
+	for (size_t i = 0; i < 2; ++i)
+	{
+		const GLchar *shaderSrc[4];
+		GLint shaderSrcSize[4];
+
+		size_t count = shaderSourceParts(types[i], bodies[i], bodySizes[i],
+		                                 shaderSrc, shaderSrcSize);
+
+		for (size_t j = 0; j < count; ++j)
+			source.append(shaderSrc[j], shaderSrcSize[j]);
+
+		/* Keep the vertex/fragment boundary unambiguous */
+		source.push_back('\0');
+	}
+
+	return source;
 }
 
 void Shader::init(const unsigned char *vert, int vertSize,
@@ -188,6 +229,13 @@ void Shader::init(const unsigned char *vert, int vertSize,
                   const char *vertName, const char *fragName,
                   const char *programName)
 {
+	ProgramCache &cache = shState->shaders().programCache;
+	const std::string source = programSource(vert, vertSize, frag, fragSize);
+
+	/* Attribute locations are part of the binary */
+	if (cache.load(program, source))
+		return;
+
 	GLint success;
 
 	/* Compile vertex shader */
@@ -226,6 +274,7 @@ void Shader::init(const unsigned char *vert, int vertSize,
 	gl.BindAttribLocation(program, TexCoord, "texCoord");
 	gl.BindAttribLocation(program, Color, "color");
 
+	cache.prepareLink(program);
 	gl.LinkProgram(program);
 
 	gl.GetProgramiv(program, GL_LINK_STATUS, &success);
@@ -237,6 +286,8 @@ void Shader::init(const unsigned char *vert, int vertSize,
 	                    "GLSL: An error occured while linking program '%s' (vertex '%s', fragment '%s')",
 	                    programName, vertName, fragName);
 	}
+
+	cache.store(program, source);
 }
 
 void Shader::initFromFile(const char *_vertFile, const char *_fragFile,
@@ -715,7 +766,7 @@ void TilemapShader::setATFrames(int values[7])
 
 FlashMapShader::FlashMapShader()
 {
-	INIT_SHADER(simpleColor, flashMap, FlashMapShader);
+	INIT_SHADER(simple, flashMap, FlashMapShader);
 
 	ShaderBase::init();
 
@@ -820,6 +871,39 @@ void BltShader::setOpacity(float value)
 	gl.Uniform1f(u_opacity, value);
 }
 
+GlyphMaskShader::GlyphMaskShader()
+{
+	INIT_SHADER(simpleColor, glyphMask, GlyphMaskShader);
+
+	ShaderBase::init();
+}
+
+TextComposeShader::TextComposeShader()
+{
+	INIT_SHADER(simple, textCompose, TextComposeShader);
+
+	ShaderBase::init();
+
+	GET_U(fillColor);
+	GET_U(outColor);
+	GET_U(outline);
+}
+
+void TextComposeShader::setFillColor(const Vec4 &value)
+{
+	setVec4Uniform(u_fillColor, value);
+}
+
+void TextComposeShader::setOutColor(const Vec4 &value)
+{
+	setVec4Uniform(u_outColor, value);
+}
+
+void TextComposeShader::setOutline(bool value)
+{
+	gl.Uniform1f(u_outline, value ? 1.0f : 0.0f);
+}
+
 BicubicShader::BicubicShader()
 {
 	INIT_SHADER(simple, bicubic, BicubicShader);
@@ -25,6 +25,7 @@
 #include "etc-internal.h"
 #include "gl-util.h"
 #include "glstate.h"
+#include "programcache.h"
 
 class Shader
 {
@@ -330,6 +331,25 @@ private:
 	GLint u_source, u_destination, u_subRect, u_opacity;
 };
 
+class GlyphMaskShader : public ShaderBase
+{
+public:
+	GlyphMaskShader();
+};
+
+class TextComposeShader : public ShaderBase
+{
+public:
+	TextComposeShader();
+
+	void setFillColor(const Vec4 &value);
+	void setOutColor(const Vec4 &value);
+	void setOutline(bool value);
+
+private:
+	GLint u_fillColor, u_outColor, u_outline;
+};
+
 class Lanczos3Shader : public SimpleShader
 {
 public:
@@ -398,36 +418,81 @@ protected:
 	GLint u_targetScale;
 };
 
+/* Compiles its shader the first time it is used,
+ * so startup doesn't pay for shaders a game never
+ * touches (eg. the upscaling ones) */
+template<class S>
+class LazyShader
+{
+public:
+	LazyShader()
+	    : shader(0)
+	{}
+
+	~LazyShader()
+	{
+		delete shader;
+	}
+
+	S &get()
+	{
+		if (!shader)
+			shader = new S;
+
+		return *shader;
+	}
+
+	operator S&()
+	{
+		return get();
+	}
+
+private:
+	LazyShader(const LazyShader&);
+	LazyShader &operator=(const LazyShader&);
+
+	S *shader;
+};
+
 /* Global object containing all available shaders */
 struct ShaderSet
 {
-	FlatColorShader flatColor;
-	SimpleShader simple;
-	SimpleColorShader simpleColor;
-	SimpleAlphaShader simpleAlpha;
-	SimpleSpriteShader simpleSprite;
-	AlphaSpriteShader alphaSprite;
-	SpriteShader sprite;
-	PlaneShader plane;
-	GrayShader gray;
-	TilemapShader tilemap;
-	FlashMapShader flashMap;
-	TransShader trans;
-	SimpleTransShader simpleTrans;
-	HueShader hue;
-	BltShader blt;
-	SimpleMatrixShader simpleMatrix;
-	BlurShader blur;
-	TilemapVXShader tilemapVX;
-	BicubicShader bicubic;
-	Lanczos3Shader lanczos3;
+	/* 'cacheDir' is passed on to ProgramCache */
+	ShaderSet(const std::string &cacheDir)
+	    : programCache(cacheDir)
+	{}
+
+	ProgramCache programCache;
+
+	LazyShader<FlatColorShader> flatColor;
+	LazyShader<SimpleShader> simple;
+	LazyShader<SimpleColorShader> simpleColor;
+	LazyShader<SimpleAlphaShader> simpleAlpha;
+	LazyShader<SimpleSpriteShader> simpleSprite;
+	LazyShader<AlphaSpriteShader> alphaSprite;
+	LazyShader<SpriteShader> sprite;
+	LazyShader<PlaneShader> plane;
+	LazyShader<GrayShader> gray;
+	LazyShader<TilemapShader> tilemap;
+	LazyShader<FlashMapShader> flashMap;
+	LazyShader<TransShader> trans;
+	LazyShader<SimpleTransShader> simpleTrans;
+	LazyShader<HueShader> hue;
+	LazyShader<BltShader> blt;
+	LazyShader<GlyphMaskShader> glyphMask;
+	LazyShader<TextComposeShader> textCompose;
+	LazyShader<SimpleMatrixShader> simpleMatrix;
+	LazyShader<BlurShader> blur;
+	LazyShader<TilemapVXShader> tilemapVX;
+	LazyShader<BicubicShader> bicubic;
+	LazyShader<Lanczos3Shader> lanczos3;
 #ifdef MKXPZ_SSL
-	XbrzShader xbrz;
+	LazyShader<XbrzShader> xbrz;
 #endif
-	Lanczos3SpriteShader lanczos3Sprite;
-	BicubicSpriteShader bicubicSprite;
+	LazyShader<Lanczos3SpriteShader> lanczos3Sprite;
+	LazyShader<BicubicSpriteShader> bicubicSprite;
 #ifdef MKXPZ_SSL
-	XbrzSpriteShader xbrzSprite;
+	LazyShader<XbrzSpriteShader> xbrzSprite;
 #endif
 };
 
@@ -628,24 +628,18 @@ onTile(Reader &reader, int16_t tileID,
 }
 
 static void
-readLayer(Reader &reader, const Table &data,
-          const Table *flags, int ox, int oy, int w, int h, int z)
+readLayerRow(Reader &reader, const Table &data, const Table *flags,
+             int ox, int w, int y, int posY, int z)
 {
-	/* The table autotile pattern (A2) has two quads (table
-	 * legs, etc.) which extend over the tile below. We process
-	 * the tiles in rows from bottom to top so the table extents
-	 * are added after the tile below and drawn over it. */
-
-	for (int y = h-1; y >= 0; --y)
-		for (int x = 0; x < w; ++x)
-		{
-			int16_t tileID = tableGetWrapped(data, x+ox, y+oy, z);
+	for (int x = 0; x < w; ++x)
+	{
+		int16_t tileID = tableGetWrapped(data, x+ox, y, z);
 
-			if (tileID <= 0)
-				continue;
+		if (tileID <= 0)
+			continue;
 
-			onTile(reader, tileID, x, y, flags);
-		}
+		onTile(reader, tileID, x, posY, flags);
+	}
 }
 
 static void
@@ -664,27 +658,44 @@ onShadowTile(Reader &reader, int8_t value,
 }
 
 static void
-readShadowLayer(Reader &reader, const Table &data,
-                int ox, int oy, int w, int h)
+readShadowRow(Reader &reader, const Table &data,
+              int ox, int w, int y, int posY)
 {
-	for (int y = 0; y < h; ++y)
-		for (int x = 0; x < w; ++x)
-		{
-			int16_t value = tableGetWrapped(data, x+ox, y+oy, 3);
-			onShadowTile(reader, value & 0xF, x, y);
-		}
+	for (int x = 0; x < w; ++x)
+	{
+		int16_t value = tableGetWrapped(data, x+ox, y, 3);
+		onShadowTile(reader, value & 0xF, x, posY);
+	}
 }
 
-void readTiles(Reader &reader, const Table &data,
-               const Table *flags, int ox, int oy, int w, int h)
+bool passReadsUpward(int pass)
 {
-	for (int i = 0; i < 2; ++i)
-		readLayer(reader, data, flags, ox, oy, w, h, i);
-
-	if (rgssVer >= 3)
-		readShadowLayer(reader, data, ox, oy, w, h);
+	/* The table autotile pattern (A2) has two quads (table
+	 * legs, etc.) which extend over the tile below. We process
+	 * the tiles in rows from bottom to top so the table extents
+	 * are added after the tile below and drawn over it. */
+	return pass != PassShadows;
+}
 
-	readLayer(reader, data, flags, ox, oy, w, h, 2);
+void readRow(Reader &reader, const Table &data, const Table *flags,
+             int pass, int ox, int w, int y, int posY)
+{
+	switch (pass)
+	{
+	case PassLayer0 :
+		readLayerRow(reader, data, flags, ox, w, y, posY, 0);
+		break;
+	case PassLayer1 :
+		readLayerRow(reader, data, flags, ox, w, y, posY, 1);
+		break;
+	case PassShadows :
+		if (rgssVer >= 3)
+			readShadowRow(reader, data, ox, w, y, posY);
+		break;
+	case PassLayer2 :
+		readLayerRow(reader, data, flags, ox, w, y, posY, 2);
+		break;
+	}
 }
 
 }
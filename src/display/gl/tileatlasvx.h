@@ -58,8 +58,27 @@ struct Reader
 
 void build(TEXFBO &tf, Bitmap *bitmaps[BM_COUNT]);
 
-void readTiles(Reader &reader, const Table &data,
-               const Table *flags, int ox, int oy, int w, int h);
+/* Tiles are read in passes: map layers 0 and 1, the shadow
+ * layer (RGSS3 only), then map layer 2. Quads are expected
+ * to be drawn in pass order, and row by row within a pass */
+enum ReadPass
+{
+	PassLayer0,
+	PassLayer1,
+	PassShadows,
+	PassLayer2,
+
+	ReadPassCount
+};
+
+/* Whether the rows of 'pass' go from the bottom to the top */
+bool passReadsUpward(int pass);
+
+/* Reads 'w' tiles of map row 'y', starting at column 'ox',
+ * for one pass. Quads are placed relative to column 'ox',
+ * in row 'posY' */
+void readRow(Reader &reader, const Table &data, const Table *flags,
+             int pass, int ox, int w, int y, int posY);
 }
 
 #endif // TILEATLASVX_H
@@ -0,0 +1,432 @@
+/*
+** glyphcache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "glyphcache.h"
+
+#include "sharedstate.h"
+#include "glstate.h"
+#include "shader.h"
+#include "util.h"
+
+#include <SDL_ttf.h>
+
+#include <algorithm>
+
+/* Big enough for a few thousand glyphs at common sizes;
+ * when it runs full, all glyphs are dropped and re-rendered
+ * on demand */
+static const int atlasMaxSize = 1024;
+
+/* Gap between glyphs so they never bleed into each other */
+static const int glyphPadding = 1;
+
+/* Coverage mask channels, see glyphMask.frag */
+static const Vec4 outlineChannel(1, 0, 0, 1);
+static const Vec4 shadowChannel(0, 1, 0, 1);
+static const Vec4 fillChannel(0, 0, 1, 1);
+
+static bool decodeUTF8(const char *str, std::vector<uint32_t> &out)
+{
+	const unsigned char *s = reinterpret_cast<const unsigned char*>(str);
+
+	out.clear();
+
+	while (*s)
+	{
+		uint32_t ch;
+		int extra;
+
+		if (s[0] < 0x80)
+		{
+			ch = s[0];
+			extra = 0;
+		}
+		else if ((s[0] & 0xE0) == 0xC0)
+		{
+			ch = s[0] & 0x1F;
+			extra = 1;
+		}
+		else if ((s[0] & 0xF0) == 0xE0)
+		{
+			ch = s[0] & 0x0F;
+			extra = 2;
+		}
+		else if ((s[0] & 0xF8) == 0xF0)
+		{
+			ch = s[0] & 0x07;
+			extra = 3;
+		}
+		else
+		{
+			return false;
+		}
+
+		for (int i = 1; i <= extra; ++i)
+		{
+			if ((s[i] & 0xC0) != 0x80)
+				return false;
+
+			ch = (ch << 6) | (s[i] & 0x3F);
+		}
+
+		out.push_back(ch);
+		s += extra + 1;
+	}
+
+	return true;
+}
+
+bool GlyphCache::FaceKey::operator<(const FaceKey &o) const
+{
+	if (font != o.font)
+		return font < o.font;
+
+	if (style != o.style)
+		return style < o.style;
+
+	if (solid != o.solid)
+		return solid < o.solid;
+
+	return outline < o.outline;
+}
+
+GlyphCache::GlyphCache()
+    : shelvesH(0)
+{
+	atlasSize = std::min(atlasMaxSize, glState.caps.maxTexSize);
+
+	atlas = TEX::gen();
+	TEX::bind(atlas);
+	TEX::setRepeat(false);
+	TEX::setSmooth(false);
+	TEX::allocEmpty(atlasSize, atlasSize);
+
+	TEXFBO::init(mask);
+	TEXFBO::allocEmpty(mask, 256, 64);
+	TEXFBO::linkFBO(mask);
+
+	TEXFBO::init(run);
+	TEXFBO::allocEmpty(run, 256, 64);
+	TEXFBO::linkFBO(run);
+}
+
+GlyphCache::~GlyphCache()
+{
+	TEX::del(atlas);
+	TEXFBO::fini(mask);
+	TEXFBO::fini(run);
+}
+
+void GlyphCache::reset()
+{
+	faces.clear();
+	shelves.clear();
+	shelvesH = 0;
+}
+
+bool GlyphCache::allocRect(int w, int h, IntRect &out)
+{
+	w += glyphPadding;
+	h += glyphPadding;
+
+	if (w > atlasSize || h > atlasSize)
+		return false;
+
+	/* Pick the tightest shelf with room left */
+	Shelf *best = 0;
+
+	for (size_t i = 0; i < shelves.size(); ++i)
+	{
+		Shelf &shelf = shelves[i];
+
+		if (h > shelf.h || shelf.usedW + w > atlasSize)
+			continue;
+
+		if (!best || shelf.h < best->h)
+			best = &shelf;
+	}
+
+	if (!best)
+	{
+		if (shelvesH + h > atlasSize)
+			return false;
+
+		Shelf shelf = { shelvesH, h, 0 };
+		shelves.push_back(shelf);
+		shelvesH += h;
+
+		best = &shelves.back();
+	}
+
+	out = IntRect(best->usedW, best->y, w - glyphPadding, h - glyphPadding);
+	best->usedW += w;
+
+	return true;
+}
+
+const GlyphCache::Glyph *
+GlyphCache::getGlyph(const FaceKey &key, Face &face, uint32_t ch)
+{
+	Face::const_iterator iter = face.find(ch);
+
+	if (iter != face.end())
+		return &iter->second;
+
+	TTF_Font *font = key.font;
+
+	/* SDL_ttf draws a box for these; leave that to it */
+	if (!TTF_GlyphIsProvided32(font, ch))
+		return 0;
+
+	TTF_SetFontOutline(font, key.outline);
+
+	Glyph glyph;
+	int minX, maxX, minY, maxY;
+	TTF_GlyphMetrics32(font, ch, &minX, &maxX, &minY, &maxY, &glyph.advance);
+
+	/* Same as the text surface origin SDL_ttf picks
+	 * when laying out a run (left overhang included) */
+	glyph.offsetX = std::min(minX, 0);
+
+	const SDL_Color white = { 255, 255, 255, 255 };
+	SDL_Surface *surf = key.solid ? TTF_RenderGlyph32_Solid(font, ch, white)
+	                              : TTF_RenderGlyph32_Blended(font, ch, white);
+
+	TTF_SetFontOutline(font, 0);
+
+	if (!surf)
+		return 0;
+
+	if (!allocRect(surf->w, surf->h, glyph.rect))
+	{
+		SDL_FreeSurface(surf);
+
+		/* Atlas is full; start over with the next run */
+		reset();
+
+		return 0;
+	}
+
+	/* Store coverage only; color is applied when composing */
+	uploadBuf.resize(surf->w * surf->h * 4);
+	uint8_t *dst = dataPtr(uploadBuf);
+
+	for (int y = 0; y < surf->h; ++y)
+	{
+		const uint8_t *row = (const uint8_t*) surf->pixels + y * surf->pitch;
+
+		for (int x = 0; x < surf->w; ++x, dst += 4)
+		{
+			uint8_t r, g, b, a;
+
+			if (surf->format->BytesPerPixel == 1)
+				a = row[x] ? 255 : 0;
+			else
+				SDL_GetRGBA(((const uint32_t*) row)[x], surf->format, &r, &g, &b, &a);
+
+			dst[0] = dst[1] = dst[2] = 255;
+			dst[3] = a;
+		}
+	}
+
+	TEX::bind(atlas);
+	TEX::uploadSubImage(glyph.rect.x, glyph.rect.y, glyph.rect.w, glyph.rect.h,
+	                    dataPtr(uploadBuf), GL_RGBA);
+
+	SDL_FreeSurface(surf);
+
+	return &(face[ch] = glyph);
+}
+
+void GlyphCache::emitQuad(const Glyph &glyph, const Vec2i &pos, const Vec4 &channel)
+{
+	if (glyph.rect.w == 0 || glyph.rect.h == 0)
+		return;
+
+	size_t index = quads.vertices.size();
+	quads.vertices.resize(index + 4);
+
+	Vertex *vert = &quads.vertices[index];
+	Quad::setTexPosRect(vert, glyph.rect,
+	                    IntRect(pos.x, pos.y, glyph.rect.w, glyph.rect.h));
+
+	for (int i = 0; i < 4; ++i)
+		vert[i].color = channel;
+}
+
+int GlyphCache::layoutFace(const FaceKey &key, const Vec2i &origin,
+                           const Vec4 &channel, bool &ok)
+{
+	Face &face = faces[key];
+
+	std::vector<const Glyph*> glyphs(codepoints.size());
+	std::vector<int> posX(codepoints.size());
+
+	int pen = 0;
+	int start = 0;
+
+	for (size_t i = 0; i < codepoints.size(); ++i)
+	{
+		const Glyph *glyph = getGlyph(key, face, codepoints[i]);
+
+		if (!glyph)
+		{
+			/* 'face' might be gone at this point */
+			ok = false;
+			return 0;
+		}
+
+		if (i > 0)
+			pen += TTF_GetFontKerningSizeGlyphs32(key.font, codepoints[i-1], codepoints[i]);
+
+		glyphs[i] = glyph;
+		posX[i] = pen + glyph->offsetX;
+		start = std::min(start, posX[i]);
+
+		pen += glyph->advance;
+	}
+
+	for (size_t i = 0; i < glyphs.size(); ++i)
+		emitQuad(*glyphs[i], Vec2i(origin.x + posX[i] - start, origin.y), channel);
+
+	ok = true;
+	return pen;
+}
+
+void GlyphCache::ensureSize(TEXFBO &tex, int w, int h)
+{
+	if (tex.width >= w && tex.height >= h)
+		return;
+
+	TEXFBO::allocEmpty(tex, findNextPow2(std::max(w, tex.width)),
+	                        findNextPow2(std::max(h, tex.height)));
+}
+
+bool GlyphCache::render(_TTF_Font *font, const char *str,
+                        const Style &style, Run &out)
+{
+	if (!decodeUTF8(str, codepoints) || codepoints.empty())
+		return false;
+
+	int textW, textH;
+
+	if (TTF_SizeUTF8(font, str, &textW, &textH) < 0)
+		return false;
+
+	/* Same dimensions as the surfaces applyShadow()
+	 * and TTF_SetFontOutline() produce */
+	const int extra = (style.shadow ? 1 : 0) + style.outline * 2;
+	const Vec2i size(textW + extra, textH + extra);
+
+	if (size.x > glState.caps.maxTexSize || size.y > glState.caps.maxTexSize)
+		return false;
+
+	FaceKey key;
+	key.font = font;
+	key.style = TTF_GetFontStyle(font);
+	key.solid = style.solid;
+	key.outline = 0;
+
+	quads.clear();
+
+	bool ok;
+
+	if (style.outline)
+	{
+		FaceKey outKey = key;
+		outKey.outline = style.outline;
+
+		layoutFace(outKey, Vec2i(), outlineChannel, ok);
+
+		if (!ok)
+			return false;
+	}
+
+	const Vec2i textPos(style.outline, style.outline);
+
+	if (style.shadow)
+	{
+		layoutFace(key, textPos + Vec2i(1, 1), shadowChannel, ok);
+
+		if (!ok)
+			return false;
+	}
+
+	layoutFace(key, textPos, fillChannel, ok);
+
+	if (!ok)
+		return false;
+
+	quads.quadCount = quads.vertices.size() / 4;
+	quads.commit();
+
+	ensureSize(mask, size.x, size.y);
+	ensureSize(run, size.x, size.y);
+
+	glState.viewport.pushSet(IntRect(0, 0, size.x, size.y));
+	glState.clearColor.pushSet(Vec4());
+
+	/* Accumulate the coverage of each layer into its own channel */
+	FBO::bind(mask.fbo);
+	FBO::clear();
+
+	GlyphMaskShader &maskShader = shState->shaders().glyphMask;
+	maskShader.bind();
+	maskShader.applyViewportProj();
+	maskShader.setTranslation(Vec2i());
+	maskShader.setTexSize(Vec2i(atlasSize, atlasSize));
+
+	TEX::bind(atlas);
+
+	glState.blendMode.pushSet(BlendAddition);
+	quads.draw();
+	glState.blendMode.pop();
+
+	/* Then color and layer them into the final text */
+	FBO::bind(run.fbo);
+
+	TextComposeShader &shader = shState->shaders().textCompose;
+	shader.bind();
+	shader.applyViewportProj();
+	shader.setTranslation(Vec2i());
+	shader.setTexSize(Vec2i(mask.width, mask.height));
+	shader.setFillColor(style.color);
+	shader.setOutColor(style.outColor);
+	shader.setOutline(style.outline > 0);
+
+	TEX::bind(mask.tex);
+
+	const IntRect runRect(Vec2i(), size);
+	composeQuad.setTexPosRect(runRect, runRect);
+
+	glState.blend.pushSet(false);
+	composeQuad.draw();
+	glState.blend.pop();
+
+	glState.clearColor.pop();
+	glState.viewport.pop();
+
+	out.tex = &run;
+	out.size = size;
+	out.textHeight = textH;
+
+	return true;
+}
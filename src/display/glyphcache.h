@@ -0,0 +1,134 @@
+/*
+** glyphcache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+
+#include "etc-internal.h"
+#include "gl-util.h"
+#include "quad.h"
+#include "quadarray.h"
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+struct _TTF_Font;
+
+/* Keeps rendered glyphs of every font variant in one texture
+ * atlas, so that Bitmap::drawText can lay text out as a batch
+ * of quads instead of having SDL_ttf render (and us upload)
+ * a fresh surface on every call */
+class GlyphCache
+{
+public:
+	struct Style
+	{
+		bool solid;
+		bool shadow;
+		/* Outline thickness in pixels, 0 for none */
+		int outline;
+
+		Vec4 color;
+		Vec4 outColor;
+	};
+
+	struct Run
+	{
+		/* Holds the composed text in its top left corner */
+		TEXFBO *tex;
+		Vec2i size;
+
+		/* Height of the plain text, without shadow or outline */
+		int textHeight;
+	};
+
+	GlyphCache();
+	~GlyphCache();
+
+	/* Renders 'str' with the same layering as the SDL_ttf
+	 * path of Bitmap::drawText. Returns false if the text
+	 * can't be handled here (eg. glyphs missing from the
+	 * font), in which case the caller has to fall back to
+	 * rendering it through SDL_ttf */
+	bool render(_TTF_Font *font, const char *str,
+	            const Style &style, Run &out);
+
+private:
+	struct Glyph
+	{
+		/* Location in the atlas */
+		IntRect rect;
+
+		/* Offset of the glyph cell from the pen position */
+		int offsetX;
+		int advance;
+	};
+
+	struct FaceKey
+	{
+		_TTF_Font *font;
+		int style;
+		bool solid;
+		int outline;
+
+		bool operator<(const FaceKey &o) const;
+	};
+
+	typedef std::map<uint32_t, Glyph> Face;
+
+	const Glyph *getGlyph(const FaceKey &key, Face &face, uint32_t ch);
+	bool allocRect(int w, int h, IntRect &out);
+	void reset();
+
+	int layoutFace(const FaceKey &key, const Vec2i &origin,
+	               const Vec4 &channel, bool &ok);
+	void emitQuad(const Glyph &glyph, const Vec2i &pos, const Vec4 &channel);
+
+	static void ensureSize(TEXFBO &tex, int w, int h);
+
+	std::map<FaceKey, Face> faces;
+
+	TEX::ID atlas;
+	int atlasSize;
+
+	/* Glyphs are packed into horizontal shelves */
+	struct Shelf
+	{
+		int y, h;
+		int usedW;
+	};
+
+	std::vector<Shelf> shelves;
+	int shelvesH;
+
+	/* Coverage masks of the current run, and the composed result */
+	TEXFBO mask;
+	TEXFBO run;
+
+	ColorQuadArray quads;
+	Quad composeQuad;
+
+	std::vector<uint32_t> codepoints;
+	std::vector<uint8_t> uploadBuf;
+};
+
+#endif // GLYPHCACHE_H
@@ -36,6 +36,8 @@
 #include "gl-util.h"
 #include "glstate.h"
 #include "intrulist.h"
+#include "preparequeue.h"
+#include "frameprofiler.h"
 #include "quad.h"
 #include "scene.h"
 #include "shader.h"
@@ -508,7 +510,16 @@ public:
         const int w = geometry.rect.w;
         const int h = geometry.rect.h;
         
-        shState->prepareDraw();
+        {
+            FrameProfiler::Scope prepare(FrameProfiler::Prepare);
+            shState->prepareDraw();
+        }
+        {
+            FrameProfiler::Scope flush(FrameProfiler::Flush);
+            shState->prepareQueue().flush();
+        }
+        
+        FrameProfiler::Scope composite(FrameProfiler::Composite);
         
         pp.startRender();
         
@@ -516,6 +527,7 @@ public:
         
         FBO::clear();
         
+        cullStats = CullStats();
         Scene::composite();
         
         if (brightEffect) {
@@ -1002,8 +1014,14 @@ struct GraphicsPrivate {
     }
     
     void swapGLBuffer() {
-        fpsLimiter.delay();
-        SDL_GL_SwapWindow(threadData->window);
+        {
+            FrameProfiler::Scope sleep(FrameProfiler::Sleep);
+            fpsLimiter.delay();
+        }
+        {
+            FrameProfiler::Scope swap(FrameProfiler::Swap);
+            SDL_GL_SwapWindow(threadData->window);
+        }
         
         ++frameCount;
         
@@ -1045,6 +1063,8 @@ struct GraphicsPrivate {
     void redrawScreen() {
         screen.composite();
         
+        FrameProfiler::Scope submit(FrameProfiler::Submit);
+        
         // maybe unspaghetti this later
         if (integerScaleStepApplicable() && !integerLastMileScaling)
         {
@@ -1057,6 +1077,7 @@ struct GraphicsPrivate {
             metaBlitBufferFlippedScaled(scRes, scaleIsSpecial, true);
             GLMeta::blitEnd();
             
+            submit.stop();
             swapGLBuffer();
             return;
         }
@@ -1107,6 +1128,7 @@ struct GraphicsPrivate {
         
         GLMeta::blitEnd();
         
+        submit.stop();
         swapGLBuffer();
         
         updateAvgFPS();
@@ -1184,7 +1206,15 @@ double Graphics::lastUpdate() {
     return p->last_update;
 }
 
+/* Closes the profiled frame on every way out of Graphics::update */
+struct ProfiledUpdate {
+    ProfiledUpdate() { shState->frameProfiler().updateBegin(); }
+    ~ProfiledUpdate() { shState->frameProfiler().updateEnd(); }
+};
+
 void Graphics::update(bool checkForShutdown) {
+    ProfiledUpdate profiled;
+    
     p->threadData->rqWindowAdjust.wait();
     p->last_update = shState->runTime();
     
@@ -1214,6 +1244,7 @@ void Graphics::update(bool checkForShutdown) {
     if (p->fpsLimiter.frameSkipRequired()) {
         if (p->useFrameSkip) {
             /* Skip frame */
+            FrameProfiler::Scope sleep(FrameProfiler::Sleep);
             p->fpsLimiter.delay();
             ++p->frameCount;
             p->threadData->ethread->notifyFrame();
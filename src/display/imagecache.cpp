@@ -0,0 +1,270 @@
+/*
+** imagecache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imagecache.h"
+
+#include "filesystem.h"
+#include "cachedir.h"
+#include "debugwriter.h"
+
+#include <SDL_image.h>
+#include <SDL_mutex.h>
+#include <physfs.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define FORMAT_VER 1
+
+static const char magic[8] = { 'M', 'K', 'X', 'P', 'I', 'M', 'G', FORMAT_VER };
+
+struct Header
+{
+	char magic[8];
+
+	uint32_t width;
+	uint32_t height;
+
+	/* Identity of the source file */
+	int64_t modTime;
+	int64_t fileSize;
+	int64_t dirModTime;
+	int64_t dirSize;
+
+	/* Length of the key following the header */
+	uint32_t keyLen;
+	uint32_t pad;
+};
+
+struct ImageCache::Source
+{
+	/* Real directory or archive + search path */
+	std::string key;
+
+	int64_t modTime;
+	int64_t fileSize;
+
+	/* Only meaningful for archives, where
+	 * entries often carry no timestamp */
+	int64_t dirModTime;
+	int64_t dirSize;
+};
+
+static bool readSource(const char *path, std::string &key,
+                       int64_t &modTime, int64_t &fileSize,
+                       int64_t &dirModTime, int64_t &dirSize)
+{
+	const char *realDir = PHYSFS_getRealDir(path);
+	PHYSFS_Stat st;
+
+	if (!realDir || !PHYSFS_stat(path, &st))
+		return false;
+
+	key = std::string(realDir) + "|" + path;
+	modTime = st.modtime;
+	fileSize = st.filesize;
+
+	struct stat dirSt;
+
+	if (stat(realDir, &dirSt) == 0 && !S_ISDIR(dirSt.st_mode))
+	{
+		dirModTime = dirSt.st_mtime;
+		dirSize = dirSt.st_size;
+	}
+	else
+	{
+		dirModTime = dirSize = 0;
+	}
+
+	return true;
+}
+
+ImageCache::ImageCache(const std::string &dir, int64_t limit)
+    : usedBytes(0),
+      limit(limit)
+{
+	SDL_AtomicSet(&tmpCounter, 0);
+	usageMut = SDL_CreateMutex();
+
+	if (dir.empty())
+		return;
+
+	if (!mkxp_fs::createDirectories(dir.c_str()))
+	{
+		Debug() << "Image cache disabled, can't create" << dir;
+		return;
+	}
+
+	this->dir = dir;
+
+	/* The limit might have been lowered since the last launch */
+	usedBytes = trimCacheDir(dir, ".img", limit);
+}
+
+ImageCache::~ImageCache()
+{
+	SDL_DestroyMutex(usageMut);
+}
+
+void ImageCache::addUsage(int64_t bytes)
+{
+	SDL_LockMutex(usageMut);
+
+	usedBytes += bytes;
+
+	if (usedBytes > limit)
+		usedBytes = trimCacheDir(dir, ".img", limit);
+
+	SDL_UnlockMutex(usageMut);
+}
+
+SDL_Surface *ImageCache::decode(SDL_RWops &ops, const char *ext, const char *path)
+{
+	Source src;
+	bool cached = !dir.empty() && readSource(path, src.key, src.modTime, src.fileSize,
+	                                         src.dirModTime, src.dirSize);
+
+	if (cached)
+	{
+		SDL_Surface *surf = load(src);
+
+		if (surf)
+		{
+			SDL_RWclose(&ops);
+			return surf;
+		}
+	}
+
+	SDL_Surface *surf = IMG_LoadTyped_RW(&ops, 1, ext);
+
+	if (!surf)
+		return 0;
+
+	if (surf->format->format != SDL_PIXELFORMAT_ABGR8888)
+	{
+		SDL_Surface *conv = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_FreeSurface(surf);
+		surf = conv;
+
+		if (!surf)
+			return 0;
+	}
+
+	if (cached)
+		store(src, surf);
+
+	return surf;
+}
+
+static std::string entryPath(const std::string &dir, const std::string &key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.img", (unsigned long long) cacheHash(key.c_str(), key.size()));
+
+	return dir + name;
+}
+
+SDL_Surface *ImageCache::load(const Source &src)
+{
+	FILE *f = fopen(entryPath(dir, src.key).c_str(), "rb");
+
+	if (!f)
+		return 0;
+
+	Header hd;
+	std::string key;
+	SDL_Surface *surf = 0;
+
+	if (fread(&hd, sizeof(hd), 1, f) < 1)
+		goto fail;
+
+	if (memcmp(hd.magic, magic, sizeof(magic)) != 0 ||
+	    hd.modTime != src.modTime || hd.fileSize != src.fileSize ||
+	    hd.dirModTime != src.dirModTime || hd.dirSize != src.dirSize ||
+	    hd.keyLen != src.key.size())
+		goto fail;
+
+	/* Guard against hash collisions */
+	key.resize(hd.keyLen);
+
+	if (fread(&key[0], 1, hd.keyLen, f) < hd.keyLen || key != src.key)
+		goto fail;
+
+	/* Don't allocate a surface the entry can't fill */
+	if ((int64_t) hd.width * hd.height * 4 > cacheBytesLeft(f))
+		goto fail;
+
+	surf = SDL_CreateRGBSurfaceWithFormat(0, hd.width, hd.height, 32,
+	                                      SDL_PIXELFORMAT_ABGR8888);
+
+	if (!surf)
+		goto fail;
+
+	/* 32 bpp surfaces have no row padding */
+	if (fread(surf->pixels, surf->pitch, surf->h, f) < (size_t) surf->h)
+	{
+		SDL_FreeSurface(surf);
+		surf = 0;
+	}
+
+fail:
+	fclose(f);
+
+	return surf;
+}
+
+void ImageCache::store(const Source &src, SDL_Surface *surf)
+{
+	const std::string path = entryPath(dir, src.key);
+
+	/* Written under a unique name and moved into place,
+	 * so concurrent loads never see a partial entry */
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%d.tmp", SDL_AtomicAdd(&tmpCounter, 1));
+	const std::string tmpPath = path + suffix;
+
+	FILE *f = fopen(tmpPath.c_str(), "wb");
+
+	if (!f)
+		return;
+
+	Header hd;
+	memset(&hd, 0, sizeof(hd));
+	memcpy(hd.magic, magic, sizeof(magic));
+	hd.width = surf->w;
+	hd.height = surf->h;
+	hd.modTime = src.modTime;
+	hd.fileSize = src.fileSize;
+	hd.dirModTime = src.dirModTime;
+	hd.dirSize = src.dirSize;
+	hd.keyLen = src.key.size();
+
+	bool ok = fwrite(&hd, sizeof(hd), 1, f) == 1 &&
+	          fwrite(src.key.c_str(), 1, hd.keyLen, f) == hd.keyLen &&
+	          fwrite(surf->pixels, surf->pitch, surf->h, f) == (size_t) surf->h;
+
+	if (!finishCacheFile(f, ok, tmpPath, path))
+		return;
+
+	addUsage(sizeof(hd) + hd.keyLen + (int64_t) surf->pitch * surf->h);
+}
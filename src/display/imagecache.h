@@ -0,0 +1,78 @@
+/*
+** imagecache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <string>
+
+#include <SDL_atomic.h>
+#include <stdint.h>
+
+struct SDL_Surface;
+struct SDL_RWops;
+struct SDL_mutex;
+
+/* Keeps decoded images on disk as raw ABGR8888 pixels, so
+ * later launches can skip PNG/JPG decoding and conversion.
+ * Entries are keyed by the resolved search path of the file
+ * and the archive or directory it came from, and are
+ * discarded when their size or modification time changes.
+ * Once the entries outgrow the size limit, the oldest ones
+ * are deleted.
+ *
+ * Safe to use from any thread */
+class ImageCache
+{
+public:
+	/* 'dir' is created if missing. An empty
+	 * 'dir' disables the cache. 'limit' is in bytes */
+	ImageCache(const std::string &dir, int64_t limit);
+	~ImageCache();
+
+	/* Decodes the image file 'ops' (which is closed afterwards)
+	 * found at 'path' in the search path into an ABGR8888
+	 * surface, reading it from the cache if possible.
+	 * Returns 0 if the file can't be decoded */
+	SDL_Surface *decode(SDL_RWops &ops, const char *ext, const char *path);
+
+private:
+	struct Source;
+
+	SDL_Surface *load(const Source &src);
+	void store(const Source &src, SDL_Surface *surf);
+	void addUsage(int64_t bytes);
+
+	std::string dir;
+
+	/* Guards 'usedBytes' */
+	SDL_mutex *usageMut;
+
+	/* Size of all entries as of the last trim,
+	 * plus everything stored since */
+	int64_t usedBytes;
+	int64_t limit;
+
+	/* Makes temporary file names unique across threads */
+	SDL_atomic_t tmpCounter;
+};
+
+#endif // IMAGECACHE_H
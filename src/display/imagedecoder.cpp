@@ -0,0 +1,307 @@
+/*
+** imagedecoder.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imagedecoder.h"
+
+#include "sharedstate.h"
+#include "filesystem.h"
+#include "imagecache.h"
+#include "exception.h"
+#include "sdl-util.h"
+#include "util.h"
+
+#include <SDL_image.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_mutex.h>
+
+#include <algorithm>
+
+/* Decoding is mostly bound by inflate, so a few threads
+ * already keep up with any disk */
+static const int maxAutoThreads = 4;
+
+/* Decoded images that were prefetched but not (yet) loaded
+ * are dropped beyond this, so a script prefetching far ahead
+ * can't eat all memory */
+static const size_t maxHeldBytes = 256 * 1024 * 1024;
+
+struct DecodeOpenHandler : FileSystem::OpenHandler
+{
+	SDL_Surface *surface;
+
+	DecodeOpenHandler()
+	    : surface(0)
+	{}
+
+	bool tryRead(SDL_RWops &ops, const char *ext)
+	{
+		/* Bitmap decodes those frame by frame through libnsgif */
+		if (IMG_isGIF(&ops))
+		{
+			SDL_RWclose(&ops);
+
+			return true;
+		}
+
+		surface = shState->imageCache().decode(ops, ext, resolvedPath);
+
+		return surface != 0;
+	}
+};
+
+static size_t byteCount(SDL_Surface *surf)
+{
+	return (size_t) surf->pitch * surf->h;
+}
+
+ImageDecoder::ImageDecoder(int threadCount)
+    : heldBytes(0),
+      quit(false)
+{
+	if (threadCount <= 0)
+		threadCount = clamp(SDL_GetCPUCount() / 2, 1, maxAutoThreads);
+
+	mutex = SDL_CreateMutex();
+	workCond = SDL_CreateCond();
+	doneCond = SDL_CreateCond();
+
+	for (int i = 0; i < threadCount; ++i)
+		workers.push_back(createSDLThread
+			<ImageDecoder, &ImageDecoder::workerMain>(this, "imgdecode"));
+}
+
+ImageDecoder::~ImageDecoder()
+{
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondBroadcast(workCond);
+	SDL_UnlockMutex(mutex);
+
+	for (size_t i = 0; i < workers.size(); ++i)
+		SDL_WaitThread(workers[i], 0);
+
+	clear();
+
+	SDL_DestroyCond(doneCond);
+	SDL_DestroyCond(workCond);
+	SDL_DestroyMutex(mutex);
+}
+
+std::string ImageDecoder::makeKey(const char *filename)
+{
+	return shState->fileSystem().normalize(filename, false, false);
+}
+
+void ImageDecoder::prefetch(const char *filename)
+{
+	std::string key = makeKey(filename);
+
+	SDL_LockMutex(mutex);
+
+	if (requests.find(key) == requests.end())
+	{
+		Request *req = new Request;
+		req->filename = filename;
+		req->status = NotQueued;
+		req->done = false;
+		req->surface = 0;
+		req->dropped = false;
+
+		requests[key] = req;
+		queue.push_back(req);
+
+		SDL_CondSignal(workCond);
+	}
+
+	SDL_UnlockMutex(mutex);
+}
+
+bool ImageDecoder::isDone(const char *filename)
+{
+	std::string key = makeKey(filename);
+
+	SDL_LockMutex(mutex);
+
+	std::map<std::string, Request*>::iterator iter = requests.find(key);
+	bool done = iter != requests.end() && iter->second->done;
+
+	SDL_UnlockMutex(mutex);
+
+	return done;
+}
+
+ImageDecoder::Status ImageDecoder::take(const char *filename, SDL_Surface *&surface)
+{
+	std::string key = makeKey(filename);
+
+	SDL_LockMutex(mutex);
+
+	std::map<std::string, Request*>::iterator iter = requests.find(key);
+
+	if (iter == requests.end())
+	{
+		SDL_UnlockMutex(mutex);
+		return NotQueued;
+	}
+
+	Request *req = iter->second;
+	requests.erase(iter);
+
+	std::deque<Request*>::iterator queued =
+		std::find(queue.begin(), queue.end(), req);
+
+	if (queued != queue.end())
+	{
+		/* Nobody got to it yet; waiting would only
+		 * mean waiting for the requests before it */
+		queue.erase(queued);
+		SDL_UnlockMutex(mutex);
+
+		decode(*req);
+	}
+	else
+	{
+		while (!req->done)
+			SDL_CondWait(doneCond, mutex);
+
+		if (req->surface)
+			heldBytes -= byteCount(req->surface);
+
+		SDL_UnlockMutex(mutex);
+	}
+
+	Status status = req->status;
+	surface = req->surface;
+
+	delete req;
+
+	return status;
+}
+
+void ImageDecoder::clear()
+{
+	SDL_LockMutex(mutex);
+
+	std::map<std::string, Request*>::iterator iter;
+
+	for (iter = requests.begin(); iter != requests.end(); ++iter)
+	{
+		Request *req = iter->second;
+
+		/* Still being decoded; the worker frees it when done */
+		if (!req->done && std::find(queue.begin(), queue.end(), req) == queue.end())
+		{
+			req->dropped = true;
+			continue;
+		}
+
+		if (req->surface)
+			heldBytes -= byteCount(req->surface);
+
+		freeRequest(req);
+	}
+
+	requests.clear();
+	queue.clear();
+
+	SDL_UnlockMutex(mutex);
+}
+
+void ImageDecoder::freeRequest(Request *req)
+{
+	if (req->surface)
+		SDL_FreeSurface(req->surface);
+
+	delete req;
+}
+
+void ImageDecoder::decode(Request &req)
+{
+	DecodeOpenHandler handler;
+
+	try
+	{
+		shState->fileSystem().openRead(handler, req.filename.c_str());
+	}
+	catch (const Exception &e)
+	{
+		req.status = (e.type == Exception::NoFileError) ? NotFound : Failed;
+		return;
+	}
+
+	if (!handler.surface)
+	{
+		req.status = Failed;
+		return;
+	}
+
+	/* Already in the format Bitmap::initFromSurface wants */
+	req.surface = handler.surface;
+	req.status = Ready;
+}
+
+void ImageDecoder::workerMain()
+{
+	SDL_LockMutex(mutex);
+
+	while (true)
+	{
+		while (!quit && queue.empty())
+			SDL_CondWait(workCond, mutex);
+
+		if (quit)
+			break;
+
+		Request *req = queue.front();
+		queue.pop_front();
+
+		SDL_UnlockMutex(mutex);
+
+		decode(*req);
+
+		SDL_LockMutex(mutex);
+
+		if (req->dropped)
+		{
+			freeRequest(req);
+			continue;
+		}
+
+		if (req->surface)
+		{
+			if (heldBytes + byteCount(req->surface) > maxHeldBytes)
+			{
+				SDL_FreeSurface(req->surface);
+				req->surface = 0;
+				req->status = Failed;
+			}
+			else
+			{
+				heldBytes += byteCount(req->surface);
+			}
+		}
+
+		req->done = true;
+		SDL_CondBroadcast(doneCond);
+	}
+
+	SDL_UnlockMutex(mutex);
+}
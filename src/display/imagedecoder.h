@@ -0,0 +1,114 @@
+/*
+** imagedecoder.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+struct SDL_Surface;
+struct SDL_Thread;
+struct SDL_mutex;
+struct SDL_cond;
+
+/* Decodes image files on a small worker pool ahead of the
+ * Bitmap constructions that will need them, so that loading
+ * a map doesn't stall the game thread on PNG inflation.
+ *
+ * Only the CPU side is done here; surfaces are handed to
+ * the RGSS thread, which does the texture upload as usual.
+ * Animated images are left to the regular loading path */
+class ImageDecoder
+{
+public:
+	enum Status
+	{
+		/* Never queued, or already taken */
+		NotQueued,
+
+		/* 'surface' holds the decoded image in ABGR8888 */
+		Ready,
+
+		/* No file by that name exists */
+		NotFound,
+
+		/* Anything else (unknown format, GIF, too much memory
+		 * held); the regular loading path should be taken */
+		Failed
+	};
+
+	/* 0 picks a count based on the available CPU cores */
+	ImageDecoder(int threadCount);
+	~ImageDecoder();
+
+	/* Queues 'filename' to be decoded in the background.
+	 * Does nothing if it's already queued or decoded */
+	void prefetch(const char *filename);
+
+	/* Whether 'filename' was queued and has finished decoding */
+	bool isDone(const char *filename);
+
+	/* Hands out the outcome of a prefetch and forgets about it.
+	 * Waits for the decode if it is in progress, or runs it
+	 * on the calling thread if no worker has picked it up yet */
+	Status take(const char *filename, SDL_Surface *&surface);
+
+	/* Drops every queued and decoded image */
+	void clear();
+
+private:
+	struct Request
+	{
+		std::string filename;
+		Status status;
+		bool done;
+		SDL_Surface *surface;
+
+		/* Forgotten by clear() while being decoded */
+		bool dropped;
+	};
+
+	void workerMain();
+	void decode(Request &req);
+	static void freeRequest(Request *req);
+
+	std::string makeKey(const char *filename);
+
+	std::map<std::string, Request*> requests;
+	std::deque<Request*> queue;
+
+	/* Bytes held by decoded surfaces nobody has taken yet */
+	size_t heldBytes;
+
+	std::vector<SDL_Thread*> workers;
+
+	SDL_mutex *mutex;
+	SDL_cond *workCond;
+	SDL_cond *doneCond;
+
+	bool quit;
+};
+
+#endif // IMAGEDECODER_H
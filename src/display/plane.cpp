@@ -35,7 +35,9 @@
 #include "transform.h"
 #endif // MKXPZ_RETRO
 #include "etc-internal.h"
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+#include "softraster.h"
+#else
 #include "shader.h"
 #include "glstate.h"
 #endif // MKXPZ_RETRO
@@ -293,7 +295,18 @@ void Plane::draw()
 	if (!p->opacity)
 		return;
 
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+	SoftBlend blend;
+	blend.opacity = p->opacity;
+	blend.blendType = p->blendType;
+	blend.tone = p->tone->norm;
+	blend.color = p->color->norm;
+
+	const Vec2i orig(p->sceneGeo.orig.x + p->ox, p->sceneGeo.orig.y + p->oy);
+
+	shState->softRaster().drawTiled(p->bitmap->getSoftSurface(), p->sceneGeo.rect,
+	                                orig, Vec2(p->zoomX, p->zoomY), blend);
+#else
 	ShaderBase *base;
 
 	if (p->color->hasEffect() || p->tone->hasEffect() || p->opacity != 255)
@@ -0,0 +1,143 @@
+/*
+** preparequeue.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "preparequeue.h"
+
+#include "sdl-util.h"
+
+#include <SDL_cpuinfo.h>
+#include <SDL_mutex.h>
+
+#include <algorithm>
+
+/* Beyond this, the serial submit phase dominates anyway */
+static const int maxAutoThreads = 4;
+
+PrepareQueue::PrepareQueue(int threadCount)
+    : generation(0),
+      busyWorkers(0),
+      quit(false)
+{
+	if (threadCount <= 0)
+		threadCount = std::min(SDL_GetCPUCount(), maxAutoThreads);
+
+	mutex = SDL_CreateMutex();
+	workCond = SDL_CreateCond();
+	doneCond = SDL_CreateCond();
+
+	SDL_AtomicSet(&nextJob, 0);
+
+	for (int i = 1; i < threadCount; ++i)
+		workers.push_back(createSDLThread
+			<PrepareQueue, &PrepareQueue::workerMain>(this, "prepare"));
+}
+
+PrepareQueue::~PrepareQueue()
+{
+	SDL_LockMutex(mutex);
+	quit = true;
+	SDL_CondBroadcast(workCond);
+	SDL_UnlockMutex(mutex);
+
+	for (size_t i = 0; i < workers.size(); ++i)
+		SDL_WaitThread(workers[i], 0);
+
+	SDL_DestroyCond(doneCond);
+	SDL_DestroyCond(workCond);
+	SDL_DestroyMutex(mutex);
+}
+
+void PrepareQueue::push(Job *job)
+{
+	jobs.push_back(job);
+}
+
+void PrepareQueue::flush()
+{
+	if (jobs.empty())
+		return;
+
+	/* Waking the pool costs more than a single job */
+	if (workers.empty() || jobs.size() == 1)
+	{
+		for (size_t i = 0; i < jobs.size(); ++i)
+			jobs[i]->build();
+	}
+	else
+	{
+		SDL_AtomicSet(&nextJob, 0);
+
+		SDL_LockMutex(mutex);
+		++generation;
+		busyWorkers = workers.size();
+		SDL_CondBroadcast(workCond);
+		SDL_UnlockMutex(mutex);
+
+		runBuilds();
+
+		SDL_LockMutex(mutex);
+		while (busyWorkers > 0)
+			SDL_CondWait(doneCond, mutex);
+		SDL_UnlockMutex(mutex);
+	}
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+		jobs[i]->submit();
+
+	jobs.clear();
+}
+
+void PrepareQueue::runBuilds()
+{
+	const int count = jobs.size();
+	int i;
+
+	while ((i = SDL_AtomicAdd(&nextJob, 1)) < count)
+		jobs[i]->build();
+}
+
+void PrepareQueue::workerMain()
+{
+	unsigned int seen = 0;
+
+	SDL_LockMutex(mutex);
+
+	while (true)
+	{
+		while (!quit && generation == seen)
+			SDL_CondWait(workCond, mutex);
+
+		if (quit)
+			break;
+
+		seen = generation;
+		SDL_UnlockMutex(mutex);
+
+		runBuilds();
+
+		SDL_LockMutex(mutex);
+
+		if (--busyWorkers == 0)
+			SDL_CondSignal(doneCond);
+	}
+
+	SDL_UnlockMutex(mutex);
+}
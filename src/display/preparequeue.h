@@ -0,0 +1,86 @@
+/*
+** preparequeue.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PREPAREQUEUE_H
+#define PREPAREQUEUE_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <SDL_atomic.h>
+
+struct SDL_Thread;
+struct SDL_mutex;
+struct SDL_cond;
+
+/* Splits frame preparation into a CPU side "build" phase,
+ * run concurrently on a small worker pool, and a serial
+ * "submit" phase on the RGSS thread where GL may be used.
+ *
+ * Elements push jobs from their 'prepareDraw' handlers;
+ * once all handlers have run, 'flush()' executes every
+ * build step in parallel and then every submit step in
+ * the order the jobs were pushed */
+class PrepareQueue
+{
+public:
+	struct Job
+	{
+		virtual ~Job() {}
+
+		/* May run on any thread. Must not touch GL, shared
+		 * state or data owned by any other element */
+		virtual void build() = 0;
+
+		/* Runs on the RGSS thread after all builds are done */
+		virtual void submit() = 0;
+	};
+
+	/* 'threadCount' includes the RGSS thread, which works
+	 * through jobs alongside the pool. 0 picks a count
+	 * based on the available CPU cores */
+	PrepareQueue(int threadCount);
+	~PrepareQueue();
+
+	void push(Job *job);
+	void flush();
+
+private:
+	void workerMain();
+	void runBuilds();
+
+	std::vector<Job*> jobs;
+	std::vector<SDL_Thread*> workers;
+
+	SDL_mutex *mutex;
+	SDL_cond *workCond;
+	SDL_cond *doneCond;
+
+	/* Index of the next job to be picked up */
+	SDL_atomic_t nextJob;
+
+	/* Bumped for every flush, wakes up the workers */
+	unsigned int generation;
+	size_t busyWorkers;
+	bool quit;
+};
+
+#endif // PREPAREQUEUE_H
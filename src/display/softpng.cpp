@@ -0,0 +1,532 @@
+/*
+** softpng.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "softpng.h"
+
+#include "softraster.h"
+
+#include <zlib.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static const uint8_t pngSignature[8] =
+{
+	0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+};
+
+/* Larger images wouldn't fit into any Bitmap anyway */
+static const uint32_t maxDimension = 1 << 15;
+static const uint64_t maxPixels = 1 << 26;
+
+/* Adam7 pass origins and strides */
+static const int adam7X[]  = { 0, 4, 0, 2, 0, 1, 0 };
+static const int adam7Y[]  = { 0, 0, 4, 0, 2, 0, 1 };
+static const int adam7DX[] = { 8, 8, 4, 4, 2, 2, 1 };
+static const int adam7DY[] = { 8, 8, 8, 4, 4, 2, 2 };
+
+enum ColorType
+{
+	Gray      = 0,
+	RGB       = 2,
+	Palette   = 3,
+	GrayAlpha = 4,
+	RGBA      = 6
+};
+
+struct Header
+{
+	uint32_t width;
+	uint32_t height;
+	int depth;
+	int colorType;
+	int channels;
+	bool interlaced;
+
+	/* As 0xAARRGGBB */
+	uint32_t palette[256];
+	int paletteSize;
+
+	/* tRNS color key of gray / RGB images, in raw sample values */
+	bool hasKey;
+	uint16_t key[3];
+};
+
+static inline uint32_t readU32(const uint8_t *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+	       ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static inline uint16_t readU16(const uint8_t *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static int channelCount(int colorType)
+{
+	switch (colorType)
+	{
+	case Gray :
+	case Palette :
+		return 1;
+	case GrayAlpha :
+		return 2;
+	case RGB :
+		return 3;
+	case RGBA :
+		return 4;
+	default :
+		return 0;
+	}
+}
+
+static bool validDepth(int colorType, int depth)
+{
+	switch (colorType)
+	{
+	case Gray :
+		return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+	case Palette :
+		return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+	default :
+		return depth == 8 || depth == 16;
+	}
+}
+
+/* Bytes of one filtered scanline, excluding the filter type byte */
+static size_t rowBytes(const Header &hdr, uint32_t width)
+{
+	return ((uint64_t) width * hdr.channels * hdr.depth + 7) / 8;
+}
+
+static inline int paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a);
+	int pb = abs(p - b);
+	int pc = abs(p - c);
+
+	if (pa <= pb && pa <= pc)
+		return a;
+
+	return pb <= pc ? b : c;
+}
+
+/* Reverses the scanline filters of one (sub)image in place.
+ * 'data' holds 'rows' lines of a filter byte followed by 'stride'
+ * bytes; 'bpp' is the byte distance to the corresponding
+ * sample of the previous pixel */
+static bool unfilter(uint8_t *data, size_t stride, uint32_t rows, int bpp)
+{
+	const uint8_t *prev = 0;
+
+	for (uint32_t y = 0; y < rows; ++y)
+	{
+		const int filter = data[0];
+		uint8_t *cur = data + 1;
+
+		switch (filter)
+		{
+		case 0 :
+			break;
+		case 1 :
+			for (size_t i = bpp; i < stride; ++i)
+				cur[i] += cur[i - bpp];
+			break;
+		case 2 :
+			if (prev)
+				for (size_t i = 0; i < stride; ++i)
+					cur[i] += prev[i];
+			break;
+		case 3 :
+			for (size_t i = 0; i < stride; ++i)
+			{
+				int left = i >= (size_t) bpp ? cur[i - bpp] : 0;
+				int up = prev ? prev[i] : 0;
+				cur[i] += (left + up) / 2;
+			}
+			break;
+		case 4 :
+			for (size_t i = 0; i < stride; ++i)
+			{
+				int left = i >= (size_t) bpp ? cur[i - bpp] : 0;
+				int up = prev ? prev[i] : 0;
+				int upLeft = (prev && i >= (size_t) bpp) ? prev[i - bpp] : 0;
+				cur[i] += paeth(left, up, upLeft);
+			}
+			break;
+		default :
+			return false;
+		}
+
+		prev = cur;
+		data += stride + 1;
+	}
+
+	return true;
+}
+
+/* Raw value of sample 'index' in an unfiltered scanline */
+static inline uint32_t sampleAt(const uint8_t *row, size_t index, int depth)
+{
+	switch (depth)
+	{
+	case 16 :
+		return readU16(row + index * 2);
+	case 8 :
+		return row[index];
+	default :
+	{
+		const size_t bit = index * depth;
+		const int shift = 8 - depth - (int) (bit % 8);
+
+		return (row[bit / 8] >> shift) & ((1 << depth) - 1);
+	}
+	}
+}
+
+/* Scales a raw sample to 8 bits */
+static inline uint32_t to8(uint32_t value, int depth)
+{
+	switch (depth)
+	{
+	case 16 :
+		return value >> 8;
+	case 8 :
+		return value;
+	default :
+		return value * 255 / ((1 << depth) - 1);
+	}
+}
+
+static inline uint32_t pack(uint32_t a, uint32_t r, uint32_t g, uint32_t b)
+{
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+/* Converts 'count' pixels of an unfiltered scanline to surface
+ * pixels, writing every 'step'th pixel of 'dst' */
+static void convertRow(const Header &hdr, const uint8_t *row,
+                       uint32_t count, uint32_t *dst, int step)
+{
+	const int depth = hdr.depth;
+
+	for (uint32_t x = 0; x < count; ++x, dst += step)
+	{
+		const size_t s = (size_t) x * hdr.channels;
+
+		switch (hdr.colorType)
+		{
+		case Gray :
+		{
+			uint32_t v = sampleAt(row, s, depth);
+			uint32_t a = (hdr.hasKey && v == hdr.key[0]) ? 0 : 255;
+			uint32_t g = to8(v, depth);
+
+			*dst = pack(a, g, g, g);
+			break;
+		}
+		case RGB :
+		{
+			uint32_t r = sampleAt(row, s, depth);
+			uint32_t g = sampleAt(row, s + 1, depth);
+			uint32_t b = sampleAt(row, s + 2, depth);
+			uint32_t a = (hdr.hasKey && r == hdr.key[0] &&
+			              g == hdr.key[1] && b == hdr.key[2]) ? 0 : 255;
+
+			*dst = pack(a, to8(r, depth), to8(g, depth), to8(b, depth));
+			break;
+		}
+		case Palette :
+		{
+			uint32_t i = sampleAt(row, s, depth);
+
+			/* Out of range indices are an encoder bug;
+			 * show them as opaque black */
+			*dst = (int) i < hdr.paletteSize ? hdr.palette[i] : 0xFF000000;
+			break;
+		}
+		case GrayAlpha :
+		{
+			uint32_t g = to8(sampleAt(row, s, depth), depth);
+			uint32_t a = to8(sampleAt(row, s + 1, depth), depth);
+
+			*dst = pack(a, g, g, g);
+			break;
+		}
+		case RGBA :
+			*dst = pack(to8(sampleAt(row, s + 3, depth), depth),
+			            to8(sampleAt(row, s, depth), depth),
+			            to8(sampleAt(row, s + 1, depth), depth),
+			            to8(sampleAt(row, s + 2, depth), depth));
+			break;
+		}
+	}
+}
+
+/* Size of the inflated image data, with filter bytes */
+static uint64_t inflatedSize(const Header &hdr)
+{
+	if (!hdr.interlaced)
+		return (uint64_t) hdr.height * (rowBytes(hdr, hdr.width) + 1);
+
+	uint64_t size = 0;
+
+	for (int pass = 0; pass < 7; ++pass)
+	{
+		uint32_t w = (hdr.width + adam7DX[pass] - 1 - adam7X[pass]) / adam7DX[pass];
+		uint32_t h = (hdr.height + adam7DY[pass] - 1 - adam7Y[pass]) / adam7DY[pass];
+
+		if (w == 0 || h == 0)
+			continue;
+
+		size += (uint64_t) h * (rowBytes(hdr, w) + 1);
+	}
+
+	return size;
+}
+
+static bool parseHeader(const uint8_t *data, uint32_t len, Header &hdr,
+                        const char *&error)
+{
+	if (len != 13)
+	{
+		error = "Malformed IHDR chunk";
+		return false;
+	}
+
+	hdr.width = readU32(data);
+	hdr.height = readU32(data + 4);
+	hdr.depth = data[8];
+	hdr.colorType = data[9];
+	hdr.channels = channelCount(hdr.colorType);
+	hdr.interlaced = data[12] == 1;
+
+	if (hdr.width == 0 || hdr.height == 0 ||
+	    hdr.width > maxDimension || hdr.height > maxDimension ||
+	    (uint64_t) hdr.width * hdr.height > maxPixels)
+	{
+		error = "Unsupported image size";
+		return false;
+	}
+
+	if (hdr.channels == 0 || !validDepth(hdr.colorType, hdr.depth))
+	{
+		error = "Invalid color type or bit depth";
+		return false;
+	}
+
+	/* Compression and filter method 0 are the only ones defined */
+	if (data[10] != 0 || data[11] != 0 || data[12] > 1)
+	{
+		error = "Unsupported compression, filter or interlace method";
+		return false;
+	}
+
+	return true;
+}
+
+namespace SoftPNG
+{
+
+bool isPNG(const uint8_t *data, size_t size)
+{
+	return size >= sizeof(pngSignature) &&
+	       memcmp(data, pngSignature, sizeof(pngSignature)) == 0;
+}
+
+bool decode(const uint8_t *data, size_t size,
+            SoftSurface &out, const char *&error)
+{
+	if (!isPNG(data, size))
+	{
+		error = "Not a PNG file";
+		return false;
+	}
+
+	Header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+
+	bool haveHeader = false;
+	bool haveEnd = false;
+	std::vector<uint8_t> idat;
+
+	size_t pos = sizeof(pngSignature);
+
+	/* Chunk length, type and CRC take 12 bytes */
+	while (!haveEnd && pos + 12 <= size)
+	{
+		const uint32_t len = readU32(data + pos);
+		const uint8_t *type = data + pos + 4;
+		const uint8_t *body = data + pos + 8;
+
+		if (len > size - pos - 12)
+		{
+			error = "Truncated chunk";
+			return false;
+		}
+
+		pos += (size_t) len + 12;
+
+		if (!haveHeader)
+		{
+			if (memcmp(type, "IHDR", 4) != 0)
+			{
+				error = "Missing IHDR chunk";
+				return false;
+			}
+
+			if (!parseHeader(body, len, hdr, error))
+				return false;
+
+			haveHeader = true;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			if (len % 3 != 0 || len / 3 > 256)
+			{
+				error = "Malformed PLTE chunk";
+				return false;
+			}
+
+			hdr.paletteSize = len / 3;
+
+			for (int i = 0; i < hdr.paletteSize; ++i)
+				hdr.palette[i] = pack(0xFF, body[i*3], body[i*3+1], body[i*3+2]);
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (hdr.colorType == Palette)
+			{
+				for (uint32_t i = 0; i < len && i < 256; ++i)
+					hdr.palette[i] = (hdr.palette[i] & 0x00FFFFFF) | ((uint32_t) body[i] << 24);
+			}
+			else if (hdr.colorType == Gray && len >= 2)
+			{
+				hdr.hasKey = true;
+				hdr.key[0] = readU16(body);
+			}
+			else if (hdr.colorType == RGB && len >= 6)
+			{
+				hdr.hasKey = true;
+				hdr.key[0] = readU16(body);
+				hdr.key[1] = readU16(body + 2);
+				hdr.key[2] = readU16(body + 4);
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			idat.insert(idat.end(), body, body + len);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			haveEnd = true;
+		}
+	}
+
+	if (!haveHeader || idat.empty())
+	{
+		error = "Missing image data";
+		return false;
+	}
+
+	if (hdr.colorType == Palette && hdr.paletteSize == 0)
+	{
+		error = "Missing PLTE chunk";
+		return false;
+	}
+
+	/* At most 2^26 pixels of 8 bytes, plus filter bytes */
+	const uint64_t expected = inflatedSize(hdr);
+	std::vector<uint8_t> raw(expected);
+	uLongf rawLen = (uLongf) expected;
+
+	int status = uncompress(&raw[0], &rawLen, &idat[0], (uLong) idat.size());
+
+	/* Trailing data past the image is harmless */
+	if ((status != Z_OK && status != Z_BUF_ERROR) || rawLen != expected)
+	{
+		error = "Corrupt image data";
+		return false;
+	}
+
+	idat.clear();
+
+	const int bpp = std::max(1, hdr.channels * hdr.depth / 8);
+
+	out.alloc(hdr.width, hdr.height);
+
+	if (!out.pixels)
+	{
+		error = "Out of memory";
+		return false;
+	}
+
+	if (!hdr.interlaced)
+	{
+		const size_t stride = rowBytes(hdr, hdr.width);
+
+		if (!unfilter(&raw[0], stride, hdr.height, bpp))
+		{
+			error = "Invalid scanline filter";
+			return false;
+		}
+
+		for (uint32_t y = 0; y < hdr.height; ++y)
+			convertRow(hdr, &raw[y * (stride + 1) + 1], hdr.width, out.row(y), 1);
+
+		return true;
+	}
+
+	uint8_t *passData = &raw[0];
+
+	for (int pass = 0; pass < 7; ++pass)
+	{
+		uint32_t w = (hdr.width + adam7DX[pass] - 1 - adam7X[pass]) / adam7DX[pass];
+		uint32_t h = (hdr.height + adam7DY[pass] - 1 - adam7Y[pass]) / adam7DY[pass];
+
+		if (w == 0 || h == 0)
+			continue;
+
+		const size_t stride = rowBytes(hdr, w);
+
+		if (!unfilter(passData, stride, h, bpp))
+		{
+			error = "Invalid scanline filter";
+			return false;
+		}
+
+		for (uint32_t y = 0; y < h; ++y)
+		{
+			uint32_t *dst = out.row(adam7Y[pass] + y * adam7DY[pass]) + adam7X[pass];
+			convertRow(hdr, passData + y * (stride + 1) + 1, w, dst, adam7DX[pass]);
+		}
+
+		passData += h * (stride + 1);
+	}
+
+	return true;
+}
+
+}
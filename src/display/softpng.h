@@ -0,0 +1,47 @@
+/*
+** softpng.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOFTPNG_H
+#define SOFTPNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct SoftSurface;
+
+/* PNG decoder for the libretro core, which has zlib but
+ * no SDL_image. Handles every color type, bit depth and
+ * interlacing, as well as tRNS transparency */
+namespace SoftPNG
+{
+
+/* Whether 'data' starts with the PNG signature */
+bool isPNG(const uint8_t *data, size_t size);
+
+/* Decodes into 'out' (reallocated to the image size).
+ * On failure, returns false and points 'error' at
+ * a static description of the problem */
+bool decode(const uint8_t *data, size_t size,
+            SoftSurface &out, const char *&error);
+
+}
+
+#endif // SOFTPNG_H
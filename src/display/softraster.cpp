@@ -0,0 +1,710 @@
+/*
+** softraster.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "softraster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define SOFTRASTER_SSE2
+#endif
+
+#define A_OF(p) ((p) >> 24)
+#define R_OF(p) (((p) >> 16) & 0xFF)
+#define G_OF(p) (((p) >> 8) & 0xFF)
+#define B_OF(p) ((p) & 0xFF)
+
+static inline uint32_t packPixel(uint32_t a, uint32_t r, uint32_t g, uint32_t b)
+{
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+/* Exact for all products of two 8 bit values */
+static inline uint32_t div255(uint32_t v)
+{
+	v += 128;
+	return (v + (v >> 8)) >> 8;
+}
+
+static inline int wrap(int value, int range)
+{
+	value %= range;
+	return value < 0 ? value + range : value;
+}
+
+static IntRect intersect(const IntRect &a, const IntRect &b)
+{
+	int x1 = std::max(a.x, b.x);
+	int y1 = std::max(a.y, b.y);
+	int x2 = std::min(a.x + a.w, b.x + b.w);
+	int y2 = std::min(a.y + a.h, b.y + b.h);
+
+	if (x2 <= x1 || y2 <= y1)
+		return IntRect();
+
+	return IntRect(x1, y1, x2 - x1, y2 - y1);
+}
+
+/* Row blenders. 'dst' is the opaque frame; only its
+ * color channels carry meaning. These implement the same
+ * equations glState.blendMode sets up for the GL backend */
+
+static void blendRowNormalC(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		uint32_t s = src[i];
+		uint32_t a = div255(A_OF(s) * opacity);
+
+		if (a == 0)
+			continue;
+
+		if (a == 255)
+		{
+			dst[i] = s;
+			continue;
+		}
+
+		uint32_t d = dst[i];
+		uint32_t ia = 255 - a;
+
+		dst[i] = packPixel(0xFF,
+		                   div255(R_OF(s) * a + R_OF(d) * ia),
+		                   div255(G_OF(s) * a + G_OF(d) * ia),
+		                   div255(B_OF(s) * a + B_OF(d) * ia));
+	}
+}
+
+static void blendRowAddC(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		uint32_t s = src[i];
+		uint32_t a = div255(A_OF(s) * opacity);
+
+		if (a == 0)
+			continue;
+
+		uint32_t d = dst[i];
+
+		dst[i] = packPixel(0xFF,
+		                   std::min<uint32_t>(255, R_OF(d) + div255(R_OF(s) * a)),
+		                   std::min<uint32_t>(255, G_OF(d) + div255(G_OF(s) * a)),
+		                   std::min<uint32_t>(255, B_OF(d) + div255(B_OF(s) * a)));
+	}
+}
+
+static void blendRowSubC(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		uint32_t s = src[i];
+		uint32_t a = div255(A_OF(s) * opacity);
+
+		if (a == 0)
+			continue;
+
+		uint32_t d = dst[i];
+		int r = (int) R_OF(d) - (int) div255(R_OF(s) * a);
+		int g = (int) G_OF(d) - (int) div255(G_OF(s) * a);
+		int b = (int) B_OF(d) - (int) div255(B_OF(s) * a);
+
+		dst[i] = packPixel(0xFF, std::max(r, 0), std::max(g, 0), std::max(b, 0));
+	}
+}
+
+#ifdef SOFTRASTER_SSE2
+/* Four pixels at a time; each 8 bit channel is widened to 16 bits
+ * so that 'channel * alpha' can't overflow */
+
+static inline __m128i div255x8(__m128i v)
+{
+	v = _mm_add_epi16(v, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+}
+
+/* Broadcasts each pixel's (scaled) alpha to all of its four lanes */
+static inline __m128i alphaX8(__m128i px, __m128i opacity)
+{
+	__m128i a = _mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+
+	return div255x8(_mm_mullo_epi16(a, opacity));
+}
+
+static inline bool allTransparent(__m128i s)
+{
+	const __m128i amask = _mm_set1_epi32(0xFF000000);
+	__m128i a = _mm_and_si128(s, amask);
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi32(a, _mm_setzero_si128())) == 0xFFFF;
+}
+
+static void blendRowNormal(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(255);
+	const __m128i op = _mm_set1_epi16(opacity);
+	const __m128i amask = _mm_set1_epi32(0xFF000000);
+	int i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+
+		if (allTransparent(s))
+			continue;
+
+		if (opacity == 255 &&
+		    _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, amask), amask)) == 0xFFFF)
+		{
+			_mm_storeu_si128((__m128i*) (dst + i), s);
+			continue;
+		}
+
+		__m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+
+		__m128i sLo = _mm_unpacklo_epi8(s, zero);
+		__m128i sHi = _mm_unpackhi_epi8(s, zero);
+		__m128i dLo = _mm_unpacklo_epi8(d, zero);
+		__m128i dHi = _mm_unpackhi_epi8(d, zero);
+
+		__m128i aLo = alphaX8(sLo, op);
+		__m128i aHi = alphaX8(sHi, op);
+
+		/* s*a + d*(255-a) <= 255*255, fits into 16 bits unsigned */
+		__m128i rLo = _mm_add_epi16(_mm_mullo_epi16(sLo, aLo),
+		                            _mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo)));
+		__m128i rHi = _mm_add_epi16(_mm_mullo_epi16(sHi, aHi),
+		                            _mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi)));
+
+		__m128i res = _mm_packus_epi16(div255x8(rLo), div255x8(rHi));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(res, amask));
+	}
+
+	blendRowNormalC(dst + i, src + i, n - i, opacity);
+}
+
+/* Returns the source color channels premultiplied by their
+ * (opacity scaled) alpha, packed back to 8 bits */
+static inline __m128i premulX4(__m128i s, __m128i op)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sLo = _mm_unpacklo_epi8(s, zero);
+	__m128i sHi = _mm_unpackhi_epi8(s, zero);
+
+	sLo = div255x8(_mm_mullo_epi16(sLo, alphaX8(sLo, op)));
+	sHi = div255x8(_mm_mullo_epi16(sHi, alphaX8(sHi, op)));
+
+	/* Don't touch the destination's alpha lane */
+	return _mm_andnot_si128(_mm_set1_epi32(0xFF000000), _mm_packus_epi16(sLo, sHi));
+}
+
+static void blendRowAdd(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+	const __m128i op = _mm_set1_epi16(opacity);
+	int i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+
+		if (allTransparent(s))
+			continue;
+
+		__m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_adds_epu8(d, premulX4(s, op)));
+	}
+
+	blendRowAddC(dst + i, src + i, n - i, opacity);
+}
+
+static void blendRowSub(uint32_t *dst, const uint32_t *src, int n, int opacity)
+{
+	const __m128i op = _mm_set1_epi16(opacity);
+	int i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*) (src + i));
+
+		if (allTransparent(s))
+			continue;
+
+		__m128i d = _mm_loadu_si128((const __m128i*) (dst + i));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_subs_epu8(d, premulX4(s, op)));
+	}
+
+	blendRowSubC(dst + i, src + i, n - i, opacity);
+}
+#else
+#  define blendRowNormal blendRowNormalC
+#  define blendRowAdd blendRowAddC
+#  define blendRowSub blendRowSubC
+#endif // SOFTRASTER_SSE2
+
+/* Applies gray, tone, color and inversion in place,
+ * in the same order as sprite.frag */
+static void applyEffects(uint32_t *row, int n, const SoftBlend &blend)
+{
+	const int gray = clamp<int>(blend.tone.w * 255.0f, 0, 255);
+	const int toneR = clamp<int>(blend.tone.x * 255.0f, -255, 255);
+	const int toneG = clamp<int>(blend.tone.y * 255.0f, -255, 255);
+	const int toneB = clamp<int>(blend.tone.z * 255.0f, -255, 255);
+	const uint32_t colA = clamp<int>(blend.color.w * 255.0f, 0, 255);
+	const uint32_t colR = div255(clamp<int>(blend.color.x * 255.0f, 0, 255) * colA);
+	const uint32_t colG = div255(clamp<int>(blend.color.y * 255.0f, 0, 255) * colA);
+	const uint32_t colB = div255(clamp<int>(blend.color.z * 255.0f, 0, 255) * colA);
+	const uint32_t colIA = 255 - colA;
+
+	for (int i = 0; i < n; ++i)
+	{
+		uint32_t p = row[i];
+
+		if (A_OF(p) == 0)
+			continue;
+
+		int r = R_OF(p), g = G_OF(p), b = B_OF(p);
+
+		if (gray)
+		{
+			/* Luma weights of lumaF, scaled by 256 */
+			int luma = (r * 77 + g * 150 + b * 29) >> 8;
+			r += ((luma - r) * gray) / 255;
+			g += ((luma - g) * gray) / 255;
+			b += ((luma - b) * gray) / 255;
+		}
+
+		r = clamp(r + toneR, 0, 255);
+		g = clamp(g + toneG, 0, 255);
+		b = clamp(b + toneB, 0, 255);
+
+		if (colA)
+		{
+			r = div255(r * colIA) + colR;
+			g = div255(g * colIA) + colG;
+			b = div255(b * colIA) + colB;
+		}
+
+		if (blend.invert)
+		{
+			r = 255 - r;
+			g = 255 - g;
+			b = 255 - b;
+		}
+
+		row[i] = packPixel(A_OF(p), r, g, b);
+	}
+}
+
+
+SoftSurface::SoftSurface()
+    : pixels(0),
+      width(0),
+      height(0),
+      pitch(0),
+      owned(false)
+{}
+
+SoftSurface::~SoftSurface()
+{
+	release();
+}
+
+void SoftSurface::alloc(int width, int height)
+{
+	release();
+
+	pixels = (uint32_t*) std::calloc((size_t) width * height, sizeof(uint32_t));
+	this->width = width;
+	this->height = height;
+	pitch = width;
+	owned = true;
+}
+
+void SoftSurface::wrap(uint32_t *pixels, int width, int height, int pitch)
+{
+	release();
+
+	this->pixels = pixels;
+	this->width = width;
+	this->height = height;
+	this->pitch = pitch;
+}
+
+void SoftSurface::release()
+{
+	if (owned)
+		std::free(pixels);
+
+	pixels = 0;
+	width = height = pitch = 0;
+	owned = false;
+}
+
+
+void SoftRaster::bind(uint32_t *pixels, int width, int height, int pitch)
+{
+	frame.wrap(pixels, width, height, pitch);
+
+	clips.clear();
+	clips.push_back(frame.rect());
+
+	if (rowBuf.size() < (size_t) width)
+		rowBuf.resize(width);
+}
+
+void SoftRaster::pushClip(const IntRect &rect)
+{
+	clips.push_back(intersect(clip(), rect));
+}
+
+void SoftRaster::popClip()
+{
+	/* The frame rect at the bottom is never popped */
+	if (clips.size() > 1)
+		clips.pop_back();
+}
+
+void SoftRaster::clear(uint32_t color)
+{
+	fill(frame, clip(), color);
+}
+
+void SoftRaster::drawRow(uint32_t *dst, const uint32_t *src, int count,
+                         const SoftBlend &blend)
+{
+	switch (blend.blendType)
+	{
+	case BlendAddition :
+		blendRowAdd(dst, src, count, blend.opacity);
+		break;
+	case BlendSubstraction :
+		blendRowSub(dst, src, count, blend.opacity);
+		break;
+	default :
+		blendRowNormal(dst, src, count, blend.opacity);
+	}
+}
+
+void SoftRaster::draw(const SoftSurface &src, const IntRect &srcRect,
+                      const IntRect &destRect, const SoftBlend &blend)
+{
+	if (blend.opacity <= 0 || !src.pixels)
+		return;
+
+	if (srcRect.w <= 0 || srcRect.h <= 0 || destRect.w <= 0 || destRect.h <= 0)
+		return;
+
+	const IntRect vis = intersect(destRect, clip());
+
+	if (vis.w == 0)
+		return;
+
+	const bool scaled = srcRect.w != destRect.w || srcRect.h != destRect.h;
+	const bool effect = blend.hasEffect();
+
+	/* Unscaled, unmirrored sprites without effects
+	 * blend straight out of the source rows */
+	const bool direct = !scaled && !blend.mirror && !effect;
+
+	if (!direct)
+	{
+		colMap.resize(vis.w);
+
+		for (int i = 0; i < vis.w; ++i)
+		{
+			int off = ((vis.x + i - destRect.x) * srcRect.w) / destRect.w;
+
+			if (blend.mirror)
+				off = srcRect.w - 1 - off;
+
+			colMap[i] = clamp(srcRect.x + off, 0, src.width - 1);
+		}
+	}
+
+	for (int y = vis.y; y < vis.y + vis.h; ++y)
+	{
+		int sy = srcRect.y + ((y - destRect.y) * srcRect.h) / destRect.h;
+
+		if (sy < 0 || sy >= src.height)
+			continue;
+
+		const uint32_t *srcRow = src.row(sy);
+		uint32_t *dstRow = frame.row(y) + vis.x;
+
+		if (direct)
+		{
+			int sx = srcRect.x + (vis.x - destRect.x);
+			int start = std::max(0, -sx);
+			int end = std::min(vis.w, src.width - sx);
+
+			if (end > start)
+				drawRow(dstRow + start, srcRow + sx + start, end - start, blend);
+
+			continue;
+		}
+
+		for (int i = 0; i < vis.w; ++i)
+			rowBuf[i] = srcRow[colMap[i]];
+
+		if (effect)
+			applyEffects(&rowBuf[0], vis.w, blend);
+
+		drawRow(dstRow, &rowBuf[0], vis.w, blend);
+	}
+}
+
+void SoftRaster::drawTiled(const SoftSurface &src, const IntRect &destRect,
+                           const Vec2i &orig, const Vec2 &zoom,
+                           const SoftBlend &blend)
+{
+	if (blend.opacity <= 0 || !src.pixels)
+		return;
+
+	if (zoom.x <= 0 || zoom.y <= 0)
+		return;
+
+	const IntRect vis = intersect(destRect, clip());
+
+	if (vis.w == 0)
+		return;
+
+	const bool effect = blend.hasEffect();
+
+	colMap.resize(vis.w);
+
+	for (int i = 0; i < vis.w; ++i)
+	{
+		int sx = (int) std::floor((vis.x + i - destRect.x + orig.x) / zoom.x);
+		colMap[i] = wrap(sx, src.width);
+	}
+
+	for (int y = vis.y; y < vis.y + vis.h; ++y)
+	{
+		int sy = (int) std::floor((y - destRect.y + orig.y) / zoom.y);
+		const uint32_t *srcRow = src.row(wrap(sy, src.height));
+
+		for (int i = 0; i < vis.w; ++i)
+			rowBuf[i] = srcRow[colMap[i]];
+
+		if (effect)
+			applyEffects(&rowBuf[0], vis.w, blend);
+
+		drawRow(frame.row(y) + vis.x, &rowBuf[0], vis.w, blend);
+	}
+}
+
+void SoftRaster::fillBlend(const IntRect &rect, const Vec4 &color)
+{
+	const IntRect vis = intersect(rect, clip());
+
+	if (vis.w == 0 || color.w <= 0)
+		return;
+
+	std::fill(rowBuf.begin(), rowBuf.begin() + vis.w, softPackColor(color));
+
+	for (int y = vis.y; y < vis.y + vis.h; ++y)
+		blendRowNormal(frame.row(y) + vis.x, &rowBuf[0], vis.w, 255);
+}
+
+void SoftRaster::applyEffect(const IntRect &rect, const SoftBlend &blend)
+{
+	const IntRect vis = intersect(rect, clip());
+
+	if (vis.w == 0 || !blend.hasEffect())
+		return;
+
+	for (int y = vis.y; y < vis.y + vis.h; ++y)
+	{
+		uint32_t *row = frame.row(y) + vis.x;
+
+		/* The frame's alpha lane is meaningless,
+		 * make sure every pixel gets processed */
+		for (int i = 0; i < vis.w; ++i)
+			row[i] |= 0xFF000000;
+
+		applyEffects(row, vis.w, blend);
+	}
+}
+
+void SoftRaster::fill(SoftSurface &dst, const IntRect &rect, uint32_t pixel)
+{
+	const IntRect vis = intersect(rect, dst.rect());
+
+	for (int y = vis.y; y < vis.y + vis.h; ++y)
+		std::fill(dst.row(y) + vis.x, dst.row(y) + vis.x + vis.w, pixel);
+}
+
+/* Same equation as bitmapBlit.frag */
+static inline uint32_t bltPixel(uint32_t s, uint32_t d, int opacity)
+{
+	uint32_t co1 = div255(A_OF(s) * opacity);
+
+	if (co1 == 255)
+		return s;
+
+	uint32_t co2 = div255(A_OF(d) * (255 - co1));
+	uint32_t a = co1 + co2;
+
+	if (a == 0)
+		return s & 0x00FFFFFF;
+
+	return packPixel(a,
+	                 (R_OF(s) * co1 + R_OF(d) * co2) / a,
+	                 (G_OF(s) * co1 + G_OF(d) * co2) / a,
+	                 (B_OF(s) * co1 + B_OF(d) * co2) / a);
+}
+
+void SoftRaster::blt(SoftSurface &dst, const IntRect &destRect,
+                     const SoftSurface &src, const IntRect &srcRect,
+                     int opacity)
+{
+	if (destRect.w == 0 || destRect.h == 0 || srcRect.w == 0 || srcRect.h == 0)
+		return;
+
+	/* Negative extents flip the blit, as with GLMeta::blitRectangle */
+	const IntRect dNorm(destRect.w < 0 ? destRect.x + destRect.w : destRect.x,
+	                    destRect.h < 0 ? destRect.y + destRect.h : destRect.y,
+	                    std::abs(destRect.w), std::abs(destRect.h));
+	const bool flipX = (destRect.w < 0) != (srcRect.w < 0);
+	const bool flipY = (destRect.h < 0) != (srcRect.h < 0);
+	const int sx0 = srcRect.w < 0 ? srcRect.x + srcRect.w : srcRect.x;
+	const int sy0 = srcRect.h < 0 ? srcRect.y + srcRect.h : srcRect.y;
+	const int sw = std::abs(srcRect.w);
+	const int sh = std::abs(srcRect.h);
+
+	const IntRect vis = intersect(dNorm, dst.rect());
+
+	for (int y = vis.y; y < vis.y + vis.h; ++y)
+	{
+		int oy = ((y - dNorm.y) * sh) / dNorm.h;
+		int sy = sy0 + (flipY ? sh - 1 - oy : oy);
+
+		if (sy < 0 || sy >= src.height)
+			continue;
+
+		const uint32_t *srcRow = src.row(sy);
+		uint32_t *dstRow = dst.row(y);
+
+		for (int x = vis.x; x < vis.x + vis.w; ++x)
+		{
+			int ox = ((x - dNorm.x) * sw) / dNorm.w;
+			int sx = sx0 + (flipX ? sw - 1 - ox : ox);
+
+			if (sx < 0 || sx >= src.width)
+				continue;
+
+			uint32_t s = srcRow[sx];
+
+			if (A_OF(s) == 0)
+				continue;
+
+			dstRow[x] = bltPixel(s, dstRow[x], opacity);
+		}
+	}
+}
+
+/* Pattern texel covering source texel 'pos', see sprite.vert */
+static int patternCoord(int pos, int srcSize, int patSize,
+                        const SoftPattern &params, float zoom, float scroll)
+{
+	const float center = pos + 0.5f;
+	float coord;
+
+	if (params.tile)
+		coord = center / zoom - scroll * srcSize / patSize;
+	else
+		coord = (center / (srcSize * zoom) - scroll / patSize) * patSize;
+
+	return wrap((int) std::floor(coord), patSize);
+}
+
+void SoftRaster::patterned(SoftSurface &dst, const SoftSurface &src,
+                           const IntRect &srcRect, const SoftSurface &pattern,
+                           const SoftPattern &params)
+{
+	const IntRect vis = intersect(srcRect, src.rect());
+
+	if (vis.w == 0 || !pattern.pixels)
+	{
+		dst.release();
+		return;
+	}
+
+	if (dst.width != vis.w || dst.height != vis.h)
+		dst.alloc(vis.w, vis.h);
+
+	std::vector<int> patCols(vis.w);
+
+	for (int i = 0; i < vis.w; ++i)
+		patCols[i] = patternCoord(vis.x + i, src.width, pattern.width,
+		                          params, params.zoom.x, params.scroll.x);
+
+	for (int y = 0; y < vis.h; ++y)
+	{
+		const uint32_t *srcRow = src.row(vis.y + y) + vis.x;
+		const uint32_t *patRow = pattern.row(patternCoord(vis.y + y, src.height, pattern.height,
+		                                                  params, params.zoom.y, params.scroll.y));
+		uint32_t *dstRow = dst.row(y);
+
+		for (int x = 0; x < vis.w; ++x)
+		{
+			const uint32_t s = srcRow[x];
+			const uint32_t pt = patRow[patCols[x]];
+			const uint32_t a = div255(A_OF(pt) * params.opacity);
+
+			if (a == 0 || A_OF(s) == 0)
+			{
+				dstRow[x] = s;
+				continue;
+			}
+
+			uint32_t ch[3] = { R_OF(s), G_OF(s), B_OF(s) };
+			const uint32_t pc[3] = { R_OF(pt), G_OF(pt), B_OF(pt) };
+
+			for (int c = 0; c < 3; ++c)
+			{
+				uint32_t blended;
+
+				switch (params.blendType)
+				{
+				case BlendAddition :
+					blended = std::min<uint32_t>(ch[c] + pc[c], 255);
+					break;
+				case BlendSubstraction :
+					blended = ch[c] > pc[c] ? ch[c] - pc[c] : 0;
+					break;
+				default :
+					blended = pc[c];
+				}
+
+				ch[c] = div255(blended * a + ch[c] * (255 - a));
+			}
+
+			dstRow[x] = packPixel(A_OF(s), ch[0], ch[1], ch[2]);
+		}
+	}
+}
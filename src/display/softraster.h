@@ -0,0 +1,193 @@
+/*
+** softraster.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOFTRASTER_H
+#define SOFTRASTER_H
+
+#include "etc.h"
+#include "etc-internal.h"
+
+#include <stdint.h>
+#include <vector>
+
+/* Size of the frame the libretro core hands to the frontend,
+ * which is also the size of the screen scene */
+static const int softFrameWidth = 640;
+static const int softFrameHeight = 480;
+
+/* CPU rasterizer used by the libretro core in place of the
+ * GL backend. All surfaces hold 32-bit pixels in native
+ * byte order as 0xAARRGGBB, which is also the XRGB8888
+ * layout libretro frontends expect for the frame buffer */
+
+struct SoftSurface
+{
+	uint32_t *pixels;
+	int width;
+	int height;
+	/* In pixels, not bytes */
+	int pitch;
+
+	SoftSurface();
+	~SoftSurface();
+
+	/* Allocates a cleared (fully transparent) surface */
+	void alloc(int width, int height);
+
+	/* Points the surface at memory it doesn't own */
+	void wrap(uint32_t *pixels, int width, int height, int pitch);
+
+	void release();
+
+	uint32_t *row(int y) const
+	{
+		return pixels + (size_t) y * pitch;
+	}
+
+	IntRect rect() const
+	{
+		return IntRect(0, 0, width, height);
+	}
+
+private:
+	bool owned;
+
+	SoftSurface(const SoftSurface &);
+	SoftSurface &operator=(const SoftSurface &);
+};
+
+/* Per-draw parameters mirroring the uniforms of
+ * the GL sprite/plane shaders */
+struct SoftBlend
+{
+	int opacity;
+	BlendType blendType;
+	bool mirror;
+	bool invert;
+
+	/* Normalized, as in Color::norm and Tone::norm */
+	Vec4 color;
+	Vec4 tone;
+
+	SoftBlend()
+	    : opacity(255),
+	      blendType(BlendNormal),
+	      mirror(false),
+	      invert(false)
+	{}
+
+	bool hasEffect() const
+	{
+		return color.w != 0 || tone.xyzNotNull() || tone.w != 0 || invert;
+	}
+};
+
+/* Sprite pattern parameters, mirroring the
+ * pattern uniforms of the GL sprite shader */
+struct SoftPattern
+{
+	BlendType blendType;
+	int opacity;
+	bool tile;
+	Vec2 scroll;
+	Vec2 zoom;
+
+	SoftPattern()
+	    : blendType(BlendNormal),
+	      opacity(255),
+	      tile(true),
+	      zoom(1, 1)
+	{}
+};
+
+static inline uint32_t softPackColor(const Vec4 &norm)
+{
+	uint32_t r = clamp<int>(norm.x * 255.0f + 0.5f, 0, 255);
+	uint32_t g = clamp<int>(norm.y * 255.0f + 0.5f, 0, 255);
+	uint32_t b = clamp<int>(norm.z * 255.0f + 0.5f, 0, 255);
+	uint32_t a = clamp<int>(norm.w * 255.0f + 0.5f, 0, 255);
+
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+class SoftRaster
+{
+public:
+	/* Points the rasterizer at the frame buffer for
+	 * the upcoming frame and resets the clip stack */
+	void bind(uint32_t *pixels, int width, int height, int pitch);
+
+	SoftSurface &target() { return frame; }
+
+	/* Scissoring; pushed rects are intersected with the
+	 * current clip, same as glState.scissorBox.setIntersect() */
+	void pushClip(const IntRect &rect);
+	void popClip();
+	const IntRect &clip() const { return clips.back(); }
+
+	void clear(uint32_t color = 0);
+
+	/* Draws 'srcRect' of 'src' into 'destRect' on the frame,
+	 * scaling with nearest-neighbor sampling if the sizes differ */
+	void draw(const SoftSurface &src, const IntRect &srcRect,
+	          const IntRect &destRect, const SoftBlend &blend);
+
+	/* Repeats 'src' (scaled by 'zoom') across 'destRect', with
+	 * 'orig' being the source offset at the top left corner */
+	void drawTiled(const SoftSurface &src, const IntRect &destRect,
+	               const Vec2i &orig, const Vec2 &zoom,
+	               const SoftBlend &blend);
+
+	/* Blends a solid color over 'rect', as used for
+	 * viewport flash effects */
+	void fillBlend(const IntRect &rect, const Vec4 &color);
+
+	/* Applies gray, tone and color to everything already
+	 * drawn inside 'rect', as used for viewport effects */
+	void applyEffect(const IntRect &rect, const SoftBlend &blend);
+
+	/* Bitmap helpers, operating on straight alpha surfaces */
+	static void fill(SoftSurface &dst, const IntRect &rect, uint32_t pixel);
+	static void blt(SoftSurface &dst, const IntRect &destRect,
+	                const SoftSurface &src, const IntRect &srcRect,
+	                int opacity);
+
+	/* Copies 'srcRect' of 'src' into 'dst' (reallocated to fit)
+	 * with 'pattern' blended over the color channels. Pattern
+	 * coordinates are relative to all of 'src', as in sprite.frag */
+	static void patterned(SoftSurface &dst, const SoftSurface &src,
+	                      const IntRect &srcRect, const SoftSurface &pattern,
+	                      const SoftPattern &params);
+
+private:
+	void drawRow(uint32_t *dst, const uint32_t *src, int count,
+	             const SoftBlend &blend);
+
+	SoftSurface frame;
+	std::vector<IntRect> clips;
+
+	/* Scratch row for scaled / effect-applied source pixels,
+	 * and the source column each of its pixels is sampled from */
+	std::vector<uint32_t> rowBuf;
+	std::vector<int> colMap;
+};
+
+#endif // SOFTRASTER_H
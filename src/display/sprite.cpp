@@ -36,15 +36,18 @@
 #include "shader.h"
 #include "glstate.h"
 #include "quadarray.h"
+#include "preparequeue.h"
+#include "spritebatch.h"
+#else
+#include "softraster.h"
 #endif // MKXPZ_RETRO
 
+#include <algorithm>
 #include <math.h>
 #ifndef M_PI
 # define M_PI 3.14159265358979323846
 #endif
 
-#include <SDL_rect.h>
-
 #include "sigslot/signal.hpp"
 
 struct SpritePrivate
@@ -61,6 +64,9 @@ struct SpritePrivate
     int oy;
     float zoom_x;
     float zoom_y;
+    Vec2i sceneOffset;
+    /* Source rect with the pattern applied */
+    SoftSurface patternSurf;
 #else
     Quad quad;
     Transform trans;
@@ -111,6 +117,16 @@ struct SpritePrivate
 #endif // MKXPZ_RETRO
     } wave;
     
+#ifndef MKXPZ_RETRO
+    struct WaveJob : PrepareQueue::Job
+    {
+        SpritePrivate *p;
+        
+        void build() { p->buildWave(); }
+        void submit() { p->wave.qArray.commit(); }
+    } waveJob;
+#endif // MKXPZ_RETRO
+    
     EtcTemps tmp;
     
     sigslot::connection prepareCon;
@@ -155,7 +171,12 @@ struct SpritePrivate
         wave.length = 180;
         wave.speed = 360;
         wave.phase = 0.0f;
+        wave.active = false;
         wave.dirty = false;
+        
+#ifndef MKXPZ_RETRO
+        waveJob.p = this;
+#endif // MKXPZ_RETRO
     }
     
     ~SpritePrivate()
@@ -179,7 +200,7 @@ struct SpritePrivate
         
         /* Calculate effective (normalized) bush depth */
 #ifdef MKXPZ_RETRO
-        float texBushDepth = bushDepth - // TODO
+        float texBushDepth = (bushDepth / zoom_y) -
 #else
         float texBushDepth = (bushDepth / trans.getScale().y) -
 #endif // MKXPZ_RETRO
@@ -249,39 +270,119 @@ struct SpritePrivate
         if (!opacity)
             return;
         
-        if (wave.active)
-        {
-            /* Don't do expensive wave bounding box
-             * calculations */
-            isVisible = true;
-            return;
-        }
-        
+#ifdef MKXPZ_RETRO
         /* Compare sprite bounding box against the scene */
         
-        /* If sprite is zoomed/rotated, just opt out for now
+        /* If sprite is zoomed, just opt out for now
          * for simplicity's sake */
-#ifndef MKXPZ_RETRO
-        const Vec2 &scale = trans.getScale();
-        if (scale.x != 1 || scale.y != 1 || trans.getRotation() != 0)
+        if (zoom_x != 1 || zoom_y != 1)
         {
             isVisible = true;
             return;
         }
-#endif // MKXPZ_RETRO
         
         IntRect self;
-#ifndef MKXPZ_RETRO
-        self.setPos(trans.getPositionI() - (trans.getOriginI() + sceneOrig));
-#endif // MKXPZ_RETRO
+        self.setPos(Vec2i(x, y) - (Vec2i(ox, oy) + sceneOrig));
         self.w = bitmap->width();
         self.h = bitmap->height();
         
-#ifndef MKXPZ_RETRO
-        isVisible = SDL_HasIntersection(&self, &sceneRect);
+        if (wave.active)
+        {
+            self.x -= abs(wave.amp);
+            self.w += abs(wave.amp) * 2;
+        }
+        
+        isVisible = self.intersects(sceneRect);
+#else
+        /* Scene culls us by our bounds */
+        isVisible = true;
 #endif // MKXPZ_RETRO
     }
     
+#ifdef MKXPZ_RETRO
+    /* Screen rect of a 'w' x 'h' part of the source rect,
+     * starting 'localX' unzoomed pixels from its left edge */
+    IntRect softDestRect(int localX, int w, int h) const
+    {
+        const int left = x - (int) lroundf((ox - localX) * zoom_x);
+        const int top = y - (int) lroundf(oy * zoom_y);
+        
+        return IntRect(left + sceneOffset.x, top + sceneOffset.y,
+                       (int) lroundf(w * zoom_x), (int) lroundf(h * zoom_y));
+    }
+    
+    /* Draws with bush opacity applied to everything below 'bushY' */
+    void drawSoft(const SoftSurface &src, const IntRect &srcRect,
+                  const IntRect &destRect, SoftBlend blend, int bushY)
+    {
+        SoftRaster &raster = shState->softRaster();
+        const IntRect clip = raster.clip();
+        
+        if (bushY >= clip.y + clip.h)
+        {
+            raster.draw(src, srcRect, destRect, blend);
+            return;
+        }
+        
+        raster.pushClip(IntRect(clip.x, clip.y, clip.w, bushY - clip.y));
+        raster.draw(src, srcRect, destRect, blend);
+        raster.popClip();
+        
+        blend.opacity = (blend.opacity * bushOpacity) / 255;
+        
+        raster.pushClip(IntRect(clip.x, bushY, clip.w, clip.y + clip.h - bushY));
+        raster.draw(src, srcRect, destRect, blend);
+        raster.popClip();
+    }
+#endif // MKXPZ_RETRO
+    
+#ifndef MKXPZ_RETRO
+    /* Bounding box of the transformed sprite quad */
+    IntRect screenBounds()
+    {
+        const Vec2 &tl = quad.vert[0].pos;
+        const Vec2 &br = quad.vert[2].pos;
+        FloatRect local(tl.x, tl.y, br.x - tl.x, br.y - tl.y);
+        
+        if (wave.active && wave.amp > 0)
+        {
+            /* Rows are shifted by up to 'amp' pixels */
+            local = FloatRect(-wave.amp, 0,
+                              srcRect->width + wave.amp * 2, srcRect->height);
+        }
+        else if (wave.active)
+        {
+            /* See buildWave() */
+            local = FloatRect(0, srcRect->y, srcRect->width, srcRect->height);
+        }
+        
+        const float *m = trans.getMatrix();
+        const Vec2 corners[] =
+        {
+            local.topLeft(), local.topRight(),
+            local.bottomRight(), local.bottomLeft()
+        };
+        
+        float minX = 0, minY = 0, maxX = 0, maxY = 0;
+        
+        for (int i = 0; i < 4; ++i)
+        {
+            float cx = m[0] * corners[i].x + m[4] * corners[i].y + m[12];
+            float cy = m[1] * corners[i].x + m[5] * corners[i].y + m[13];
+            
+            if (i == 0 || cx < minX) minX = cx;
+            if (i == 0 || cy < minY) minY = cy;
+            if (i == 0 || cx > maxX) maxX = cx;
+            if (i == 0 || cy > maxY) maxY = cy;
+        }
+        
+        int x = floorf(minX);
+        int y = floorf(minY);
+        
+        return IntRect(x, y, (int) ceilf(maxX) - x, (int) ceilf(maxY) - y);
+    }
+#endif // MKXPZ_RETRO
+    
 #ifndef MKXPZ_RETRO
     void emitWaveChunk(SVertex *&vert, float phase, int width,
                        float zoomY, int chunkY, int chunkLength)
@@ -297,19 +398,10 @@ struct SpritePrivate
         vert += 4;
     }
     
-    void updateWave()
+    /* Only writes to wave.qArray's vertices, so this
+     * can run on the prepare workers */
+    void buildWave()
     {
-        if (nullOrDisposed(bitmap))
-            return;
-        
-        if (wave.amp == 0)
-        {
-            wave.active = false;
-            return;
-        }
-        
-        wave.active = true;
-        
         int width = srcRect->width;
         int height = srcRect->height;
         float zoomY = trans.getScale().y;
@@ -317,7 +409,6 @@ struct SpritePrivate
         if (wave.amp < -(width / 2))
         {
             wave.qArray.resize(0);
-            wave.qArray.commit();
             
             return;
         }
@@ -333,7 +424,6 @@ struct SpritePrivate
             FloatRect tex(x, srcRect->y, w, srcRect->height);
             
             Quad::setTexPosRect(&wave.qArray.vertices[0], tex, tex);
-            wave.qArray.commit();
             
             return;
         }
@@ -363,8 +453,6 @@ struct SpritePrivate
         
         if (lastLength > 0)
             emitWaveChunk(vert, phase, width, zoomY, firstLength + chunks * 8, lastLength);
-        
-        wave.qArray.commit();
     }
 #endif // MKXPZ_RETRO
     
@@ -372,8 +460,10 @@ struct SpritePrivate
     {
         if (wave.dirty)
         {
+            wave.active = !nullOrDisposed(bitmap) && wave.amp != 0;
 #ifndef MKXPZ_RETRO
-            updateWave();
+            if (wave.active)
+                shState->prepareQueue().push(&waveJob);
 #endif // MKXPZ_RETRO
             wave.dirty = false;
         }
@@ -470,7 +560,12 @@ void Sprite::setX(int value)
 {
     guardDisposed();
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (p->x == value)
+        return;
+    
+    p->x = value;
+#else
     if (p->trans.getPosition().x == value)
         return;
     
@@ -482,7 +577,12 @@ void Sprite::setY(int value)
 {
     guardDisposed();
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (p->y == value)
+        return;
+    
+    p->y = value;
+#else
     if (p->trans.getPosition().y == value)
         return;
     
@@ -500,7 +600,12 @@ void Sprite::setOX(int value)
 {
     guardDisposed();
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (p->ox == value)
+        return;
+    
+    p->ox = value;
+#else
     if (p->trans.getOrigin().x == value)
         return;
     
@@ -512,7 +617,12 @@ void Sprite::setOY(int value)
 {
     guardDisposed();
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (p->oy == value)
+        return;
+    
+    p->oy = value;
+#else
     if (p->trans.getOrigin().y == value)
         return;
     
@@ -524,7 +634,12 @@ void Sprite::setZoomX(float value)
 {
     guardDisposed();
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (p->zoom_x == value)
+        return;
+    
+    p->zoom_x = value;
+#else
     if (p->trans.getScale().x == value)
         return;
     
@@ -536,7 +651,12 @@ void Sprite::setZoomY(float value)
 {
     guardDisposed();
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (p->zoom_y == value)
+        return;
+    
+    p->zoom_y = value;
+#else
     if (p->trans.getScale().y == value)
         return;
     
@@ -679,7 +799,98 @@ void Sprite::draw()
     if (emptyFlashFlag)
         return;
     
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    if (p->zoom_x <= 0 || p->zoom_y <= 0)
+        return;
+    
+    const SoftSurface *src = &p->bitmap->getSoftSurface();
+    
+    IntRect srcRect = p->srcRect->toIntRect();
+    srcRect.w = clamp<int>(srcRect.w, 0, src->width - srcRect.x);
+    srcRect.h = clamp<int>(srcRect.h, 0, src->height - srcRect.y);
+    
+    if (!nullOrDisposed(p->pattern) && p->patternOpacity > 0)
+    {
+        SoftPattern pattern;
+        pattern.blendType = p->patternBlendType;
+        pattern.opacity = p->patternOpacity;
+        pattern.tile = p->patternTile;
+        pattern.scroll = p->patternScroll;
+        pattern.zoom = p->patternZoom;
+        
+        SoftRaster::patterned(p->patternSurf, *src, srcRect,
+                              p->pattern->getSoftSurface(), pattern);
+        
+        if (!p->patternSurf.pixels)
+            return;
+        
+        src = &p->patternSurf;
+        srcRect = IntRect(0, 0, src->width, src->height);
+    }
+    
+    SoftBlend blend;
+    blend.opacity = p->opacity;
+    blend.blendType = p->blendType;
+    blend.mirror = p->mirrored;
+    blend.invert = p->invert;
+    blend.tone = p->tone->norm;
+    
+    /* When both flashing and effective color are set,
+     * the one with higher alpha will be blended */
+    blend.color = (flashing && flashColor.w > p->color->norm.w) ?
+    flashColor : p->color->norm;
+    
+    const IntRect destRect = p->softDestRect(0, srcRect.w, srcRect.h);
+    
+    /* Bush depth is measured in screen pixels from the bottom
+     * of the sprite; the part below it uses bush opacity */
+    const int bushY = destRect.y + destRect.h - std::max(p->bushDepth, 0);
+    
+    if (!p->wave.active)
+    {
+        p->drawSoft(*src, srcRect, destRect, blend, bushY);
+        return;
+    }
+    
+    if (p->wave.amp < 0)
+    {
+        /* Negative amplitude squeezes the sprite horizontally */
+        const int inset = -p->wave.amp;
+        
+        if (inset > srcRect.w / 2)
+            return;
+        
+        IntRect part(srcRect.x + inset, srcRect.y, srcRect.w - inset * 2, srcRect.h);
+        p->drawSoft(*src, part, p->softDestRect(inset, part.w, part.h), blend, bushY);
+        return;
+    }
+    
+    /* Shift the sprite sideways in 8 pixel tall chunks aligned
+     * to the screen, like the wave quads of the GL backend */
+    SoftRaster &raster = shState->softRaster();
+    const IntRect clip = raster.clip();
+    const float phase = (p->wave.phase * (float) M_PI) / 180.0f;
+    const int firstLength = ((p->y % 8) + 8) % 8;
+    
+    for (int chunkY = 0; chunkY < destRect.h;)
+    {
+        int length = (chunkY == 0 && firstLength > 0) ? firstLength : 8;
+        length = std::min(length, destRect.h - chunkY);
+        
+        float wavePos = phase;
+        if (p->wave.length != 0)
+            wavePos += (chunkY / (float) p->wave.length) * (float) (M_PI * 2);
+        
+        IntRect chunkRect = destRect;
+        chunkRect.x += (int) lroundf(sinf(wavePos) * p->wave.amp * p->zoom_x);
+        
+        raster.pushClip(IntRect(clip.x, destRect.y + chunkY, clip.w, length));
+        p->drawSoft(*src, srcRect, chunkRect, blend, bushY);
+        raster.popClip();
+        
+        chunkY += length;
+    }
+#else
     ShaderBase *base;
     
     bool renderEffect = p->color->hasEffect() ||
@@ -728,6 +939,18 @@ void Sprite::draw()
         scalingMethod = shState->config().bitmapSmoothScaling;
     }
 
+    SpriteBatch &batch = shState->spriteBatch();
+
+    if (!renderEffect && scalingMethod == NearestNeighbor &&
+        !p->wave.active && batch.isEnabled())
+    {
+        batch.add(*p->bitmap, p->blendType, p->quad.vert,
+                  p->trans.getMatrix(), p->opacity.norm);
+        return;
+    }
+
+    batch.flush();
+
     if (renderEffect)
     {
         if (scalingMethod != NearestNeighbor)
@@ -869,11 +1092,26 @@ void Sprite::draw()
 #endif // MKXPZ_RETRO
 }
 
+bool Sprite::getBounds(IntRect &bounds) const
+{
+#ifdef MKXPZ_RETRO
+    /* Checked against the scene in updateVisibility() */
+    return false;
+#else
+    /* An empty rect culls sprites with nothing to draw */
+    bounds = p->isVisible ? p->screenBounds() : IntRect();
+    
+    return true;
+#endif // MKXPZ_RETRO
+}
+
 void Sprite::onGeometryChange(const Scene::Geometry &geo)
 {
     /* Offset at which the sprite will be drawn
      * relative to screen origin */
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+    p->sceneOffset = geo.offset();
+#else
     p->trans.setGlobalOffset(geo.offset());
 #endif // MKXPZ_RETRO
     
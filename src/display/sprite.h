@@ -82,6 +82,8 @@ private:
 	SpritePrivate *p;
 
 	void draw();
+	bool batchable() const { return true; }
+	bool getBounds(IntRect &bounds) const;
 	void onGeometryChange(const Scene::Geometry &);
 
 	void releaseResources();
@@ -0,0 +1,134 @@
+/*
+** spritebatch.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "spritebatch.h"
+
+#include "sharedstate.h"
+#include "global-ibo.h"
+#include "glstate.h"
+#include "shader.h"
+#include "bitmap.h"
+
+/* Keeps runs within what 16 bit indices can address */
+static const size_t maxQuads = 4096;
+
+SpriteBatch::SpriteBatch(bool enabled)
+    : enabled(enabled),
+      bitmap(0),
+      blendType(BlendNormal),
+      vboOffset(0)
+{
+	vbo = VBO::gen();
+
+	GLMeta::vaoFillInVertexData<Vertex>(vao);
+	vao.vbo = vbo;
+	vao.ibo = shState->globalIBO().ibo;
+
+	GLMeta::vaoInit(vao, true);
+	VBO::allocEmpty(maxQuads * sizeof(Vertex[4]), GL_DYNAMIC_DRAW);
+	GLMeta::vaoUnbind(vao);
+
+	vertices.reserve(maxQuads * 4);
+}
+
+SpriteBatch::~SpriteBatch()
+{
+	GLMeta::vaoFini(vao);
+	VBO::del(vbo);
+}
+
+void SpriteBatch::add(Bitmap &bitmap, BlendType blendType, const Vertex quad[4],
+                      const float matrix[16], float opacity)
+{
+	if (&bitmap != this->bitmap || blendType != this->blendType ||
+	    vertices.size() == maxQuads * 4)
+	{
+		flush();
+
+		this->bitmap = &bitmap;
+		this->blendType = blendType;
+	}
+
+	/* Same math as projMat * spriteMat in sprite.vert,
+	 * minus the projection */
+	for (int i = 0; i < 4; ++i)
+	{
+		const Vec2 &pos = quad[i].pos;
+
+		Vertex v;
+		v.pos = Vec2(matrix[0] * pos.x + matrix[4] * pos.y + matrix[12],
+		             matrix[1] * pos.x + matrix[5] * pos.y + matrix[13]);
+		v.texPos = quad[i].texPos;
+		v.color = Vec4(1, 1, 1, opacity);
+
+		vertices.push_back(v);
+	}
+}
+
+void SpriteBatch::flush()
+{
+	if (vertices.empty())
+		return;
+
+	size_t quadCount = vertices.size() / 4;
+
+	VBO::bind(vbo);
+
+	if (vboOffset + quadCount > maxQuads)
+	{
+		/* Orphan the old storage instead of waiting for
+		 * the draws still reading from it */
+		VBO::allocEmpty(maxQuads * sizeof(Vertex[4]), GL_DYNAMIC_DRAW);
+		vboOffset = 0;
+	}
+
+	VBO::uploadSubData(vboOffset * sizeof(Vertex[4]),
+	                   quadCount * sizeof(Vertex[4]), dataPtr(vertices));
+	VBO::unbind();
+
+	shState->ensureQuadIBO(vboOffset + quadCount);
+
+	/* Same output as SimpleSpriteShader / AlphaSpriteShader,
+	 * with the matrix and opacity baked into the vertices */
+	SimpleAlphaShader &shader = shState->shaders().simpleAlpha;
+	shader.bind();
+	shader.applyViewportProj();
+	shader.setTranslation(Vec2i());
+
+	bitmap->bindTex(shader, false);
+	TEX::setSmooth(false);
+
+	glState.blendMode.pushSet(blendType);
+
+	GLMeta::vaoBind(vao);
+
+	const char *offset = (const char*) 0 + vboOffset * 6 * sizeof(index_t);
+	gl.DrawElements(GL_TRIANGLES, quadCount * 6, _GL_INDEX_TYPE, offset);
+
+	GLMeta::vaoUnbind(vao);
+
+	glState.blendMode.pop();
+
+	vboOffset += quadCount;
+	vertices.clear();
+	bitmap = 0;
+}
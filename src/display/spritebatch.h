@@ -0,0 +1,75 @@
+/*
+** spritebatch.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include "vertex.h"
+#include "gl-util.h"
+#include "gl-meta.h"
+#include "etc.h"
+
+#include <vector>
+
+class Bitmap;
+
+/* Collects consecutive plain sprites (no per-sprite shader
+ * uniforms besides their matrix and opacity) that share a
+ * bitmap and blend type, and draws them with one call.
+ *
+ * Vertices are transformed on the CPU, so the sprite matrix
+ * doesn't have to be a uniform, and the opacity goes into the
+ * vertex color. Scene elements that draw anything else must
+ * call 'flush()' first, so that the draw order is kept */
+class SpriteBatch
+{
+public:
+	SpriteBatch(bool enabled);
+	~SpriteBatch();
+
+	bool isEnabled() const { return enabled; }
+
+	/* 'quad' holds the sprite's four vertices in local space */
+	void add(Bitmap &bitmap, BlendType blendType, const Vertex quad[4],
+	         const float matrix[16], float opacity);
+
+	/* Draws the pending run, if any */
+	void flush();
+
+private:
+	bool enabled;
+
+	Bitmap *bitmap;
+	BlendType blendType;
+
+	std::vector<Vertex> vertices;
+
+	VBO::ID vbo;
+	GLMeta::VAO vao;
+
+	/* Quads already uploaded to the VBO in this pass over it;
+	 * new runs go behind them so we never overwrite vertices
+	 * a pending draw may still read */
+	size_t vboOffset;
+};
+
+#endif // SPRITEBATCH_H
@@ -0,0 +1,234 @@
+/*
+** textruncache.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textruncache.h"
+
+#include "sharedstate.h"
+#include "texpool.h"
+#include "gl-meta.h"
+
+#include <SDL_ttf.h>
+
+static bool sameStyle(const GlyphCache::Style &a, const GlyphCache::Style &b)
+{
+	return a.solid == b.solid &&
+	       a.shadow == b.shadow &&
+	       a.outline == b.outline &&
+	       a.color == b.color &&
+	       /* Only used when there is an outline */
+	       (a.outline == 0 || a.outColor == b.outColor);
+}
+
+static uint32_t byteCount(const TEXFBO &tex)
+{
+	return tex.width * tex.height * 4;
+}
+
+bool TextRunCache::Key::operator<(const Key &o) const
+{
+	if (font != o.font)
+		return font < o.font;
+
+	if (style != o.style)
+		return style < o.style;
+
+	return str < o.str;
+}
+
+TextRunCache::TextRunCache(int maxEntries, uint32_t maxMemSize)
+    : maxEntries(maxEntries),
+      maxMemSize(maxMemSize),
+      memSize(0),
+      hits(0),
+      misses(0)
+{}
+
+TextRunCache::~TextRunCache()
+{
+	clear();
+}
+
+TextRunCache::Entry *
+TextRunCache::find(_TTF_Font *font, const char *str, bool create)
+{
+	if (maxEntries <= 0)
+		return 0;
+
+	Key key;
+	key.font = font;
+	key.style = TTF_GetFontStyle(font);
+	key.str = str;
+
+	std::map<Key, EntryList::iterator>::iterator iter = index.find(key);
+
+	if (iter != index.end())
+	{
+		/* Mark as most recently used */
+		entries.splice(entries.begin(), entries, iter->second);
+
+		return &*iter->second;
+	}
+
+	if (!create)
+		return 0;
+
+	Entry entry;
+	entry.key = key;
+	entry.hasSize = false;
+
+	entries.push_front(entry);
+	index[key] = entries.begin();
+
+	return &entries.front();
+}
+
+bool TextRunCache::lookupSize(_TTF_Font *font, const char *str, IntRect &out)
+{
+	Entry *entry = find(font, str, false);
+
+	if (!entry || !entry->hasSize)
+	{
+		++misses;
+		return false;
+	}
+
+	++hits;
+	out = entry->size;
+
+	return true;
+}
+
+void TextRunCache::storeSize(_TTF_Font *font, const char *str, const IntRect &size)
+{
+	Entry *entry = find(font, str, true);
+
+	if (!entry)
+		return;
+
+	entry->hasSize = true;
+	entry->size = size;
+
+	trim();
+}
+
+bool TextRunCache::lookupRun(_TTF_Font *font, const char *str,
+                             const GlyphCache::Style &style, GlyphCache::Run &out)
+{
+	Entry *entry = find(font, str, false);
+
+	if (entry)
+	{
+		for (size_t i = 0; i < entry->variants.size(); ++i)
+		{
+			Variant &v = entry->variants[i];
+
+			if (!sameStyle(v.style, style))
+				continue;
+
+			++hits;
+
+			out.tex = &v.tex;
+			out.size = v.size;
+			out.textHeight = v.textHeight;
+
+			return true;
+		}
+	}
+
+	++misses;
+
+	return false;
+}
+
+void TextRunCache::storeRun(_TTF_Font *font, const char *str,
+                            const GlyphCache::Style &style, const GlyphCache::Run &run)
+{
+	Entry *entry = find(font, str, true);
+
+	if (!entry)
+		return;
+
+	Variant v;
+	v.style = style;
+	v.size = run.size;
+	v.textHeight = run.textHeight;
+	v.tex = shState->texPool().request(run.size.x, run.size.y);
+
+	GLMeta::blitBegin(v.tex);
+	GLMeta::blitSource(*run.tex);
+	GLMeta::blitRectangle(IntRect(Vec2i(), run.size), Vec2i());
+	GLMeta::blitEnd();
+
+	memSize += byteCount(v.tex);
+	entry->variants.push_back(v);
+
+	trim();
+}
+
+TextRunCache::Stats TextRunCache::getStats() const
+{
+	Stats stats;
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.entries = index.size();
+	stats.memSize = memSize;
+
+	return stats;
+}
+
+void TextRunCache::resetStats()
+{
+	hits = misses = 0;
+}
+
+void TextRunCache::clear()
+{
+	for (EntryList::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+		releaseEntry(*iter);
+
+	entries.clear();
+	index.clear();
+}
+
+void TextRunCache::releaseEntry(Entry &entry)
+{
+	for (size_t i = 0; i < entry.variants.size(); ++i)
+	{
+		memSize -= byteCount(entry.variants[i].tex);
+		shState->texPool().release(entry.variants[i].tex);
+	}
+
+	entry.variants.clear();
+}
+
+void TextRunCache::trim()
+{
+	/* Drop least recently used entries until we're within budget */
+	while (!entries.empty() &&
+	       ((int) entries.size() > maxEntries || memSize > maxMemSize))
+	{
+		Entry &last = entries.back();
+
+		releaseEntry(last);
+		index.erase(last.key);
+		entries.pop_back();
+	}
+}
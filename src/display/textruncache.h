@@ -0,0 +1,126 @@
+/*
+** textruncache.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTRUNCACHE_H
+#define TEXTRUNCACHE_H
+
+#include "glyphcache.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct _TTF_Font;
+
+/* Remembers the outcome of recent Bitmap::drawText and
+ * Bitmap::textSize calls, so that strings redrawn every
+ * frame or on every menu refresh (numbers, labels, item
+ * names) are neither re-laid out nor re-measured.
+ * Entries are keyed by font handle, font style and string;
+ * each holds the measured size and the rendered runs for
+ * every color/outline/shadow combination it was drawn in */
+class TextRunCache
+{
+public:
+	struct Stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+
+		int entries;
+		uint32_t memSize;
+	};
+
+	TextRunCache(int maxEntries,
+	             uint32_t maxMemSize = 16000000 /* 16 MB */);
+	~TextRunCache();
+
+	/* Returns false if 'str' has to be measured; the
+	 * result should then be handed to storeSize() */
+	bool lookupSize(_TTF_Font *font, const char *str, IntRect &out);
+	void storeSize(_TTF_Font *font, const char *str, const IntRect &size);
+
+	/* Returns false if 'str' has to be rendered; the
+	 * result should then be handed to storeRun() */
+	bool lookupRun(_TTF_Font *font, const char *str,
+	               const GlyphCache::Style &style, GlyphCache::Run &out);
+
+	/* Keeps a copy of 'run', which only needs
+	 * to stay valid for the duration of this call */
+	void storeRun(_TTF_Font *font, const char *str,
+	              const GlyphCache::Style &style, const GlyphCache::Run &run);
+
+	Stats getStats() const;
+	void resetStats();
+
+	void clear();
+
+private:
+	struct Key
+	{
+		_TTF_Font *font;
+		int style;
+		std::string str;
+
+		bool operator<(const Key &o) const;
+	};
+
+	struct Variant
+	{
+		GlyphCache::Style style;
+		TEXFBO tex;
+		Vec2i size;
+		int textHeight;
+	};
+
+	struct Entry
+	{
+		Key key;
+
+		bool hasSize;
+		IntRect size;
+
+		std::vector<Variant> variants;
+	};
+
+	typedef std::list<Entry> EntryList;
+
+	/* Returns the entry for 'font'/'str' moved to the front,
+	 * or 0 if there is none. 'create' adds missing ones */
+	Entry *find(_TTF_Font *font, const char *str, bool create);
+	void releaseEntry(Entry &entry);
+	void trim();
+
+	/* Sorted by last use, most recent first */
+	EntryList entries;
+	std::map<Key, EntryList::iterator> index;
+
+	const int maxEntries;
+	const uint32_t maxMemSize;
+	uint32_t memSize;
+
+	uint64_t hits;
+	uint64_t misses;
+};
+
+#endif // TEXTRUNCACHE_H
@@ -34,6 +34,8 @@
 #include "shader.h"
 #include "vertex.h"
 #include "quad.h"
+#else
+#include "softraster.h"
 #endif // MKXPZ_RETRO
 #include "etc-internal.h"
 
@@ -114,31 +116,31 @@ atSelectSubPos(FloatRect &pos, int i)
 	}
 }
 
+/* Flash colors of the map viewport are kept in a texture with
+ * one texel per tile, which is stretched over the viewport in
+ * a single quad. Scrolling or changing flash data only refills
+ * the (viewport sized) texture, and drawing costs no CPU work */
 struct FlashMap
 {
 	FlashMap()
 		: dirty(false),
-#ifdef MKXPZ_RETRO
-	      data(0)
-#else
 	      data(0),
-	      allocQuads(0)
-#endif // MKXPZ_RETRO
+	      flashCount(0)
 	{
 #ifndef MKXPZ_RETRO
-		vao.vbo = VBO::gen();
-		vao.ibo = shState->globalIBO().ibo;
-		GLMeta::vaoFillInVertexData<CVertex>(vao);
+		tex = TEX::gen();
+		texSize = Vec2i();
 
-		GLMeta::vaoInit(vao);
+		TEX::bind(tex);
+		TEX::setRepeat(false);
+		TEX::setSmooth(false);
 #endif // MKXPZ_RETRO
 	}
 
 	~FlashMap()
 	{
 #ifndef MKXPZ_RETRO
-		GLMeta::vaoFini(vao);
-		VBO::del(vao.vbo);
+		TEX::del(tex);
 #endif // MKXPZ_RETRO
 		dataCon.disconnect();
 	}
@@ -176,19 +178,16 @@ struct FlashMap
 		if (!dirty)
 			return;
 
-		rebuildBuffer();
+		rebuildTexture();
 		dirty = false;
 	}
 
 	void draw(float alpha, const Vec2i &trans)
 	{
-		const size_t count = quadCount();
-
-		if (count == 0)
+		if (flashCount == 0)
 			return;
 
 #ifndef MKXPZ_RETRO
-		GLMeta::vaoBind(vao);
 		glState.blendMode.pushSet(BlendAddition);
 
 		FlashMapShader &shader = shState->shaders().flashMap;
@@ -196,12 +195,25 @@ struct FlashMap
 		shader.applyViewportProj();
 		shader.setAlpha(alpha);
 		shader.setTranslation(trans);
+		shader.setTexSize(texSize);
+
+		TEX::bind(tex);
 
-		gl.DrawElements(GL_TRIANGLES, count * 6, _GL_INDEX_TYPE, 0);
+		/* Nearest sampling turns every texel into a full tile */
+		Quad &quad = shState->gpQuad();
+		quad.setTexRect(FloatRect(0, 0, viewp.w, viewp.h));
+		quad.setPosRect(FloatRect(0, 0, viewp.w*32, viewp.h*32));
+		quad.draw();
 
 		glState.blendMode.pop();
+#else
+		SoftBlend blend;
+		blend.opacity = alpha * 255;
+		blend.blendType = BlendAddition;
 
-		GLMeta::vaoUnbind(vao);
+		/* Nearest scaling turns every pixel into a full tile */
+		shState->softRaster().draw(surf, surf.rect(),
+		                           IntRect(trans, viewp.size() * 32), blend);
 #endif // MKXPZ_RETRO
 	}
 
@@ -211,80 +223,60 @@ private:
 		dirty = true;
 	}
 
-	size_t quadCount() const
-	{
-#ifdef MKXPZ_RETRO
-		return 0; // TODO
-#else
-		return vertices.size() / 4;
-#endif // MKXPZ_RETRO
-	}
-
-	bool sampleFlashColor(Vec4 &out, int x, int y) const
-	{
-		int16_t packed = tableGetWrapped(*data, x, y);
-
-		if (packed == 0)
-			return false;
-
-		const float max = 0xF;
-
-		float b = ((packed & 0x000F) >> 0) / max;
-		float g = ((packed & 0x00F0) >> 4) / max;
-		float r = ((packed & 0x0F00) >> 8) / max;
-
-		out = Vec4(r, g, b, 1);
-
-		return true;
-	}
-
-	void rebuildBuffer()
+	void rebuildTexture()
 	{
-#ifndef MKXPZ_RETRO
-		vertices.clear();
-#endif // MKXPZ_RETRO
+		flashCount = 0;
 
-		if (!data)
+		if (!data || viewp.w <= 0 || viewp.h <= 0)
 			return;
 
-		for (int x = 0; x < viewp.w; ++x)
-			for (int y = 0; y < viewp.h; ++y)
-			{
-				Vec4 color;
+		texels.resize(viewp.w * viewp.h * 4);
 
-				if (!sampleFlashColor(color, x+viewp.x, y+viewp.y))
-					continue;
-
-				FloatRect posRect(x*32, y*32, 32, 32);
+		for (int y = 0; y < viewp.h; ++y)
+			for (int x = 0; x < viewp.w; ++x)
+			{
+				int16_t packed = tableGetWrapped(*data, x+viewp.x, y+viewp.y);
+				uint8_t *texel = &texels[(y*viewp.w + x) * 4];
 
-#ifndef MKXPZ_RETRO
-				CVertex v[4];
-				Quad::setPosRect(v, posRect);
-				Quad::setColor(v, color);
+				/* 4 bit components, 0xF * 0x11 = 0xFF */
+				texel[0] = ((packed & 0x0F00) >> 8) * 0x11;
+				texel[1] = ((packed & 0x00F0) >> 4) * 0x11;
+				texel[2] = ((packed & 0x000F) >> 0) * 0x11;
+				texel[3] = 0xFF;
 
-				for (size_t i = 0; i < 4; ++i)
-					vertices.push_back(v[i]);
-#endif // MKXPZ_RETRO
+				if (packed != 0)
+					++flashCount;
 			}
 
 #ifndef MKXPZ_RETRO
-		if (vertices.size() == 0)
+		if (flashCount == 0)
 			return;
 
-		VBO::bind(vao.vbo);
+		TEX::bind(tex);
 
-		if (quadCount() > allocQuads)
+		if (texSize != viewp.size())
 		{
-			allocQuads = quadCount();
-			VBO::allocEmpty(sizeof(CVertex) * vertices.size());
+			texSize = viewp.size();
+			TEX::uploadImage(texSize.x, texSize.y, dataPtr(texels), GL_RGBA);
 		}
+		else
+		{
+			TEX::uploadSubImage(0, 0, texSize.x, texSize.y, dataPtr(texels), GL_RGBA);
+		}
+#else
+		if (flashCount == 0)
+			return;
 
-		VBO::uploadSubData(0, sizeof(CVertex) * vertices.size(), dataPtr(vertices));
+		if (surf.width != viewp.w || surf.height != viewp.h)
+			surf.alloc(viewp.w, viewp.h);
 
-		VBO::unbind();
+		for (int y = 0; y < viewp.h; ++y)
+			for (int x = 0; x < viewp.w; ++x)
+			{
+				const uint8_t *texel = &texels[(y*viewp.w + x) * 4];
 
-		/* Ensure global IBO size */
-		shState->ensureQuadIBO(quadCount());
+				surf.row(y)[x] = 0xFF000000 | (texel[0] << 16) | (texel[1] << 8) | texel[2];
+			}
 #endif // MKXPZ_RETRO
 	}
 
@@ -295,10 +287,18 @@ private:
 
 	IntRect viewp;
 
+	/* RGBA8, one texel per viewport tile */
+	std::vector<uint8_t> texels;
+
+	/* Tiles with a flash color set */
+	size_t flashCount;
+
 #ifndef MKXPZ_RETRO
-	GLMeta::VAO vao;
-	size_t allocQuads;
-	std::vector<CVertex> vertices;
+	TEX::ID tex;
+	Vec2i texSize;
+#else
+	/* One pixel per viewport tile */
+	SoftSurface surf;
 #endif // MKXPZ_RETRO
 };
 
@@ -40,6 +40,9 @@
 #include "texpool.h"
 #include "quad.h"
 #include "vertex.h"
+#include "preparequeue.h"
+#else
+#include "softraster.h"
 #endif // MKXPZ_RETRO
 #include "tileatlas.h"
 #include "tilemap-common.h"
@@ -80,6 +83,14 @@ static const int viewpH = 16;
 
 static const size_t zlayersMax = viewpH + 5;
 
+/* The ground plus priorities 1 to 5 */
+static const int prioSlots = 6;
+
+/* Size of the tile cell ring, which just
+ * covers the map viewport */
+static const int cellRingW = viewpW + 1;
+static const int cellRingH = viewpH + 1;
+
 /* Vocabulary:
  *
  * Atlas: A texture containing both the tileset and all
@@ -163,6 +174,19 @@ static const size_t zlayersMax = viewpH + 5;
  *   adjusted if necessary and the data is regenerated. Its size
  *   is fixed. This is NOT related to the RGSS Viewport class!
  *
+ * Tile cells:
+ *   The quads of every map position in the map viewport are
+ *   kept around, sorted by priority, in a grid that wraps
+ *   around at the viewport size (the cell ring). A cell is
+ *   only regenerated when the viewport scrolls a new map
+ *   position onto it, or when the map data reports its row
+ *   as changed. The ground layer and zlayers are then assembled
+ *   from the cells. Cell vertices are in map space, so they
+ *   stay valid across scrolling. The assembled buffer is in
+ *   viewport order though, so scrolling still shifts (and
+ *   uploads) nearly all of it; only edits that leave the
+ *   quad counts alone get away with a partial upload.
+ *
  */
 
 /* Autotile animation */
@@ -291,15 +315,64 @@ struct TilemapPrivate
 	Vec2i viewpPos;
 
 #ifndef MKXPZ_RETRO
-	/* Ground layer vertices */
-	SVVector groundVert;
+	/* Quads of one map position */
+	struct TileCell
+	{
+		/* Map position the quads were generated for */
+		Vec2i pos;
+		bool valid;
+
+		/* Base quad indices of each priority in 'vert' */
+		uint16_t slotBases[prioSlots+1];
+		SVVector vert;
+
+		TileCell()
+		    : valid(false)
+		{}
+	};
+
+	/* Indexed by map position modulo the ring size */
+	std::vector<TileCell> cells;
 
-	/* ZLayer vertices */
-	SVVector zlayerVert[zlayersMax];
+	/* Map data version the cells are up to date with */
+	uint64_t cellsVersion;
+
+	/* Per priority scratch space for generating a cell */
+	SVVector slotVert[prioSlots];
+
+	/* Ground layer vertices followed by all zlayer vertices */
+	SVVector tileVert;
+
+	/* What the shared buffer currently holds */
+	SVVector uploadedVert;
+
+	/* Quads of 'tileVert' that differ from 'uploadedVert' */
+	size_t uploadBegin;
+	size_t uploadEnd;
+#else
+	/* Tile (or autotile piece) drawn straight from
+	 * the tileset or autotile bitmap, as the software
+	 * path has no atlas */
+	struct SoftTile
+	{
+		/* In map space */
+		IntRect pos;
+		/* Frame 0 source rect */
+		IntRect src;
+		/* Autotile index, -1 for the tileset */
+		int atInd;
+	};
+
+	/* Per priority scratch space for one map position */
+	std::vector<SoftTile> slotTiles[prioSlots];
+
+	/* Ground layer tiles followed by all zlayer tiles */
+	std::vector<SoftTile> softTiles;
 #endif // MKXPZ_RETRO
 
 	/* Base quad indices of each zlayer
-	 * in the shared buffer */
+	 * in the shared buffer (tile indices
+	 * into 'softTiles' for the software path) */
 	size_t zlayerBases[zlayersMax+1];
 
 	/* Shared buffers for all tiles */
@@ -308,6 +381,9 @@ struct TilemapPrivate
 #ifndef MKXPZ_RETRO
 		GLMeta::VAO vao;
 		VBO::ID vbo;
+
+		/* Quads the buffer has room for */
+		size_t allocQuads;
 #endif // MKXPZ_RETRO
 		bool animated;
 
@@ -334,6 +410,8 @@ struct TilemapPrivate
 	bool atlasDirty;
 	/* Affected by: mapData(.changed), priorities(.changed) */
 	bool buffersDirty;
+	/* Affected by: priorities(.changed), allocateAtlas, autotiles */
+	bool cellsStale;
 	/* Affected by: ox, oy */
 	bool mapViewportDirty;
 	/* Affected by: oy */
@@ -356,6 +434,17 @@ struct TilemapPrivate
 	/* Draw prepare call */
 	sigslot::connection prepareCon;
 
+#ifndef MKXPZ_RETRO
+	/* Builds the tile vertices off the RGSS thread */
+	struct BuffersJob : PrepareQueue::Job
+	{
+		TilemapPrivate *p;
+
+		void build() { p->buildQuadArray(); }
+		void submit() { p->finishBuffers(); }
+	} buffersJob;
+#endif // MKXPZ_RETRO
+
 	NormValue opacity;
 	BlendType blendType;
 	Color *color;
@@ -373,6 +462,7 @@ struct TilemapPrivate
 	      atlasSizeDirty(false),
 	      atlasDirty(false),
 	      buffersDirty(false),
+	      cellsStale(false),
 	      mapViewportDirty(false),
 	      zOrderDirty(false),
 	      tilemapReady(false),
@@ -393,6 +483,7 @@ struct TilemapPrivate
 #ifndef MKXPZ_RETRO
 		/* Init tile buffers */
 		tiles.vbo = VBO::gen();
+		tiles.allocQuads = 0;
 
 		GLMeta::vaoFillInVertexData<SVertex>(tiles.vao);
 		tiles.vao.vbo = tiles.vbo;
@@ -409,6 +500,16 @@ struct TilemapPrivate
 		prepareCon = shState->prepareDraw.connect
 		        (&TilemapPrivate::prepare, this);
 
+#ifndef MKXPZ_RETRO
+		buffersJob.p = this;
+
+		cells.resize(cellRingW * cellRingH);
+		cellsVersion = 0;
+		uploadBegin = uploadEnd = 0;
+#endif // MKXPZ_RETRO
+
+		memset(zlayerBases, 0, sizeof(zlayerBases));
+
 		updateFlashMapViewport();
 	}
 
@@ -457,15 +558,19 @@ struct TilemapPrivate
 		int tsH = tileset->height();
 		atlas.efTilesetH = tsH - (tsH % 32);
 
-#ifdef MKXPZ_RETRO
-		atlas.size = TileAtlas::minSize(atlas.efTilesetH, 2048); // TODO
-#else
+#ifndef MKXPZ_RETRO
 		atlas.size = TileAtlas::minSize(atlas.efTilesetH, glState.caps.maxTexSize);
-#endif // MKXPZ_RETRO
 
 		if (atlas.size.x < 0)
 			throw Exception(Exception::MKXPError,
 		                    "Cannot allocate big enough texture for tileset atlas");
+#else
+		/* Tiles are drawn from the tileset itself */
+		atlas.size = Vec2i(tilesetW, atlas.efTilesetH);
+#endif // MKXPZ_RETRO
+
+		/* Tileset texture coordinates depend on the atlas size */
+		invalidateCells();
 	}
 
 	void updateAutotileInfo()
@@ -503,6 +608,9 @@ struct TilemapPrivate
 		}
 
 		tiles.animated = !animatedATs.empty();
+
+		/* Small autotiles are laid out differently */
+		invalidateCells();
 	}
 
 	void updateSceneGeometry(const Scene::Geometry &geo)
@@ -540,6 +648,13 @@ struct TilemapPrivate
 		buffersDirty = true;
 	}
 
+	/* Changes the map data version doesn't cover */
+	void invalidateCells()
+	{
+		cellsStale = true;
+		buffersDirty = true;
+	}
+
 	/* Checks for the minimum amount of data needed to display */
 	bool verifyResources()
 	{
@@ -572,9 +687,9 @@ struct TilemapPrivate
         updateAutotileInfo();
         tileset->ensureNonAnimated();
 
+#ifndef MKXPZ_RETRO
 		TileAtlas::BlitVec blits = TileAtlas::calcBlits(atlas.efTilesetH, atlas.size);
 
-#ifndef MKXPZ_RETRO
 		/* Clear atlas */
 		FBO::bind(atlas.gl.fbo);
 		glState.clearColor.pushSet(Vec4());
@@ -780,13 +895,10 @@ struct TilemapPrivate
 				array->push_back(v[j]);
 		}
 	}
-#endif // MKXPZ_RETRO
 
-	void handleTile(int x, int y, int z)
+	/* Generates the quads of one tile at map position x/y */
+	void handleTile(int tileInd, int x, int y)
 	{
-		int tileInd =
-			tableGetWrapped(*mapData, x + viewpPos.x, y + viewpPos.y, z);
-
 		/* Check for empty space */
 		if (tileInd < 48)
 			return;
@@ -797,21 +909,7 @@ struct TilemapPrivate
 		if (prio == -1)
 			return;
 
-#ifndef MKXPZ_RETRO
-		SVVector *targetArray;
-
-		/* Prio 0 tiles are all part of the same ground layer */
-		if (prio == 0)
-		{
-			targetArray = &groundVert;
-		}
-		else
-		{
-			int layerInd = y + prio;
-			if ((size_t)layerInd >= zlayersMax)
-				return;
-			targetArray = &zlayerVert[layerInd];
-		}
+		SVVector *targetArray = &slotVert[prio];
 
 		/* Check for autotile */
 		if (tileInd < 48*8)
@@ -833,22 +931,224 @@ struct TilemapPrivate
 
 		for (size_t i = 0; i < 4; ++i)
 			targetArray->push_back(v[i]);
-#endif // MKXPZ_RETRO
 	}
 
-	void clearQuadArrays()
+	void buildCell(TileCell &cell)
 	{
-#ifndef MKXPZ_RETRO
-		groundVert.clear();
+		for (int i = 0; i < prioSlots; ++i)
+			slotVert[i].clear();
 
-		for (size_t i = 0; i < zlayersMax; ++i)
-			zlayerVert[i].clear();
-#endif // MKXPZ_RETRO
+		for (int z = 0; z < mapData->zSize(); ++z)
+			handleTile(mapData->at(cell.pos.x, cell.pos.y, z), cell.pos.x, cell.pos.y);
+
+		cell.vert.clear();
+
+		for (int i = 0; i < prioSlots; ++i)
+		{
+			cell.slotBases[i] = cell.vert.size() / 4;
+			cell.vert.insert(cell.vert.end(), slotVert[i].begin(), slotVert[i].end());
+		}
+
+		cell.slotBases[prioSlots] = cell.vert.size() / 4;
+		cell.valid = true;
+	}
+
+	/* Drops the cells whose map data changed since they were built */
+	void expireCells()
+	{
+		if (cellsStale)
+		{
+			for (size_t i = 0; i < cells.size(); ++i)
+				cells[i].valid = false;
+
+			cellsStale = false;
+		}
+		else if (mapData->version() != cellsVersion)
+		{
+			for (size_t i = 0; i < cells.size(); ++i)
+			{
+				TileCell &cell = cells[i];
+
+				if (!cell.valid)
+					continue;
+
+				if (cell.pos.x >= mapData->xSize() || cell.pos.y >= mapData->ySize() ||
+				    mapData->rowChanged(cell.pos.y, cellsVersion))
+					cell.valid = false;
+			}
+		}
+
+		cellsVersion = mapData->version();
+	}
+
+	/* Returns the cell of map position x/y, regenerating
+	 * it if it doesn't hold that position's tiles */
+	TileCell &updateCell(int x, int y)
+	{
+		TileCell &cell = cells[wrap(y, cellRingH) * cellRingW + wrap(x, cellRingW)];
+
+		if (!cell.valid || cell.pos != Vec2i(x, y))
+		{
+			cell.pos = Vec2i(x, y);
+			buildCell(cell);
+		}
+
+		return cell;
+	}
+
+	void appendSlot(const TileCell &cell, int prio)
+	{
+		SVVector::const_iterator begin = cell.vert.begin();
+
+		tileVert.insert(tileVert.end(),
+		                begin + cell.slotBases[prio] * 4,
+		                begin + cell.slotBases[prio+1] * 4);
+	}
+
+	bool quadUploaded(size_t quad) const
+	{
+		return memcmp(&tileVert[quad*4], &uploadedVert[quad*4], sizeof(SVertex) * 4) == 0;
+	}
+
+	/* Narrows the upload down to the quads that differ
+	 * from what the shared buffer already holds. Only an
+	 * unchanged head and tail are trimmed, so this mostly
+	 * pays off for map edits, not for scrolling */
+	void findUploadRange()
+	{
+		const size_t quadCount = tileVert.size() / 4;
+		const size_t uploadedCount = uploadedVert.size() / 4;
+
+		uploadBegin = 0;
+		uploadEnd = quadCount;
+
+		while (uploadBegin < std::min(quadCount, uploadedCount) && quadUploaded(uploadBegin))
+			++uploadBegin;
+
+		/* Past a size change, everything is shifted */
+		if (quadCount != uploadedCount)
+			return;
+
+		while (uploadEnd > uploadBegin && quadUploaded(uploadEnd-1))
+			--uploadEnd;
+	}
+#else
+	void handleAutotile(int x, int y, int tileInd, std::vector<SoftTile> &array)
+	{
+		/* Which autotile [0-7] */
+		int atInd = tileInd / 48 - 1;
+
+		SoftTile tile;
+		tile.atInd = atInd;
+
+		if (!atlas.smallATs[atInd])
+		{
+			/* Which tile pattern of the autotile [0-47] */
+			int subInd = tileInd % 48;
+
+			const StaticRect *pieceRect = &autotileRects[subInd*4];
+
+			/* Iterate over the 4 tile pieces */
+			for (int i = 0; i < 4; ++i)
+			{
+				FloatRect posRect(x*32, y*32, 16, 16);
+				atSelectSubPos(posRect, i);
+
+				tile.pos = IntRect(posRect.x, posRect.y, posRect.w, posRect.h);
+				tile.src = IntRect(pieceRect[i].x, pieceRect[i].y, pieceRect[i].w, pieceRect[i].h);
+				array.push_back(tile);
+			}
+		}
+		else
+		{
+			tile.pos = IntRect(x*32, y*32, 32, 32);
+			tile.src = IntRect(0, 0, 32, 32);
+			array.push_back(tile);
+		}
+	}
+
+	void handleTile(int tileInd, int x, int y)
+	{
+		/* Check for empty space */
+		if (tileInd < 48)
+			return;
+
+		int prio = samplePriority(tileInd);
+
+		/* Check for faulty data */
+		if (prio == -1)
+			return;
+
+		/* Check for autotile */
+		if (tileInd < 48*8)
+		{
+			handleAutotile(x, y, tileInd, slotTiles[prio]);
+			return;
+		}
+
+		int tsInd = tileInd - 48*8;
+		int tileX = tsInd % 8;
+		int tileY = tsInd / 8;
+
+		/* Past the usable part of the tileset */
+		if ((tileY + 1) * 32 > atlas.efTilesetH)
+			return;
+
+		SoftTile tile;
+		tile.pos = IntRect(x*32, y*32, 32, 32);
+		tile.src = IntRect(tileX*32, tileY*32, 32, 32);
+		tile.atInd = -1;
+
+		slotTiles[prio].push_back(tile);
+	}
+
+	/* Draws 'softTiles' [begin, end) */
+	void drawSoftTiles(size_t begin, size_t end)
+	{
+		if (nullOrDisposed(tileset))
+			return;
+
+		SoftRaster &raster = shState->softRaster();
+		const Vec2i trans = tilesPos();
+		const int aniFrame = tiles.aniIdx / atFrameDur;
+
+		SoftBlend blend;
+		blend.opacity = opacity;
+		blend.blendType = blendType;
+		blend.color = color->norm;
+		blend.tone = tone->norm;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const SoftTile &tile = softTiles[i];
+			const Bitmap *bitmap = tileset;
+			IntRect src = tile.src;
+
+			if (tile.atInd >= 0)
+			{
+				bitmap = autotiles[tile.atInd];
+
+				if (nullOrDisposed(bitmap))
+					continue;
+
+				/* Small autotiles hold one 32x32 tile per frame */
+				const int frames = std::max(atlas.nATFrames[tile.atInd], 1);
+				const int frameW = atlas.smallATs[tile.atInd] ? 32 : autotileW;
+
+				src.x += (aniFrame % frames) * frameW;
+			}
+
+			raster.draw(bitmap->getSoftSurface(), src,
+			            IntRect(tile.pos.pos() + trans, tile.pos.size()), blend);
+		}
 	}
+#endif // MKXPZ_RETRO
 
 	void buildQuadArray()
 	{
-		clearQuadArrays();
+#ifndef MKXPZ_RETRO
+		tileVert.clear();
+		memset(zlayerBases, 0, sizeof(zlayerBases));
 
 		int ox = viewpPos.x;
 		int oy = viewpPos.y;
@@ -871,21 +1171,101 @@ struct TilemapPrivate
 			maxY = mapH - oy - 1;
 
 		if ((minX > maxX) || (minY > maxY))
+		{
+			findUploadRange();
 			return;
+		}
+
+		expireCells();
+
+		/* Cells by viewport position */
+		TileCell *viewpCells[viewpW+1][viewpH+1];
+
+		for (int x = minX; x <= maxX; ++x)
+			for (int y = minY; y <= maxY; ++y)
+				viewpCells[x][y] = &updateCell(x + ox, y + oy);
+
+		/* Prio 0 tiles are all part of the same ground layer */
 		for (int x = minX; x <= maxX; ++x)
 			for (int y = minY; y <= maxY; ++y)
+				appendSlot(*viewpCells[x][y], 0);
+
+		/* Zlayer n holds the prio m tiles of row n-m */
+		for (size_t i = 0; i < zlayersMax; ++i)
+		{
+			zlayerBases[i] = tileVert.size() / 4;
+
+			for (int x = minX; x <= maxX; ++x)
+				for (int prio = prioSlots-1; prio > 0; --prio)
+				{
+					int y = (int) i - prio;
+
+					if (y >= minY && y <= maxY)
+						appendSlot(*viewpCells[x][y], prio);
+				}
+		}
+
+		zlayerBases[zlayersMax] = tileVert.size() / 4;
+
+		findUploadRange();
+#else
+		softTiles.clear();
+		memset(zlayerBases, 0, sizeof(zlayerBases));
+
+		int ox = viewpPos.x;
+		int oy = viewpPos.y;
+		int minX = std::max(0, -ox);
+		int minY = std::max(0, -oy);
+		int maxX = std::min(viewpW, mapData->xSize() - ox - 1);
+		int maxY = std::min(viewpH, mapData->ySize() - oy - 1);
+
+		if ((minX > maxX) || (minY > maxY))
+			return;
+
+		/* Tiles of each viewport row, split by priority */
+		std::vector<SoftTile> rowTiles[viewpH+1][prioSlots];
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int i = 0; i < prioSlots; ++i)
+				slotTiles[i].clear();
+
+			for (int x = minX; x <= maxX; ++x)
 				for (int z = 0; z < mapData->zSize(); ++z)
-					handleTile(x, y, z);
+					handleTile(mapData->at(x + ox, y + oy, z), x + ox, y + oy);
+
+			for (int i = 0; i < prioSlots; ++i)
+				rowTiles[y][i].swap(slotTiles[i]);
+		}
+
+		/* Prio 0 tiles are all part of the same ground layer */
+		for (int y = minY; y <= maxY; ++y)
+			softTiles.insert(softTiles.end(), rowTiles[y][0].begin(), rowTiles[y][0].end());
+
+		/* Zlayer n holds the prio m tiles of row n-m */
+		for (size_t i = 0; i < zlayersMax; ++i)
+		{
+			zlayerBases[i] = softTiles.size();
+
+			for (int prio = prioSlots-1; prio > 0; --prio)
+			{
+				int y = (int) i - prio;
+
+				if (y >= minY && y <= maxY)
+					softTiles.insert(softTiles.end(), rowTiles[y][prio].begin(), rowTiles[y][prio].end());
+			}
+		}
+
+		zlayerBases[zlayersMax] = softTiles.size();
+#endif // MKXPZ_RETRO
 	}
 
+#ifndef MKXPZ_RETRO
 	static size_t quadDataSize(size_t quadCount)
 	{
-#ifdef MKXPZ_RETRO
-		return 0; // TODO
-#else
 		return quadCount * sizeof(SVertex) * 4;
-#endif
 	}
+#endif // MKXPZ_RETRO
 
 	size_t zlayerSize(size_t index)
 	{
@@ -895,34 +1275,29 @@ struct TilemapPrivate
 	void uploadBuffers()
 	{
 #ifndef MKXPZ_RETRO
-		/* Calculate total quad count */
-		size_t groundQuadCount = groundVert.size() / 4;
-		size_t quadCount = groundQuadCount;
-
-		for (size_t i = 0; i < zlayersMax; ++i)
-		{
-			zlayerBases[i] = quadCount;
-			quadCount += zlayerVert[i].size() / 4;
-		}
-
-		zlayerBases[zlayersMax] = quadCount;
+		size_t quadCount = zlayerBases[zlayersMax];
 
 		VBO::bind(tiles.vbo);
-		VBO::allocEmpty(quadDataSize(quadCount));
-
-		VBO::uploadSubData(0, quadDataSize(groundQuadCount), dataPtr(groundVert));
 
-		for (size_t i = 0; i < zlayersMax; ++i)
+		/* Grow only, like TilemapVX; anything beyond
+		 * 'quadCount' is never drawn */
+		if (quadCount > tiles.allocQuads)
 		{
-			if (zlayerVert[i].empty())
-				continue;
+			VBO::allocEmpty(quadDataSize(quadCount), GL_DYNAMIC_DRAW);
+			tiles.allocQuads = quadCount;
 
-			VBO::uploadSubData(quadDataSize(zlayerBases[i]),
-			                   quadDataSize(zlayerSize(i)), dataPtr(zlayerVert[i]));
+			uploadBegin = 0;
+			uploadEnd = quadCount;
 		}
 
+		if (uploadEnd > uploadBegin)
+			VBO::uploadSubData(quadDataSize(uploadBegin), quadDataSize(uploadEnd - uploadBegin),
+			                   &tileVert[uploadBegin*4]);
+
 		VBO::unbind();
 
+		uploadedVert.swap(tileVert);
+
 		/* Ensure global IBO size */
 		shState->ensureQuadIBO(quadCount);
 #endif // MKXPZ_RETRO
@@ -945,7 +1320,7 @@ struct TilemapPrivate
 		}
 		else
 		{
-			shaderVar = &shState->shaders().simple;
+			shaderVar = &shState->shaders().simple.get();
 			shaderVar->bind();
 		}
 
@@ -986,11 +1361,9 @@ struct TilemapPrivate
 		/* Only allocate elements for non-emtpy zlayers */
 		std::vector<int> zlayerInd;
 
-#ifndef MKXPZ_RETRO
 		for (size_t i = 0; i < zlayersMax; ++i)
-			if (zlayerVert[i].size() > 0)
+			if (zlayerSize(i) > 0)
 				zlayerInd.push_back(i);
-#endif // MKXPZ_RETRO
 
 		updateActiveElements(zlayerInd);
 		elem.activeLayers = zlayerInd.size();
@@ -1037,6 +1410,14 @@ struct TilemapPrivate
 	{
 		ZLayer *const *zlayers = elem.zlayers;
 
+#ifndef MKXPZ_RETRO
+		/* Sprites moved since the last frame are only put in
+		 * their new place by the scene's composite, which runs
+		 * after us; the walk below needs that place already */
+		if (elem.activeLayers > 0 && zlayers[0]->scene)
+			zlayers[0]->scene->sortPending();
+#endif // MKXPZ_RETRO
+
 		for (size_t i = 0; i < elem.activeLayers; ++i)
 		{
 			ZLayer *batchHead = zlayers[i];
@@ -1082,6 +1463,12 @@ struct TilemapPrivate
 		dispPos = elem.sceneGeo.rect.pos() - wrap(combOrigin, 32);
 	}
 
+	/* Translation of the map space tile vertices */
+	Vec2i tilesPos() const
+	{
+		return dispPos - viewpPos * 32;
+	}
+
 	void prepare()
 	{
 		if (!verifyResources())
@@ -1113,12 +1500,32 @@ struct TilemapPrivate
 
 		if (buffersDirty)
 		{
-			buildQuadArray();
-			uploadBuffers();
-			updateSceneElements();
 			buffersDirty = false;
+
+#ifndef MKXPZ_RETRO
+			/* Everything past this point depends on the new
+			 * buffers and is picked up again in the submit step */
+			shState->prepareQueue().push(&buffersJob);
+#else
+			buildQuadArray();
+			finishBuffers();
+#endif // MKXPZ_RETRO
+			return;
 		}
 
+		finishPrepare();
+	}
+
+	void finishBuffers()
+	{
+		uploadBuffers();
+		updateSceneElements();
+
+		finishPrepare();
+	}
+
+	void finishPrepare()
+	{
 		flashMap.prepare();
 
 		if (zOrderDirty)
@@ -1152,13 +1559,13 @@ void GroundLayer::updateVboCount()
 
 void GroundLayer::draw()
 {
-#ifndef MKXPZ_RETRO
-	if (p->groundVert.size() == 0)
+	if (p->zlayerBases[0] == 0)
 		return;
 
 	if (!p->opacity)
 		return;
 
+#ifndef MKXPZ_RETRO
 	ShaderBase *shader;
 
 	p->bindShader(shader);
@@ -1168,7 +1575,7 @@ void GroundLayer::draw()
 
 	GLMeta::vaoBind(p->tiles.vao);
 
-	shader->setTranslation(p->dispPos);
+	shader->setTranslation(p->tilesPos());
 	drawInt();
 
 	GLMeta::vaoUnbind(p->tiles.vao);
@@ -1176,6 +1583,10 @@ void GroundLayer::draw()
 	p->flashMap.draw(flashAlpha[p->flashAlphaIdx] / 255.f, p->dispPos);
 
 	glState.blendMode.pop();
+#else
+	p->drawSoftTiles(0, p->zlayerBases[0]);
+
+	p->flashMap.draw(flashAlpha[p->flashAlphaIdx] / 255.f, p->dispPos);
 #endif // MKXPZ_RETRO
 }
 
@@ -1194,7 +1605,9 @@ void GroundLayer::onGeometryChange(const Scene::Geometry &geo)
 ZLayer::ZLayer(TilemapPrivate *p, Viewport *viewport)
     : ViewportElement(viewport, 0),
 #ifdef MKXPZ_RETRO
-      index(0)
+      index(0),
+      p(p),
+      batchedFlag(false)
 #else
       index(0),
       vboOffset(0),
@@ -1222,22 +1635,24 @@ void ZLayer::draw()
 	if (batchedFlag)
 		return;
 
+#ifndef MKXPZ_RETRO
 	ShaderBase *shader;
 
 	p->bindShader(shader);
 	p->bindAtlas(*shader);
 
-#ifndef MKXPZ_RETRO
 	glState.blendMode.pushSet(p->blendType);
 
 	GLMeta::vaoBind(p->tiles.vao);
 
-	shader->setTranslation(p->dispPos);
+	shader->setTranslation(p->tilesPos());
 	drawInt();
 
 	GLMeta::vaoUnbind(p->tiles.vao);
 
 	glState.blendMode.pop();
+#else
+	p->drawSoftTiles(p->zlayerBases[index], p->zlayerBases[index+1]);
 #endif // MKXPZ_RETRO
 }
 
@@ -1402,7 +1817,7 @@ void Tilemap::setMapData(Table *value)
 	if (!value)
 		return;
 
-	p->invalidateBuffers();
+	p->invalidateCells();
 	p->mapDataCon.disconnect();
 	p->mapDataCon = value->modified.connect
 	        (&TilemapPrivate::invalidateBuffers, p);
@@ -1427,10 +1842,10 @@ void Tilemap::setPriorities(Table *value)
 	if (!value)
 		return;
 
-	p->invalidateBuffers();
+	p->invalidateCells();
 	p->prioritiesCon.disconnect();
 	p->prioritiesCon = value->modified.connect
-	        (&TilemapPrivate::invalidateBuffers, p);
+	        (&TilemapPrivate::invalidateCells, p);
 }
 
 void Tilemap::setVisible(bool value)
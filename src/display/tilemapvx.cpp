@@ -35,6 +35,7 @@
 #include "quad.h"
 #include "quadarray.h"
 #include "shader.h"
+#include "preparequeue.h"
 #include "tilemap-common.h"
 
 #include <vector>
@@ -70,6 +71,38 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	std::vector<SVertex> groundVert;
 	std::vector<SVertex> aboveVert;
 
+	/* Quads of one map row, by read pass,
+	 * below and above the player */
+	struct TileRow
+	{
+		/* Map row the quads were read for (not wrapped) */
+		int y;
+		bool valid;
+
+		std::vector<SVertex> vert[TileAtlasVX::ReadPassCount][2];
+
+		TileRow()
+		    : y(0), valid(false)
+		{}
+	};
+
+	/* Rows of the map viewport, indexed by map row modulo
+	 * its height. Quads are in map rows, so rows stay valid
+	 * across vertical scrolling */
+	std::vector<TileRow> rows;
+
+	/* Map data version the rows are up to date with */
+	uint64_t rowsVersion;
+
+	/* Map viewport the rows were read for */
+	IntRect rowsRect;
+
+	/* Affected by: mapData, flags(.changed) */
+	bool rowsStale;
+
+	/* Where read quads go, below and above the player */
+	std::vector<SVertex> *readTarget;
+
 	TEXFBO atlas;
 	VBO::ID vbo;
 	GLMeta::VAO vao;
@@ -118,10 +151,22 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 
 	AboveLayer above;
 
+	/* Reads the tiles off the RGSS thread */
+	struct BuffersJob : PrepareQueue::Job
+	{
+		TilemapVXPrivate *p;
+
+		void build() { p->readBuffers(); }
+		void submit() { p->uploadBuffers(); }
+	} buffersJob;
+
 	TilemapVXPrivate(Viewport *viewport)
 	    : ViewportElement(viewport),
 	      mapData(0),
 	      flags(0),
+	      rowsVersion(0),
+	      rowsStale(true),
+	      readTarget(0),
 	      allocQuads(0),
 	      groundQuads(0),
 	      aboveQuads(0),
@@ -155,6 +200,8 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 
 		prepareCon = shState->prepareDraw.connect
 			(&TilemapVXPrivate::prepare, this);
+
+		buffersJob.p = this;
 	}
 
 	virtual ~TilemapVXPrivate()
@@ -197,6 +244,12 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		buffersDirty = true;
 	}
 
+	void invalidateRows()
+	{
+		rowsStale = true;
+		buffersDirty = true;
+	}
+
 	void rebuildAtlas()
 	{
 		TileAtlasVX::build(atlas, bitmaps);
@@ -251,17 +304,96 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		return quads * 4 * sizeof(SVertex);
 	}
 
-	void rebuildBuffers()
+	TileRow &rowAt(int y)
 	{
-		if (!mapData)
+		return rows[wrap(y, rows.size())];
+	}
+
+	/* Drops the rows whose map data changed since they were read */
+	void expireRows()
+	{
+		const IntRect &mvp = mapViewp;
+
+		/* Rows span the whole viewport width */
+		if (rowsStale || rows.size() != (size_t) mvp.h ||
+		    rowsRect.x != mvp.x || rowsRect.w != mvp.w)
+		{
+			rows.resize(mvp.h);
+
+			for (size_t i = 0; i < rows.size(); ++i)
+				rows[i].valid = false;
+
+			rowsRect = mvp;
+			rowsStale = false;
+		}
+		else if (mapData->version() != rowsVersion)
+		{
+			for (size_t i = 0; i < rows.size(); ++i)
+				if (rows[i].valid &&
+				    mapData->rowChanged(wrap(rows[i].y, mapData->ySize()), rowsVersion))
+					rows[i].valid = false;
+		}
+
+		rowsVersion = mapData->version();
+	}
+
+	void updateRow(int y)
+	{
+		TileRow &row = rowAt(y);
+
+		if (row.valid && row.y == y)
 			return;
 
+		for (int pass = 0; pass < TileAtlasVX::ReadPassCount; ++pass)
+		{
+			readTarget = row.vert[pass];
+			readTarget[0].clear();
+			readTarget[1].clear();
+
+			TileAtlasVX::readRow(*this, *mapData, flags, pass,
+			                     mapViewp.x, mapViewp.w, y, y);
+		}
+
+		row.y = y;
+		row.valid = true;
+	}
+
+	void readBuffers()
+	{
 		groundVert.clear();
 		aboveVert.clear();
 
-		TileAtlasVX::readTiles(*this, *mapData, flags,
-		                       mapViewp.x, mapViewp.y, mapViewp.w, mapViewp.h);
+		if (mapViewp.h <= 0)
+			return;
+
+		expireRows();
 
+		for (int i = 0; i < mapViewp.h; ++i)
+			updateRow(mapViewp.y + i);
+
+		for (int pass = 0; pass < TileAtlasVX::ReadPassCount; ++pass)
+		{
+			bool upward = TileAtlasVX::passReadsUpward(pass);
+
+			for (int i = 0; i < mapViewp.h; ++i)
+			{
+				const TileRow &row = rowAt(mapViewp.y + (upward ? mapViewp.h-1 - i : i));
+				const std::vector<SVertex> *vert = row.vert[pass];
+
+				groundVert.insert(groundVert.end(), vert[0].begin(), vert[0].end());
+				aboveVert.insert(aboveVert.end(), vert[1].begin(), vert[1].end());
+			}
+		}
+	}
+
+	/* Translation of the row based tile vertices */
+	Vec2i tilesPos() const
+	{
+		return dispPos - Vec2i(0, mapViewp.y * 32);
+	}
+
+	void uploadBuffers()
+	{
 		groundQuads = groundVert.size() / 4;
 		aboveQuads = aboveVert.size() / 4;
 		size_t totalQuads = groundQuads + aboveQuads;
@@ -301,7 +433,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 
 		if (buffersDirty)
 		{
-			rebuildBuffers();
+			shState->prepareQueue().push(&buffersJob);
 			buffersDirty = false;
 		}
 
@@ -342,13 +474,13 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		else
 		{
 			/* Static tileset */
-			shader = &shState->shaders().simple;
+			shader = &shState->shaders().simple.get();
 			shader->bind();
 		}
 
 		shader->setTexSize(Vec2i(atlas.width, atlas.height));
 		shader->applyViewportProj();
-		shader->setTranslation(dispPos);
+		shader->setTranslation(tilesPos());
 
 		if (atlas.selfHires != nullptr) {
 			TEX::bind(atlas.selfHires->tex);
@@ -372,7 +504,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		shader.bind();
 		shader.setTexSize(Vec2i(atlas.width, atlas.height));
 		shader.applyViewportProj();
-		shader.setTranslation(dispPos);
+		shader.setTranslation(tilesPos());
 
 		if (atlas.selfHires != nullptr) {
 			TEX::bind(atlas.selfHires->tex);
@@ -410,7 +542,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	void onQuads(const FloatRect *t, const FloatRect *p,
 	             size_t n, bool overPlayer)
 	{
-		SVertex *vert = allocVert(overPlayer ? aboveVert : groundVert, n*4);
+		SVertex *vert = allocVert(readTarget[overPlayer ? 1 : 0], n*4);
 
 		for (size_t i = 0; i < n; ++i)
 			Quad::setTexPosRect(&vert[i*4], t[i], p[i]);
@@ -534,7 +666,7 @@ void TilemapVX::setMapData(Table *value)
 		return;
 
 	p->mapData = value;
-	p->buffersDirty = true;
+	p->invalidateRows();
 
 	p->mapDataCon.disconnect();
 	p->mapDataCon = value->modified.connect
@@ -556,11 +688,11 @@ void TilemapVX::setFlags(Table *value)
 		return;
 
 	p->flags = value;
-	p->buffersDirty = true;
+	p->invalidateRows();
 
 	p->flagsCon.disconnect();
 	p->flagsCon = value->modified.connect
-		(&TilemapVXPrivate::invalidateBuffers, p);
+		(&TilemapVXPrivate::invalidateRows, p);
 }
 
 void TilemapVX::setVisible(bool value)
@@ -24,7 +24,9 @@
 #include "sharedstate.h"
 #include "etc.h"
 #include "util.h"
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+#include "softraster.h"
+#else
 #include "quad.h"
 #include "glstate.h"
 #endif // MKXPZ_RETRO
@@ -114,7 +116,8 @@ Viewport::Viewport()
       sceneLink(this)
 {
 #ifdef MKXPZ_RETRO
-	initViewport(0, 0, 640, 480); // TODO: use the actual viewport size
+	const IntRect &screenRect = scene->getGeometry().rect;
+	initViewport(0, 0, screenRect.w, screenRect.h);
 #else
 	const Graphics &graphics = shState->graphics();
 	initViewport(0, 0, graphics.width(), graphics.height());
@@ -193,7 +196,10 @@ void Viewport::composite()
 	if (elements.getSize() == 0 && !renderEffect)
 		return;
 
-#ifndef MKXPZ_RETRO
+#ifdef MKXPZ_RETRO
+	SoftRaster &raster = shState->softRaster();
+	raster.pushClip(p->rect->toIntRect());
+#else
 	/* Setup scissor */
 	glState.scissorTest.pushSet(true);
 	glState.scissorBox.pushSet(p->rect->toIntRect());
@@ -204,10 +210,25 @@ void Viewport::composite()
 	/* If any effects are visible, request parent Scene to
 	 * render them. */
 	if (renderEffect)
+#ifdef MKXPZ_RETRO
+	{
+		/* There's no parent render pass in the core,
+		 * so apply them to the frame directly */
+		SoftBlend blend;
+		blend.color = p->color->norm;
+		blend.tone = p->tone->norm;
+
+		raster.applyEffect(raster.clip(), blend);
+
+		if (flashing)
+			raster.fillBlend(raster.clip(), flashColor);
+	}
+
+	raster.popClip();
+#else
 		scene->requestViewportRender
 		        (p->color->norm, flashColor, p->tone->norm);
 
-#ifndef MKXPZ_RETRO
 	glState.scissorBox.pop();
 	glState.scissorTest.pop();
 #endif // MKXPZ_RETRO
@@ -219,6 +240,14 @@ void Viewport::draw()
 	composite();
 }
 
+bool Viewport::getBounds(IntRect &bounds) const
+{
+	/* Nothing escapes the scissor box */
+	bounds = p->rect->toIntRect();
+
+	return true;
+}
+
 void Viewport::onGeometryChange(const Geometry &geo)
 {
 	p->screenRect = geo.rect;
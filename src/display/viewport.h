@@ -53,6 +53,7 @@ private:
 
 	void composite();
 	void draw();
+	bool getBounds(IntRect &bounds) const;
 	void onGeometryChange(const Geometry &);
 	bool isEffectiveViewport(Rect *&, Color *&, Tone *&) const;
 
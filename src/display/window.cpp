@@ -34,6 +34,8 @@
 #include "quadarray.h"
 #include "texpool.h"
 #include "glstate.h"
+#else
+#include "softraster.h"
 #endif // MKXPZ_RETRO
 
 #include "sigslot/signal.hpp"
@@ -139,6 +141,31 @@ struct QuadChunk
 			vert[i].color.w = value;
 	}
 };
+#else
+/* Splits 'rect' into the nine parts of a frame with 2 pixel
+ * borders, in the order TileQuads::buildFrame() emits them */
+static void softFrameParts(const IntRect &rect, IntRect parts[9])
+{
+	const int w  = rect.w; const int h  = rect.h;
+	const int x1 = rect.x; const int x2 = x1 + w;
+	const int y1 = rect.y; const int y2 = y1 + h;
+
+	int i = 0;
+	/* Corners - tl, tr, br, bl */
+	parts[i++] = IntRect(x1,   y1,   2, 2);
+	parts[i++] = IntRect(x2-2, y1,   2, 2);
+	parts[i++] = IntRect(x2-2, y2-2, 2, 2);
+	parts[i++] = IntRect(x1,   y2-2, 2, 2);
+
+	/* Sides - l, r, t, b */
+	parts[i++] = IntRect(x1,   y1+2, 2,   h-4);
+	parts[i++] = IntRect(x2-2, y1+2, 2,   h-4);
+	parts[i++] = IntRect(x1+2, y1,   w-4, 2);
+	parts[i++] = IntRect(x1+2, y2-2, w-4, 2);
+
+	/* Center */
+	parts[i++] = IntRect(x1+2, y1+2, w-4, h-4);
+}
 #endif // MKXPZ_RETRO
 
 /* Vocabulary:
@@ -620,6 +647,48 @@ struct WindowPrivate
 
 			TEX::setSmooth(false);
 		}
+#else
+		SoftRaster &raster = shState->softRaster();
+		const SoftSurface &skin = windowskin->getSoftSurface();
+		const Vec2i efPos = position + sceneOffset;
+
+		SoftBlend blend;
+		blend.opacity = backOpacity * opacity / 255;
+
+		/* Background, always stretched in the software path */
+		raster.draw(skin, backgroundSrc,
+		            IntRect(efPos + Vec2i(2), size - Vec2i(4)), blend);
+
+		blend.opacity = opacity;
+
+		/* Borders, repeating the 32 pixel skin tiles */
+		const IntRect horiz(efPos.x + 16, efPos.y, size.x - 32, size.y);
+		const IntRect vert(efPos.x, efPos.y + 16, size.x, size.y - 32);
+
+		raster.pushClip(horiz);
+		for (int x = horiz.x; x < horiz.x + horiz.w; x += 32)
+		{
+			raster.draw(skin, bordersSrc.t, IntRect(x, efPos.y, 32, 16), blend);
+			raster.draw(skin, bordersSrc.b, IntRect(x, efPos.y + size.y - 16, 32, 16), blend);
+		}
+		raster.popClip();
+
+		raster.pushClip(vert);
+		for (int y = vert.y; y < vert.y + vert.h; y += 32)
+		{
+			raster.draw(skin, bordersSrc.l, IntRect(efPos.x, y, 16, 32), blend);
+			raster.draw(skin, bordersSrc.r, IntRect(efPos.x + size.x - 16, y, 16, 32), blend);
+		}
+		raster.popClip();
+
+		/* Corners */
+		const int r = efPos.x + size.x - 16;
+		const int b = efPos.y + size.y - 16;
+
+		raster.draw(skin, cornersSrc.tl, IntRect(efPos.x, efPos.y, 16, 16), blend);
+		raster.draw(skin, cornersSrc.tr, IntRect(r, efPos.y, 16, 16), blend);
+		raster.draw(skin, cornersSrc.bl, IntRect(efPos.x, b, 16, 16), blend);
+		raster.draw(skin, cornersSrc.br, IntRect(r, b, 16, 16), blend);
 #endif // MKXPZ_RETRO
 	}
 
@@ -679,9 +748,94 @@ struct WindowPrivate
 
 		glState.scissorBox.pop();
 		glState.scissorTest.pop();
+#else
+		SoftRaster &raster = shState->softRaster();
+		raster.pushClip(windowRect);
+
+		if (!nullOrDisposed(windowskin))
+			drawSoftControls(efPos);
+
+		if (!nullOrDisposed(contents))
+		{
+			const SoftSurface &surf = contents->getSoftSurface();
+
+			SoftBlend blend;
+			blend.opacity = contentsOpacity;
+
+			raster.pushClip(contentsRect);
+
+			raster.draw(surf, surf.rect(),
+			            IntRect(efPos + (Vec2i(16) - contentsOffset),
+			                    Vec2i(surf.width, surf.height)), blend);
+
+			raster.popClip();
+		}
+
+		raster.popClip();
 #endif // MKXPZ_RETRO
 	}
 
+#ifdef MKXPZ_RETRO
+	/* Cursor, scroll arrows and pause animation, placed
+	 * like the quads built in buildControlsVert() */
+	void drawSoftControls(const Vec2i &efPos)
+	{
+		SoftRaster &raster = shState->softRaster();
+		const SoftSurface &skin = windowskin->getSoftSurface();
+
+		SoftBlend blend;
+
+		if (!cursorRect->isEmpty())
+		{
+			/* Effective cursor rect has 16 xy offset to window */
+			IntRect effectRect(efPos.x + cursorRect->x + 16, efPos.y + cursorRect->y + 16,
+			                   cursorRect->width, cursorRect->height);
+
+			IntRect srcParts[9], destParts[9];
+			softFrameParts(cursorSrc, srcParts);
+			softFrameParts(effectRect, destParts);
+
+			blend.opacity = active ? cursorAniAlpha[cursorAniAlphaIdx] : 255;
+
+			for (int i = 0; i < 9; ++i)
+				raster.draw(skin, srcParts[i], destParts[i], blend);
+		}
+
+		blend.opacity = 255;
+
+		/* Scroll arrow position: Top Bottom X, Left Right Y */
+		const Vec2i scroll = efPos + (size - Vec2i(16)) / 2;
+
+		if (!nullOrDisposed(contents))
+		{
+			if (contentsOffset.x > 0)
+				raster.draw(skin, scrollArrowSrc.l,
+				            IntRect(efPos.x + 4, scroll.y, 8, 16), blend);
+
+			if (contentsOffset.y > 0)
+				raster.draw(skin, scrollArrowSrc.t,
+				            IntRect(scroll.x, efPos.y + 4, 16, 8), blend);
+
+			if ((size.x - 32) < (contents->width() - contentsOffset.x))
+				raster.draw(skin, scrollArrowSrc.r,
+				            IntRect(efPos.x + size.x - 12, scroll.y, 8, 16), blend);
+
+			if ((size.y - 32) < (contents->height() - contentsOffset.y))
+				raster.draw(skin, scrollArrowSrc.b,
+				            IntRect(scroll.x, efPos.y + size.y - 12, 16, 8), blend);
+		}
+
+		if (pause)
+		{
+			blend.opacity = pauseAniAlpha[pauseAniAlphaIdx];
+
+			raster.draw(skin, pauseAniSrc[pauseAniQuad[pauseAniQuadIdx]],
+			            IntRect(efPos.x + (size.x - 16) / 2, efPos.y + size.y - 16, 16, 16),
+			            blend);
+		}
+	}
+#endif // MKXPZ_RETRO
+
 	void updateControls()
 	{
 #ifndef MKXPZ_RETRO
@@ -936,6 +1090,14 @@ void Window::draw()
 	p->drawBase();
 }
 
+bool Window::getBounds(IntRect &bounds) const
+{
+	/* Contents and controls are drawn by 'controlsElement' */
+	bounds = IntRect(p->position + p->sceneOffset, p->size);
+
+	return true;
+}
+
 void Window::onGeometryChange(const Scene::Geometry &geo)
 {
 	p->sceneOffset = geo.offset();
@@ -65,6 +65,7 @@ private:
 	WindowPrivate *p;
 
 	void draw();
+	bool getBounds(IntRect &bounds) const;
 	void onGeometryChange(const Scene::Geometry &);
 
 	void onViewportChange();
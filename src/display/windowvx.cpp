@@ -457,7 +457,7 @@ struct WindowVXPrivate
 		}
 		else
 		{
-			shader = &shState->shaders().simple;
+			shader = &shState->shaders().simple.get();
 			shader->bind();
 		}
 
@@ -479,9 +479,9 @@ struct WindowVXPrivate
 		glState.blendMode.set(BlendNormal);
 
 		/* If we used plane shader before, switch to simple */
-		if (shader != &shState->shaders().simple)
+		if (shader != &shState->shaders().simple.get())
 		{
-			shader = &shState->shaders().simple;
+			shader = &shState->shaders().simple.get();
 			shader->bind();
 			shader->setTranslation(Vec2i());
 			shader->applyViewportProj();
@@ -1136,6 +1136,13 @@ void WindowVX::draw()
 	p->draw();
 }
 
+bool WindowVX::getBounds(IntRect &bounds) const
+{
+	bounds = IntRect(p->geo.pos() + p->sceneOffset, p->geo.size());
+
+	return true;
+}
+
 void WindowVX::onGeometryChange(const Scene::Geometry &geo)
 {
 	p->sceneOffset = geo.offset();
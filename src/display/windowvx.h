@@ -72,6 +72,7 @@ private:
 	WindowVXPrivate *p;
 
 	void draw();
+	bool getBounds(IntRect &bounds) const;
 	void onGeometryChange(const Scene::Geometry &);
 
 	void releaseResources();
@@ -220,6 +220,14 @@ struct IntRect : SDL_Rect
 		        x+w >= o.x+o.w &&
 		        y+h >= o.y+o.h);
 	}
+
+	bool intersects(const IntRect &o) const
+	{
+		return (x < o.x+o.w &&
+		        o.x < x+w   &&
+		        y < o.y+o.h &&
+		        o.y < y+h);
+	}
 };
 
 struct StaticRect { float x, y, w, h; };
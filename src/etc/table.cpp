@@ -22,6 +22,7 @@
 #include "table.h"
 
 #include <string.h>
+#include <limits.h>
 #include <algorithm>
 
 #include "serial-util.h"
@@ -31,12 +32,16 @@
 /* Init normally */
 Table::Table(int x, int y /*= 1*/, int z /*= 1*/)
     : xs(x), ys(y), zs(z),
-      data(x*y*z)
+      data(x*y*z),
+      curVersion(0),
+      rowVersions(y)
 {}
 
 Table::Table(const Table &other)
     : xs(other.xs), ys(other.ys), zs(other.zs),
-      data(other.data)
+      data(other.data),
+      curVersion(other.curVersion),
+      rowVersions(other.rowVersions)
 {}
 
 int16_t Table::get(int x, int y, int z) const
@@ -54,6 +59,7 @@ void Table::set(int16_t value, int x, int y, int z)
 	}
 
 	data[xs*ys*z + xs*y + x] = value;
+	rowVersions[y] = ++curVersion;
 
 	modified();
 }
@@ -76,6 +82,9 @@ void Table::resize(int x, int y, int z)
 	ys = y;
 	zs = z;
 
+	/* Cell coordinates have shifted, so every row counts as changed */
+	rowVersions.assign(y, ++curVersion);
+
 	return;
 }
 
@@ -89,6 +98,82 @@ void Table::resize(int x)
 	resize(x, ys, zs);
 }
 
+void Table::fill(int16_t value)
+{
+	std::fill(data.begin(), data.end(), value);
+	rowVersions.assign(ys, ++curVersion);
+
+	modified();
+}
+
+/* Shrinks the 'len' cells starting at 'src' and 'dst' to
+ * those within both [0, srcSize) and [0, dstSize) */
+static void clipSpan(int &src, int &dst, int &len, int srcSize, int dstSize)
+{
+	int skip = std::max(0, std::max(-src, -dst));
+
+	src += skip;
+	dst += skip;
+	len -= skip;
+
+	len = std::min(len, std::min(srcSize - src, dstSize - dst));
+}
+
+void Table::copyRect(const Table &src, int srcX, int srcY,
+                     int w, int h, int dstX, int dstY)
+{
+	clipSpan(srcX, dstX, w, src.xs, xs);
+	clipSpan(srcY, dstY, h, src.ys, ys);
+
+	if (w <= 0 || h <= 0)
+		return;
+
+	const int layers = std::min(zs, src.zs);
+
+	/* Copying within one table, rows must not be
+	 * overwritten before they have been read */
+	const bool upward = (&src == this && dstY > srcY);
+
+	for (int k = 0; k < layers; ++k)
+		for (int j = 0; j < h; ++j)
+		{
+			int row = upward ? h - 1 - j : j;
+
+			memmove(&at(dstX, dstY + row, k), &src.at(srcX, srcY + row, k),
+			        sizeof(int16_t) * w);
+		}
+
+	++curVersion;
+
+	for (int j = 0; j < h; ++j)
+		rowVersions[dstY + j] = curVersion;
+
+	modified();
+}
+
+int Table::rawSize() const
+{
+	return xs * ys * zs * sizeof(int16_t);
+}
+
+void Table::getRaw(void *output) const
+{
+	memcpy(output, dataPtr(data), rawSize());
+}
+
+void Table::replaceRaw(const void *input, int size)
+{
+	if (size != rawSize())
+		throw Exception(Exception::ArgumentError,
+		                "Replacement table data has the wrong size (given %i bytes, need %i)",
+		                size, rawSize());
+
+	memcpy(dataPtr(data), input, size);
+	rowVersions.assign(ys, ++curVersion);
+
+	modified();
+}
+
 /* Serializable */
 int Table::serialSize() const
 {
@@ -115,7 +200,7 @@ void Table::serialize(char *buffer) const
 	writeInt32(&buffer, zs);
 	writeInt32(&buffer, size);
 
-	memcpy(buffer, dataPtr(data), sizeof(int16_t)*size);
+	writeInt16Array(&buffer, dataPtr(data), size);
 }
 
 
@@ -130,14 +215,24 @@ Table *Table::deserialize(const char *data, int len)
 	int z = readInt32(&data);
 	int size = readInt32(&data);
 
-	if (size != x*y*z)
+	if (x < 0 || y < 0 || z < 0)
+		throw Exception(Exception::RGSSError, "Marshal: Table: bad file format");
+
+	/* Each factor is checked before multiplying, so that corrupted
+	 * dimensions can't overflow their way past the size check */
+	if ((y != 0 && x > INT_MAX / y) || (z != 0 && x*y > INT_MAX / z))
+		throw Exception(Exception::RGSSError, "Marshal: Table: bad file format");
+
+	int cells = x*y*z;
+
+	if (size != cells)
 		throw Exception(Exception::RGSSError, "Marshal: Table: bad file format");
 
-	if (len != 20 + x*y*z*2)
+	if (len != 20 + (int64_t) cells*2)
 		throw Exception(Exception::RGSSError, "Marshal: Table: bad file format");
 
 	Table *t = new Table(x, y, z);
-	memcpy(dataPtr(t->data), data, sizeof(int16_t)*size);
+	readInt16Array(&data, dataPtr(t->data), size);
 
 	return t;
 }
@@ -47,6 +47,36 @@ public:
 	void resize(int x, int y);
 	void resize(int x);
 
+	/* Bulk operations, so scripts don't have to
+	 * go through [] and []= for every cell */
+	void fill(int16_t value);
+
+	/* Copies the 'w' x 'h' cells at 'srcX', 'srcY' of 'src'
+	 * (which may be this table) to 'dstX', 'dstY', on every
+	 * layer both tables have. Cells falling outside of
+	 * either table are skipped */
+	void copyRect(const Table &src, int srcX, int srcY,
+	              int w, int h, int dstX, int dstY);
+
+	/* All cells as native endian int16 values,
+	 * x varying fastest, then y, then z */
+	int rawSize() const;
+	void getRaw(void *output) const;
+	void replaceRaw(const void *input, int size);
+
+	/* Change tracking. Every change bumps the version, and each
+	 * row remembers the version it was last changed at. Consumers
+	 * keep the version they last caught up with and ask which rows
+	 * changed since, so any number of them can share one table */
+	uint64_t version() const { return curVersion; }
+
+	/* Whether any cell of row 'y', on any layer,
+	 * changed after version 'since' */
+	bool rowChanged(int y, uint64_t since) const
+	{
+		return rowVersions[y] > since;
+	}
+
 	int serialSize() const;
 	void serialize(char *buffer) const;
 	static Table *deserialize(const char *data, int len);
@@ -67,6 +97,9 @@ public:
 private:
 	int xs, ys, zs;
 	std::vector<int16_t> data;
+
+	uint64_t curVersion;
+	std::vector<uint64_t> rowVersions;
 };
 
 #endif // TABLE_H
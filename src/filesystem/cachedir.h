@@ -0,0 +1,168 @@
+/*
+** cachedir.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CACHEDIR_H
+#define CACHEDIR_H
+
+#include "filesystem.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Helpers shared by the on-disk caches (ImageCache, MidiCache,
+ * ProgramCache and the path cache snapshot). Their files are
+ * stored in host byte order, as a cache is never shared
+ * between machines */
+
+/* FNV-1a. To hash several pieces of data in a row,
+ * pass the result of the previous call as 'hash' */
+static inline uint64_t
+cacheHash(const void *data, size_t size,
+          uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/* Bytes between the read position and the end of 'f'. Lengths
+ * read from an entry are checked against this before anything
+ * is allocated for them, so a corrupt one can't make us run
+ * out of memory */
+static inline long
+cacheBytesLeft(FILE *f)
+{
+	long pos = ftell(f);
+
+	if (pos < 0 || fseek(f, 0, SEEK_END) != 0)
+		return 0;
+
+	long end = ftell(f);
+
+	if (fseek(f, pos, SEEK_SET) != 0)
+		return 0;
+
+	return end > pos ? end - pos : 0;
+}
+
+/* Closes 'f', which was written at 'tmpPath', and moves it to
+ * 'path' if 'ok' (ie. all writes succeeded) and closing worked.
+ * Otherwise, or if moving fails, the file is deleted. Writing
+ * entries this way means readers never see a partial one.
+ * Returns whether 'path' now holds the new entry */
+static inline bool
+finishCacheFile(FILE *f, bool ok,
+                const std::string &tmpPath, const std::string &path)
+{
+	ok = (fclose(f) == 0) && ok;
+
+	/* rename() won't replace existing files everywhere */
+	if (ok)
+	{
+		remove(path.c_str());
+		ok = rename(tmpPath.c_str(), path.c_str()) == 0;
+	}
+
+	if (!ok)
+		remove(tmpPath.c_str());
+
+	return ok;
+}
+
+/* Size budget of the caches that can grow without bounds.
+ *
+ * If the files ending in 'ext' directly inside 'dir' take up more
+ * than 'limit' bytes, deletes them, oldest written first, until
+ * they take up no more than three quarters of it, so that the
+ * next few writes don't have to trim again. Files that can't be
+ * deleted (eg. because they are still open on Windows) are skipped.
+ * Returns the bytes the files take up after trimming (0 if 'dir'
+ * couldn't be listed, so that callers don't retry right away) */
+static inline int64_t
+trimCacheDir(const std::string &dir, const char *ext, int64_t limit)
+{
+	const int64_t target = limit - limit / 4;
+
+	struct Entry
+	{
+		std::string path;
+		int64_t modTime;
+		int64_t size;
+
+		bool operator<(const Entry &o) const
+		{
+			return modTime < o.modTime;
+		}
+	};
+
+	std::vector<std::string> dirs, files;
+	std::vector<int64_t> dirTimes;
+
+	if (!mkxp_fs::listDirectoryTree(dir.c_str(), false, dirs, files, dirTimes,
+	                                [] { return false; }))
+		return 0;
+
+	const size_t extLen = strlen(ext);
+	std::vector<Entry> entries;
+	int64_t used = 0;
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		const std::string &name = files[i];
+
+		if (name.find('/') != std::string::npos || name.size() <= extLen ||
+		    name.compare(name.size() - extLen, extLen, ext) != 0)
+			continue;
+
+		Entry e;
+		e.path = dir + "/" + name;
+		bool isDir;
+
+		if (!mkxp_fs::statPath(e.path.c_str(), isDir, e.modTime, e.size) || isDir)
+			continue;
+
+		entries.push_back(e);
+		used += e.size;
+	}
+
+	if (used <= limit)
+		return used;
+
+	std::sort(entries.begin(), entries.end());
+
+	for (size_t i = 0; i < entries.size() && used > target; ++i)
+		if (remove(entries[i].path.c_str()) == 0)
+			used -= entries[i].size;
+
+	return used;
+}
+
+#endif // CACHEDIR_H
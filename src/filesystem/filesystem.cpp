@@ -31,6 +31,11 @@
 #include "eventthread.h"
 #include "sharedstate.h"
 
+#ifndef MKXPZ_RETRO
+#  include "util/sdl-util.h"
+#  include "cachedir.h"
+#endif // MKXPZ_RETRO
+
 #include <physfs.h>
 
 #ifdef MKXPZ_RETRO
@@ -41,7 +46,7 @@
 #endif // MKXPZ_RETRO
 
 #include <algorithm>
-#include <stack>
+#include <map>
 #include <string>
 #include <stdio.h>
 #include <string.h>
@@ -279,6 +284,30 @@ static void strTolower(std::string &str) {
 
 const Uint32 SDL_RWOPS_PHYSFS = SDL_RWOPS_UNKNOWN + 10;
 
+/* Contents of one search path entry (or of the whole
+ * search path, when it has to be enumerated as one) */
+struct MountListing {
+  enum Kind { Union, Directory, Archive };
+
+  Kind kind;
+
+  /* Without leading or trailing slashes */
+  std::string mountPoint;
+
+  /* Mixed case paths relative to the mount point */
+  std::vector<std::string> dirs;
+  std::vector<std::string> files;
+
+  /* Checked before a listing is reused. For directories, the
+   * modification times of the root followed by each of 'dirs',
+   * for archives the modification time and size of the file */
+  std::vector<int64_t> dirTimes;
+  int64_t modTime;
+  int64_t size;
+
+  MountListing() : kind(Union), modTime(0), size(0) {}
+};
+
 struct FileSystemPrivate {
   /* Maps: lower case full filepath,
    * To:   mixed case full filepath */
@@ -290,6 +319,39 @@ struct FileSystemPrivate {
   /* This is for compatibility with games that take Windows'
    * case insensitivity for granted */
   bool havePathCache;
+
+  bool allowSymlinks;
+
+#ifndef MKXPZ_RETRO
+  /* Guards 'pathCache' and 'fileLists', which image and
+   * sound decoder threads read through openRead() while
+   * the game thread may be mounting or reloading */
+  SDL_mutex *cacheMut;
+
+  /* Maps: search path entry,
+   * To:   its listing. Kept after unmounting so that
+   *       remounting (or the snapshot) can reuse it */
+  std::map<std::string, MountListing> listings;
+
+  /* Whether the path cache was built from 'listings',
+   * and can thus be updated one entry at a time */
+  bool perMountCache;
+
+  std::string snapshotPath;
+#endif // MKXPZ_RETRO
+};
+
+/* Holds FileSystemPrivate::cacheMut for its lifetime.
+ * The libretro core reads files from one thread only */
+struct CacheLock {
+#ifndef MKXPZ_RETRO
+  FileSystemPrivate *p;
+
+  CacheLock(FileSystemPrivate *p) : p(p) { SDL_LockMutex(p->cacheMut); }
+  ~CacheLock() { SDL_UnlockMutex(p->cacheMut); }
+#else
+  CacheLock(FileSystemPrivate *) {}
+#endif // MKXPZ_RETRO
 };
 
 static void throwPhysfsError(const char *desc) {
@@ -323,18 +385,31 @@ FileSystem::FileSystem(const char *argv0, bool allowSymlinks) {
 
   p = new FileSystemPrivate;
   p->havePathCache = false;
+  p->allowSymlinks = allowSymlinks;
+#ifndef MKXPZ_RETRO
+  p->cacheMut = SDL_CreateMutex();
+  p->perMountCache = false;
+#endif // MKXPZ_RETRO
 
   if (allowSymlinks)
     PHYSFS_permitSymbolicLinks(1);
 }
 
 FileSystem::~FileSystem() {
+#ifndef MKXPZ_RETRO
+  SDL_DestroyMutex(p->cacheMut);
+#endif // MKXPZ_RETRO
   delete p;
 
   if (PHYSFS_deinit() == 0)
     Debug() << "PhyFS failed to deinit.";
 }
 
+#ifndef MKXPZ_RETRO
+static bool addListing(FileSystemPrivate *p, const char *path);
+static void mergeListings(FileSystemPrivate *p);
+#endif // MKXPZ_RETRO
+
 void FileSystem::addPath(const char *path, const char *mountpoint, bool reload) {
   /* Try the normal mount first */
     int state = PHYSFS_mount(path, mountpoint, 1);
@@ -355,6 +430,12 @@ void FileSystem::addPath(const char *path, const char *mountpoint, bool reload)
         throw Exception(Exception::PHYSFSError, "Failed to mount %s (%s)", path, PHYSFS_getErrorByCode(err));
     }
     
+#ifndef MKXPZ_RETRO
+    /* Only the new entry needs to be listed */
+    if (reload && p->havePathCache && p->perMountCache && addListing(p, path))
+        return;
+#endif // MKXPZ_RETRO
+
     if (reload) reloadPathCache();
 }
 
@@ -365,37 +446,42 @@ void FileSystem::removePath(const char *path, bool reload) {
         throw Exception(Exception::PHYSFSError, "Failed to unmount %s (%s)", path, PHYSFS_getErrorByCode(err));
     }
     
+#ifndef MKXPZ_RETRO
+    /* The remaining entries' listings are still current */
+    if (reload && p->havePathCache && p->perMountCache) {
+        mergeListings(p);
+        return;
+    }
+#endif // MKXPZ_RETRO
+
     if (reload) reloadPathCache();
 }
 
-struct CacheEnumData {
-  FileSystemPrivate *p;
-  std::stack<std::vector<std::string> *> fileLists;
-
+struct NFCConverter {
 #ifdef __APPLE__
   iconv_t nfd2nfc;
   char buf[512];
 #endif
 
-  CacheEnumData(FileSystemPrivate *p) : p(p) {
+  NFCConverter() {
 #ifdef __APPLE__
     nfd2nfc = iconv_open("utf-8", "utf-8-mac");
 #endif
   }
 
-  ~CacheEnumData() {
+  ~NFCConverter() {
 #ifdef __APPLE__
     iconv_close(nfd2nfc);
 #endif
   }
 
   /* Converts in-place */
-  void toNFC(char *inout) {
+  void toNFC(std::string &inout) {
 #ifdef __APPLE__
-    size_t srcSize = strlen(inout);
+    size_t srcSize = inout.size();
     size_t bufSize = sizeof(buf);
     char *bufPtr = buf;
-    char *inoutPtr = inout;
+    char *inoutPtr = &inout[0];
 
     /* Reserve room for null terminator */
     --bufSize;
@@ -403,19 +489,34 @@ struct CacheEnumData {
     iconv(nfd2nfc, &inoutPtr, &srcSize, &bufPtr, &bufSize);
     /* Null-terminate */
     *bufPtr = 0;
-    strcpy(inout, buf);
+    inout = buf;
 #else
     (void)inout;
 #endif
   }
 };
 
-static PHYSFS_EnumerateCallbackResult cacheEnumCB(void *d, const char *origdir,
-                                                  const char *fname) {
+static void checkTermRequest() {
 #ifndef MKXPZ_RETRO
   if (shState && shState->rtData().rqTerm)
     throw Exception(Exception::MKXPError, "Game close requested. Aborting path cache enumeration.");
 #endif // MKXPZ_RETRO
+}
+
+struct CacheEnumData {
+  MountListing &listing;
+
+  /* Length of the enumerated root's path plus separator,
+   * stripped from the recorded paths */
+  size_t rootLen;
+
+  CacheEnumData(MountListing &listing, size_t rootLen)
+      : listing(listing), rootLen(rootLen) {}
+};
+
+static PHYSFS_EnumerateCallbackResult cacheEnumCB(void *d, const char *origdir,
+                                                  const char *fname) {
+  checkTermRequest();
 
   CacheEnumData &data = *static_cast<CacheEnumData *>(d);
   char fullPath[512];
@@ -425,46 +526,476 @@ static PHYSFS_EnumerateCallbackResult cacheEnumCB(void *d, const char *origdir,
   else
     snprintf(fullPath, sizeof(fullPath), "%s/%s", origdir, fname);
 
-  /* Deal with OSX' weird UTF-8 standards */
-  data.toNFC(fullPath);
-
-  std::string mixedCase(fullPath);
-  std::string lowerCase = mixedCase;
-  strTolower(lowerCase);
-
   PHYSFS_Stat stat;
-  PHYSFS_stat(fullPath, &stat);
+  if (!PHYSFS_stat(fullPath, &stat))
+    return PHYSFS_ENUM_OK;
+
+  const char *relPath = fullPath + std::min(data.rootLen, strlen(fullPath));
 
   if (stat.filetype == PHYSFS_FILETYPE_DIRECTORY) {
-    /* Create a new list for this directory */
-    std::vector<std::string> &list = data.p->fileLists[lowerCase];
+    data.listing.dirs.push_back(relPath);
 
     /* Iterate over its contents */
-    data.fileLists.push(&list);
     PHYSFS_enumerate(fullPath, cacheEnumCB, d);
-    data.fileLists.pop();
   } else {
-    /* Get the file list for the directory we're currently
-     * traversing and append this filename to it */
-    std::vector<std::string> &list = *data.fileLists.top();
+    data.listing.files.push_back(relPath);
+  }
+
+  return PHYSFS_ENUM_OK;
+}
+
+/* Adds 'listing' to the cache, below everything already in it */
+static void mergeListing(FileSystemPrivate *p, const MountListing &listing,
+                         NFCConverter &nfc) {
+  std::string prefix;
+
+  if (!listing.mountPoint.empty()) {
+    /* The mount point and its parents show up as directories */
+    const std::string &mp = listing.mountPoint;
+
+    for (size_t i = 0; i <= mp.size(); ++i) {
+      if (i < mp.size() && mp[i] != '/')
+        continue;
 
-    std::string lowerFilename(fname);
-    strTolower(lowerFilename);
-    list.push_back(lowerFilename);
+      std::string dir = mp.substr(0, i);
+      nfc.toNFC(dir);
+      strTolower(dir);
+      p->fileLists[dir];
+    }
+
+    prefix = mp + "/";
+  }
+
+  for (size_t i = 0; i < listing.dirs.size(); ++i) {
+    /* Deal with OSX' weird UTF-8 standards */
+    std::string lowerCase = prefix + listing.dirs[i];
+    nfc.toNFC(lowerCase);
+    strTolower(lowerCase);
+
+    /* Create a new list for this directory */
+    p->fileLists[lowerCase];
+  }
+
+  for (size_t i = 0; i < listing.files.size(); ++i) {
+    std::string mixedCase = prefix + listing.files[i];
+    nfc.toNFC(mixedCase);
+
+    std::string lowerCase = mixedCase;
+    strTolower(lowerCase);
+
+    /* Shadowed by an earlier search path entry */
+    if (p->pathCache.contains(lowerCase))
+      continue;
+
+    /* Append the filename to its directory's list */
+    size_t delim = lowerCase.rfind('/');
+    std::string dir = (delim == std::string::npos) ? "" : lowerCase.substr(0, delim);
+    p->fileLists[dir].push_back(lowerCase.substr(delim + 1));
 
     /* Add the lower -> mixed mapping of the file's full path */
-    data.p->pathCache.insert(lowerCase, mixedCase);
+    p->pathCache.insert(lowerCase, mixedCase);
   }
+}
 
-  return PHYSFS_ENUM_OK;
+static void clearPathCache(FileSystemPrivate *p) {
+  p->fileLists.clear();
+  p->pathCache.clear();
+
+  /* Always present, even for an empty search path */
+  p->fileLists[""];
+}
+
+/* Lists the whole search path in one go */
+static void enumerateUnion(FileSystemPrivate *p) {
+  MountListing listing;
+  CacheEnumData data(listing, 0);
+  PHYSFS_enumerate("", cacheEnumCB, &data);
+
+  NFCConverter nfc;
+  CacheLock lock(p);
+  clearPathCache(p);
+  mergeListing(p, listing, nfc);
+}
+
+#ifndef MKXPZ_RETRO
+/* Archives can only be enumerated through PhysFS, which would
+ * merge them with every other entry mounted at the same place.
+ * So they are mounted a second time by themselves under this */
+#define SCAN_MOUNT_POINT ".mkxpz-scan"
+
+static bool scanArchive(MountListing &listing, const char *path) {
+  PHYSFS_Io *io = createSDLRWIo(path);
+
+  if (!io)
+    return false;
+
+  /* PhysFS ignores mounting the same name twice */
+  std::string scanName = std::string("mkxpz-scan:") + path;
+
+  if (!PHYSFS_mountIo(io, scanName.c_str(), SCAN_MOUNT_POINT, 0)) {
+    io->destroy(io);
+    return false;
+  }
+
+  CacheEnumData data(listing, strlen(SCAN_MOUNT_POINT) + 1);
+  int ok;
+
+  try {
+    ok = PHYSFS_enumerate(SCAN_MOUNT_POINT, cacheEnumCB, &data);
+  } catch (...) {
+    PHYSFS_unmount(scanName.c_str());
+    throw;
+  }
+
+  PHYSFS_unmount(scanName.c_str());
+
+  return ok != 0;
+}
+
+static std::string mountPointOf(const char *path) {
+  const char *mp = PHYSFS_getMountPoint(path);
+  std::string str(mp ? mp : "");
+
+  size_t start = str.find_first_not_of('/');
+  size_t end = str.find_last_not_of('/');
+
+  if (start == std::string::npos)
+    return std::string();
+
+  return str.substr(start, end - start + 1);
+}
+
+/* Brings the listing of one search path entry up to date.
+ * Directories are walked natively on their own thread;
+ * archives go through PhysFS on the calling thread */
+struct ListingUpdate {
+  MountListing *listing;
+  std::string path;
+  bool allowSymlinks;
+
+  /* Current state of 'path' */
+  MountListing::Kind kind;
+  std::string mountPoint;
+  int64_t modTime;
+  int64_t size;
+
+  bool ok;
+  bool changed;
+
+  ListingUpdate(FileSystemPrivate *p, const char *path)
+      : listing(&p->listings[path]), path(path),
+        allowSymlinks(p->allowSymlinks), kind(MountListing::Union),
+        mountPoint(mountPointOf(path)), modTime(0), size(0),
+        ok(false), changed(false) {
+    bool isDir;
+
+    if (mkxp_fs::statPath(path, isDir, modTime, size))
+      kind = isDir ? MountListing::Directory : MountListing::Archive;
+  }
+
+  bool isCurrent() const {
+    const MountListing &l = *listing;
+
+    if (l.kind != kind || l.mountPoint != mountPoint)
+      return false;
+
+    if (kind == MountListing::Archive)
+      return l.modTime == modTime && l.size == size;
+
+    /* Adding, removing or renaming anything
+     * touches the directory containing it */
+    if (l.dirTimes.size() != l.dirs.size() + 1)
+      return false;
+
+    for (size_t i = 0; i < l.dirTimes.size(); ++i) {
+      std::string dirPath = (i == 0) ? path : path + "/" + l.dirs[i - 1];
+      bool isDir;
+      int64_t time, dirSize;
+
+      if (!mkxp_fs::statPath(dirPath.c_str(), isDir, time, dirSize) ||
+          !isDir || time != l.dirTimes[i])
+        return false;
+    }
+
+    return true;
+  }
+
+  static bool termRequested() {
+    return shState && shState->rtData().rqTerm;
+  }
+
+  void run() {
+    if (kind == MountListing::Union)
+      return;
+
+    if (isCurrent()) {
+      ok = true;
+      return;
+    }
+
+    MountListing fresh;
+    fresh.kind = kind;
+    fresh.mountPoint = mountPoint;
+    fresh.modTime = modTime;
+    fresh.size = size;
+
+    if (kind == MountListing::Directory)
+      ok = mkxp_fs::listDirectoryTree(path.c_str(), allowSymlinks,
+                                      fresh.dirs, fresh.files,
+                                      fresh.dirTimes, termRequested);
+    else
+      ok = scanArchive(fresh, path.c_str());
+
+    if (ok) {
+      std::swap(*listing, fresh);
+      changed = true;
+    }
+  }
+};
+
+#define SNAPSHOT_MAGIC "MKXPPCS\1"
+
+static void writeString(FILE *f, const std::string &str) {
+  uint32_t len = str.size();
+  fwrite(&len, sizeof(len), 1, f);
+  fwrite(str.c_str(), 1, len, f);
+}
+
+static bool readString(FILE *f, std::string &str) {
+  uint32_t len;
+
+  if (fread(&len, sizeof(len), 1, f) < 1 || len > 0xFFFF)
+    return false;
+
+  str.resize(len);
+
+  return fread(&str[0], 1, len, f) == len;
+}
+
+static void writeStrings(FILE *f, const std::vector<std::string> &list) {
+  uint32_t count = list.size();
+  fwrite(&count, sizeof(count), 1, f);
+
+  for (size_t i = 0; i < list.size(); ++i)
+    writeString(f, list[i]);
+}
+
+static bool readStrings(FILE *f, std::vector<std::string> &list) {
+  uint32_t count;
+
+  if (fread(&count, sizeof(count), 1, f) < 1)
+    return false;
+
+  /* Every string takes at least its length field, so a
+   * corrupt count can't make us allocate past the file */
+  if (count > cacheBytesLeft(f) / sizeof(uint32_t))
+    return false;
+
+  list.resize(count);
+
+  for (size_t i = 0; i < list.size(); ++i)
+    if (!readString(f, list[i]))
+      return false;
+
+  return true;
+}
+
+static void saveSnapshot(FileSystemPrivate *p) {
+  const std::string tmpPath = p->snapshotPath + ".tmp";
+  FILE *f = fopen(tmpPath.c_str(), "wb");
+
+  if (!f) {
+    Debug() << "Failed to write path cache snapshot" << p->snapshotPath;
+    return;
+  }
+
+  fwrite(SNAPSHOT_MAGIC, 1, 8, f);
+
+  uint32_t count = p->listings.size();
+  fwrite(&count, sizeof(count), 1, f);
+
+  std::map<std::string, MountListing>::const_iterator iter;
+
+  for (iter = p->listings.begin(); iter != p->listings.end(); ++iter) {
+    const MountListing &l = iter->second;
+    uint8_t kind = l.kind;
+    uint32_t timeCount = l.dirTimes.size();
+
+    writeString(f, iter->first);
+    writeString(f, l.mountPoint);
+    fwrite(&kind, sizeof(kind), 1, f);
+    fwrite(&l.modTime, sizeof(l.modTime), 1, f);
+    fwrite(&l.size, sizeof(l.size), 1, f);
+    writeStrings(f, l.dirs);
+    writeStrings(f, l.files);
+    fwrite(&timeCount, sizeof(timeCount), 1, f);
+    fwrite(l.dirTimes.data(), sizeof(int64_t), timeCount, f);
+  }
+
+  finishCacheFile(f, !ferror(f), tmpPath, p->snapshotPath);
+}
+
+static void loadSnapshot(FileSystemPrivate *p) {
+  FILE *f = fopen(p->snapshotPath.c_str(), "rb");
+
+  if (!f)
+    return;
+
+  char magic[8];
+  uint32_t count;
+  std::map<std::string, MountListing> loaded;
+  bool ok = fread(magic, 1, 8, f) == 8 && !memcmp(magic, SNAPSHOT_MAGIC, 8) &&
+            fread(&count, sizeof(count), 1, f) == 1;
+
+  /* Anything going wrong just means a fresh scan */
+  try {
+    for (uint32_t i = 0; ok && i < count; ++i) {
+      std::string path;
+      MountListing l;
+      uint8_t kind;
+      uint32_t timeCount;
+
+      ok = readString(f, path) && readString(f, l.mountPoint) &&
+           fread(&kind, sizeof(kind), 1, f) == 1 &&
+           fread(&l.modTime, sizeof(l.modTime), 1, f) == 1 &&
+           fread(&l.size, sizeof(l.size), 1, f) == 1 &&
+           readStrings(f, l.dirs) && readStrings(f, l.files) &&
+           fread(&timeCount, sizeof(timeCount), 1, f) == 1 &&
+           timeCount == (kind == MountListing::Directory ? l.dirs.size() + 1 : 0);
+
+      if (!ok)
+        break;
+
+      l.dirTimes.resize(timeCount);
+      ok = fread(l.dirTimes.data(), sizeof(int64_t), timeCount, f) == timeCount &&
+           kind <= MountListing::Archive;
+
+      l.kind = static_cast<MountListing::Kind>(kind);
+      std::swap(loaded[path], l);
+    }
+  } catch (const std::exception &) {
+    ok = false;
+  }
+
+  fclose(f);
+
+  if (!ok) {
+    Debug() << "Discarding invalid path cache snapshot" << p->snapshotPath;
+    return;
+  }
+
+  /* Listings already in memory are at least as recent */
+  loaded.insert(p->listings.begin(), p->listings.end());
+  p->listings.swap(loaded);
+}
+
+static void mergeListings(FileSystemPrivate *p) {
+  NFCConverter nfc;
+  CacheLock lock(p);
+  clearPathCache(p);
+
+  char **searchPath = PHYSFS_getSearchPath();
+
+  for (char **i = searchPath; *i; ++i) {
+    std::map<std::string, MountListing>::const_iterator iter = p->listings.find(*i);
+
+    if (iter != p->listings.end())
+      mergeListing(p, iter->second, nfc);
+  }
+
+  PHYSFS_freeList(searchPath);
 }
 
-void FileSystem::createPathCache() {
+/* Lists every search path entry separately, so that unchanged ones
+ * can be reused and directories can be walked in parallel. Returns
+ * false if an entry can't be listed by itself */
+static bool updateListings(FileSystemPrivate *p, bool &changed) {
+  std::vector<ListingUpdate*> updates;
+  char **searchPath = PHYSFS_getSearchPath();
+
+  for (char **i = searchPath; *i; ++i)
+    updates.push_back(new ListingUpdate(p, *i));
+
+  PHYSFS_freeList(searchPath);
+
+  std::vector<SDL_Thread*> threads;
+
+  for (size_t i = 0; i < updates.size(); ++i)
+    if (updates[i]->kind == MountListing::Directory)
+      threads.push_back(createSDLThread
+        <ListingUpdate, &ListingUpdate::run>(updates[i], "pathcache"));
+
+  bool ok = true;
+  changed = false;
+
+  try {
+    for (size_t i = 0; i < updates.size(); ++i)
+      if (updates[i]->kind != MountListing::Directory)
+        updates[i]->run();
+  } catch (...) {
+    ok = false;
+  }
+
+  for (size_t i = 0; i < threads.size(); ++i)
+    SDL_WaitThread(threads[i], 0);
+
+  for (size_t i = 0; i < updates.size(); ++i) {
+    ok = ok && updates[i]->ok;
+    changed = changed || updates[i]->changed;
+    delete updates[i];
+  }
+
+  checkTermRequest();
+
+  return ok;
+}
+
+static bool addListing(FileSystemPrivate *p, const char *path) {
+  ListingUpdate update(p, path);
+  update.run();
+
+  if (!update.ok)
+    return false;
+
+  /* Mounted last, so it is shadowed by everything else */
+  NFCConverter nfc;
+  {
+    CacheLock lock(p);
+    mergeListing(p, *update.listing, nfc);
+  }
+
+  if (update.changed && !p->snapshotPath.empty())
+    saveSnapshot(p);
+
+  return true;
+}
+#endif // MKXPZ_RETRO
+
+void FileSystem::createPathCache(const char *snapshotPath) {
   Debug() << "Loading path cache...";
 
-  CacheEnumData data(p);
-  data.fileLists.push(&p->fileLists[""]);
-  PHYSFS_enumerate("", cacheEnumCB, &data);
+#ifndef MKXPZ_RETRO
+  if (snapshotPath) {
+    p->snapshotPath = snapshotPath;
+    loadSnapshot(p);
+  }
+
+  bool changed;
+  p->perMountCache = updateListings(p, changed);
+
+  if (p->perMountCache) {
+    mergeListings(p);
+
+    if (changed && !p->snapshotPath.empty())
+      saveSnapshot(p);
+  } else {
+    Debug() << "Listing search path entries separately failed, enumerating them together";
+    enumerateUnion(p);
+  }
+#else
+  (void)snapshotPath;
+  enumerateUnion(p);
+#endif // MKXPZ_RETRO
 
   p->havePathCache = true;
 
@@ -474,8 +1005,6 @@ void FileSystem::createPathCache() {
 void FileSystem::reloadPathCache() {
     if (!p->havePathCache) return;
     
-    p->fileLists.clear();
-    p->pathCache.clear();
     createPathCache();
 }
 
@@ -634,6 +1163,8 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename) {
 
   const char *ext = findExt(filename);
 
+  data.handler.resolvedPath = fullPath;
+
 #ifdef MKXPZ_RETRO
   if (data.handler.tryRead(*data.ops, ext))
 #else
@@ -672,16 +1203,40 @@ void FileSystem::openRead(OpenHandler &handler, const char *filename) {
     file = delim + 1;
     dir = buffer;
   }
-  OpenReadEnumData data(handler, file, len + buffer - delim - !root,
-                        p->havePathCache ? &p->pathCache : 0);
+  const size_t fileN = len + buffer - delim - !root;
+
+  /* Only the candidates' translations, copied out of the cache */
+  BoostHash<std::string, std::string> pathTrans;
+
+  OpenReadEnumData data(handler, file, fileN,
+                        p->havePathCache ? &pathTrans : 0);
 
   if (p->havePathCache) {
-    /* Get the list of files contained in this directory
-     * and manually iterate over them */
-    const std::vector<std::string> &fileList = p->fileLists[dir];
+    /* Copy the files of this directory that could match
+     * while holding the cache lock, so that handlers can
+     * read without it. Checked first so that the lookup
+     * never inserts */
+    std::vector<std::string> candidates;
+
+    {
+      CacheLock lock(p);
+
+      if (p->fileLists.contains(dir)) {
+        const std::vector<std::string> &fileList = p->fileLists[dir];
+
+        for (size_t i = 0; i < fileList.size(); ++i) {
+          if (strncmp(fileList[i].c_str(), file, fileN) != 0)
+            continue;
+
+          std::string fullPath = root ? fileList[i] : std::string(dir) + "/" + fileList[i];
+          pathTrans.insert(fullPath, p->pathCache.value(fullPath));
+          candidates.push_back(fileList[i]);
+        }
+      }
+    }
 
-    for (size_t i = 0; i < fileList.size(); ++i)
-      openReadEnumCB(&data, dir, fileList[i].c_str());
+    for (size_t i = 0; i < candidates.size(); ++i)
+      openReadEnumCB(&data, dir, candidates[i].c_str());
   } else {
     PHYSFS_enumerate(dir, openReadEnumCB, &data);
   }
@@ -791,6 +1346,7 @@ const char *FileSystem::desensitize(const char *filename) {
   std::transform(fn_lower.begin(), fn_lower.end(), fn_lower.begin(), [](unsigned char c){
       return std::tolower(c);
   });
+  CacheLock lock(p);
   if (p->havePathCache && p->pathCache.contains(fn_lower))
     return p->pathCache[fn_lower].c_str();
   return filename;
@@ -96,8 +96,10 @@ public:
 	void addPath(const char *path, const char *mountpoint = 0, bool reload = false);
     void removePath(const char *path, bool reload = false);
 
-	/* Call these after the last 'addPath()' */
-	void createPathCache();
+	/* Call these after the last 'addPath()'.
+	 * If 'snapshotPath' is given, the cache is saved there
+	 * and reused (where still up to date) on later calls */
+	void createPathCache(const char *snapshotPath = 0);
     
     void reloadPathCache();
 
@@ -123,6 +125,11 @@ public:
 #endif // MKXPZ_RETRO
 			const char *ext
 		) = 0;
+
+		/* Path within the search path of the file passed to
+		 * tryRead(), as resolved (with extension and actual case).
+		 * Only valid for the duration of that call */
+		const char *resolvedPath = nullptr;
 	};
 
 	void openRead(OpenHandler &handler,
@@ -57,6 +57,109 @@ bool filesystemImpl::setCurrentDirectory(const char *path) {
     return ret;
 }
 
+bool filesystemImpl::createDirectories(const char *path) {
+    fs::path stdPath(path);
+
+    try {
+        fs::create_directories(stdPath);
+        return fs::is_directory(stdPath);
+    } catch (...) {
+        Debug() << "Failed to create directory" << path;
+        return false;
+    }
+}
+
+bool filesystemImpl::statPath(const char *path, bool &isDirectory, int64_t &modTime, int64_t &size) {
+    fs::path stdPath(path);
+    std::error_code ec;
+
+    fs::file_status status = fs::status(stdPath, ec);
+    if (ec || !fs::exists(status))
+        return false;
+
+    isDirectory = fs::is_directory(status);
+
+    modTime = fs::last_write_time(stdPath, ec).time_since_epoch().count();
+    if (ec)
+        return false;
+
+    size = isDirectory ? 0 : (int64_t)fs::file_size(stdPath, ec);
+    return !ec;
+}
+
+// Guards against symlink loops
+#define MAX_TREE_DEPTH 64
+
+static bool listTreeLevel(const fs::path &root, const std::string &rel, int depth,
+                          bool followSymlinks,
+                          std::vector<std::string> &dirs,
+                          std::vector<std::string> &files,
+                          std::vector<int64_t> &dirTimes,
+                          const std::function<bool()> &cancelled) {
+    if (cancelled())
+        return false;
+
+    fs::path dirPath = rel.empty() ? root : root / fs::path(rel);
+    std::error_code ec;
+
+    dirTimes.push_back(fs::last_write_time(dirPath, ec).time_since_epoch().count());
+    if (ec)
+        return false;
+
+    fs::directory_iterator iter(dirPath, ec);
+    if (ec)
+        return false;
+
+    // Collected first so that 'dirs' and 'dirTimes' stay in step
+    std::vector<std::string> subdirs;
+
+    for (; iter != fs::directory_iterator(); iter.increment(ec)) {
+        if (ec)
+            return false;
+
+        const fs::directory_entry &entry = *iter;
+
+        // PhysFS hides symlinks entirely unless they are permitted
+        if (!followSymlinks && fs::is_symlink(entry.symlink_status(ec)))
+            continue;
+
+        std::string name = entry.path().filename().string();
+        std::string entryRel = rel.empty() ? name : rel + "/" + name;
+
+        if (fs::is_directory(entry.status(ec)))
+            subdirs.push_back(entryRel);
+        else if (!ec)
+            files.push_back(entryRel);
+    }
+
+    if (depth >= MAX_TREE_DEPTH)
+        return true;
+
+    for (size_t i = 0; i < subdirs.size(); ++i) {
+        dirs.push_back(subdirs[i]);
+
+        if (!listTreeLevel(root, subdirs[i], depth + 1, followSymlinks,
+                           dirs, files, dirTimes, cancelled))
+            return false;
+    }
+
+    return true;
+}
+
+bool filesystemImpl::listDirectoryTree(const char *path, bool followSymlinks,
+                                       std::vector<std::string> &dirs,
+                                       std::vector<std::string> &files,
+                                       std::vector<int64_t> &dirTimes,
+                                       const std::function<bool()> &cancelled) {
+    try {
+        return listTreeLevel(fs::path(path), "", 0, followSymlinks,
+                             dirs, files, dirTimes, cancelled);
+    } catch (...) {
+        Debug() << "Failed to list directory" << path;
+        return false;
+    }
+}
+
 std::string filesystemImpl::getCurrentDirectory() {
     std::string ret;
     try {
@@ -9,6 +9,9 @@
 #define filesystemImpl_h
 
 #include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
 #include <SDL_video.h>
 
 namespace filesystemImpl {
@@ -17,6 +20,22 @@ bool fileExists(const char *path);
 std::string contentsOfFileAsString(const char *path);
 
 bool setCurrentDirectory(const char *path);
+
+bool createDirectories(const char *path);
+
+// Modification time is an opaque stamp; only compare it against
+// other stamps from this function
+bool statPath(const char *path, bool &isDirectory, int64_t &modTime, int64_t &size);
+
+// Recursively lists everything below the directory 'path', as paths
+// relative to it. 'dirTimes' receives the modification time of 'path'
+// followed by those of each entry of 'dirs'. Returns false if a
+// directory couldn't be read or 'cancelled' returned true
+bool listDirectoryTree(const char *path, bool followSymlinks,
+                       std::vector<std::string> &dirs,
+                       std::vector<std::string> &files,
+                       std::vector<int64_t> &dirTimes,
+                       const std::function<bool()> &cancelled);
     
 std::string getCurrentDirectory();
     
@@ -13,6 +13,9 @@
 #import "filesystemImpl.h"
 #import "util/exception.h"
 
+#import <dirent.h>
+#import <sys/stat.h>
+
 #define PATHTONS(str) [NSFileManager.defaultManager stringWithFileSystemRepresentation:str length:strlen(str)]
 
 #define NSTOPATH(str) [NSFileManager.defaultManager fileSystemRepresentationWithPath:str]
@@ -43,6 +46,108 @@ bool filesystemImpl::setCurrentDirectory(const char *path) {
     }
 }
 
+bool filesystemImpl::createDirectories(const char *path) {
+    @autoreleasepool {
+        NSString *nsPath = PATHTONS(path);
+        [NSFileManager.defaultManager createDirectoryAtPath:nsPath withIntermediateDirectories:YES attributes:nil error:nil];
+
+        BOOL isDir;
+        return [NSFileManager.defaultManager fileExistsAtPath:nsPath isDirectory: &isDir] && isDir;
+    }
+}
+
+static int64_t statModTime(const struct stat &st) {
+    return (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+}
+
+bool filesystemImpl::statPath(const char *path, bool &isDirectory, int64_t &modTime, int64_t &size) {
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    
+    isDirectory = S_ISDIR(st.st_mode);
+    modTime = statModTime(st);
+    size = isDirectory ? 0 : (int64_t)st.st_size;
+    return true;
+}
+
+// Guards against symlink loops
+#define MAX_TREE_DEPTH 64
+
+static bool listTreeLevel(const std::string &root, const std::string &rel, int depth,
+                          bool followSymlinks,
+                          std::vector<std::string> &dirs,
+                          std::vector<std::string> &files,
+                          std::vector<int64_t> &dirTimes,
+                          const std::function<bool()> &cancelled) {
+    if (cancelled())
+        return false;
+    
+    std::string dirPath = rel.empty() ? root : root + "/" + rel;
+    struct stat st;
+    
+    if (stat(dirPath.c_str(), &st) != 0)
+        return false;
+    
+    dirTimes.push_back(statModTime(st));
+    
+    DIR *dir = opendir(dirPath.c_str());
+    if (!dir)
+        return false;
+    
+    // Collected first so that 'dirs' and 'dirTimes' stay in step
+    std::vector<std::string> subdirs;
+    
+    while (struct dirent *entry = readdir(dir)) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+        
+        std::string entryRel = rel.empty() ? entry->d_name : rel + "/" + entry->d_name;
+        bool isDir = entry->d_type == DT_DIR;
+        
+        // PhysFS hides symlinks entirely unless they are permitted
+        if (entry->d_type == DT_LNK && !followSymlinks)
+            continue;
+        
+        // The entry type doesn't say where a link points to
+        if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN) {
+            if (stat((root + "/" + entryRel).c_str(), &st) != 0)
+                continue;
+            
+            isDir = S_ISDIR(st.st_mode);
+        }
+        
+        if (isDir)
+            subdirs.push_back(entryRel);
+        else
+            files.push_back(entryRel);
+    }
+    
+    closedir(dir);
+    
+    if (depth >= MAX_TREE_DEPTH)
+        return true;
+    
+    for (size_t i = 0; i < subdirs.size(); ++i) {
+        dirs.push_back(subdirs[i]);
+        
+        if (!listTreeLevel(root, subdirs[i], depth + 1, followSymlinks,
+                           dirs, files, dirTimes, cancelled))
+            return false;
+    }
+    
+    return true;
+}
+
+bool filesystemImpl::listDirectoryTree(const char *path, bool followSymlinks,
+                                       std::vector<std::string> &dirs,
+                                       std::vector<std::string> &files,
+                                       std::vector<int64_t> &dirTimes,
+                                       const std::function<bool()> &cancelled) {
+    return listTreeLevel(path, "", 0, followSymlinks,
+                         dirs, files, dirTimes, cancelled);
+}
+
 std::string filesystemImpl::getCurrentDirectory() {
     @autoreleasepool {
         return std::string(NSTOPATH(NSFileManager.defaultManager.currentDirectoryPath));
@@ -30,6 +30,8 @@
 #ifndef MKXPZ_RETRO
 #include "input.h"
 #include "audio.h"
+#include "audiothread.h"
+#include "midicache.h"
 #endif // MKXPZ_RETRO
 #include "glstate.h"
 #ifndef MKXPZ_RETRO
@@ -42,10 +44,20 @@
 #include "gl-util.h"
 #include "global-ibo.h"
 #include "quad.h"
+#include "preparequeue.h"
+#include "frameprofiler.h"
+#include "spritebatch.h"
+#include "glyphcache.h"
+#include "textruncache.h"
+#include "imagedecoder.h"
+#include "imagecache.h"
 #endif // MKXPZ_RETRO
 #include "binding.h"
 #include "exception.h"
 #include "sharedmidistate.h"
+#ifdef MKXPZ_RETRO
+#include "softraster.h"
+#endif // MKXPZ_RETRO
 
 #include <unistd.h>
 #include <stdio.h>
@@ -89,6 +101,8 @@ struct SharedStatePrivate
 #ifndef MKXPZ_RETRO
 	Graphics graphics;
 	Input input;
+	AudioThread audioThread;
+	MidiCache midiCache;
 	Audio audio;
 
 	GLState _glState;
@@ -111,6 +125,17 @@ struct SharedStatePrivate
 	TEXFBO atlasTex;
 
 	Quad gpQuad;
+
+	PrepareQueue prepareQueue;
+	FrameProfiler frameProfiler;
+	SpriteBatch spriteBatch;
+
+	GlyphCache glyphCache;
+	TextRunCache textRunCache;
+	ImageCache imageCache;
+	ImageDecoder imageDecoder;
+#else
+	SoftRaster softRaster;
 #endif // MKXPZ_RETRO
 
 	unsigned int stampCounter;
@@ -134,9 +159,23 @@ struct SharedStatePrivate
 #ifndef MKXPZ_RETRO
 	      graphics(threadData),
 	      input(*threadData),
+	      audioThread(threadData->syncPoint),
+	      midiCache(threadData->config.midi.prerender
+	                ? threadData->config.customDataPath + "/MidiCache" : "",
+	                threadData->config),
 	      audio(*threadData),
 	      _glState(threadData->config),
+	      shaders(threadData->config.shaderCache
+	              ? threadData->config.customDataPath + "/ShaderCache" : ""),
 	      fontState(threadData->config),
+	      prepareQueue(threadData->config.prepareThreads),
+	      frameProfiler(threadData->config.frameProfiler),
+	      spriteBatch(threadData->config.spriteBatching),
+	      textRunCache(threadData->config.textCacheSize),
+	      imageCache(threadData->config.imageCache
+	                 ? threadData->config.customDataPath + "/ImageCache" : "",
+	                 (int64_t) threadData->config.imageCacheSize * 1024 * 1024),
+	      imageDecoder(threadData->config.decodeThreads),
 #endif // MKXPZ_RETRO
 	      stampCounter(0)
 	{}
@@ -147,10 +186,6 @@ struct SharedStatePrivate
         startupTime = std::chrono::steady_clock::now();
         
 #ifndef MKXPZ_RETRO
-		/* Shaders have been compiled in ShaderSet's constructor */
-		if (gl.ReleaseShaderCompiler)
-			gl.ReleaseShaderCompiler();
-
 		std::string archPath = config.execName + gameArchExt();
 
 		for (size_t i = 0; i < config.patches.size(); ++i)
@@ -170,7 +205,8 @@ struct SharedStatePrivate
 			fileSystem.addPath(config.rtps[i].c_str());
 
 		if (config.pathCache)
-			fileSystem.createPathCache();
+			fileSystem.createPathCache(config.pathCacheSnapshot
+			                           ? (config.customDataPath + "/PathCache.bin").c_str() : 0);
 
 		fileSystem.initFontSets(fontState);
 
@@ -284,12 +320,23 @@ GSATT(RGSSThreadData&, rtData)
 GSATT(Config&, config)
 GSATT(Graphics&, graphics)
 GSATT(Input&, input)
+GSATT(AudioThread&, audioThread)
+GSATT(MidiCache&, midiCache)
 GSATT(Audio&, audio)
 GSATT(GLState&, _glState)
 GSATT(ShaderSet&, shaders)
 GSATT(TexPool&, texPool)
 GSATT(Quad&, gpQuad)
 GSATT(SharedFontState&, fontState)
+GSATT(PrepareQueue&, prepareQueue)
+GSATT(FrameProfiler&, frameProfiler)
+GSATT(SpriteBatch&, spriteBatch)
+GSATT(GlyphCache&, glyphCache)
+GSATT(TextRunCache&, textRunCache)
+GSATT(ImageDecoder&, imageDecoder)
+GSATT(ImageCache&, imageCache)
+#else
+GSATT(SoftRaster&, softRaster)
 #endif // MKXPZ_RETRO
 GSATT(SharedMidiState&, midiState)
 
@@ -438,6 +485,19 @@ unsigned int SharedState::genTimeStamp()
 	return p->stampCounter++;
 }
 
+#ifdef MKXPZ_RETRO
+/* The core composites straight into the frame buffer,
+ * so the screen scene is just the size of the frame */
+class RetroScreen : public Scene
+{
+public:
+	RetroScreen(int width, int height)
+	{
+		geometry.rect = IntRect(0, 0, width, height);
+	}
+};
+#endif // MKXPZ_RETRO
+
 SharedState::SharedState(RGSSThreadData *threadData)
 {
 	p = new SharedStatePrivate(threadData);
@@ -446,7 +506,7 @@ SharedState::SharedState(RGSSThreadData *threadData)
 	{
 		p->init(threadData);
 #ifdef MKXPZ_RETRO
-		p->screen = new Scene(); // TODO: implement
+		p->screen = new RetroScreen(softFrameWidth, softFrameHeight);
 #else
 		p->screen = p->graphics.getScreen();
 #endif // MKXPZ_RETRO
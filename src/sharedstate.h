@@ -42,7 +42,17 @@ class EventThread;
 class Graphics;
 class Input;
 class Audio;
+class AudioThread;
+class MidiCache;
 class GLState;
+class GlyphCache;
+class TextRunCache;
+class ImageDecoder;
+class ImageCache;
+class PrepareQueue;
+class FrameProfiler;
+class SpriteBatch;
+class SoftRaster;
 class TexPool;
 class Font;
 class SharedFontState;
@@ -69,20 +79,37 @@ struct SharedState
 
 	Graphics &graphics() const;
 	Input &input() const;
+	AudioThread &audioThread() const;
+	MidiCache &midiCache() const;
 	Audio &audio() const;
 
 	GLState &_glState() const;
 
+	/* Frame rasterizer of the libretro core */
+	SoftRaster &softRaster() const;
+
 	ShaderSet &shaders() const;
 
 	TexPool &texPool() const;
 
 	SharedFontState &fontState() const;
+	GlyphCache &glyphCache() const;
+	TextRunCache &textRunCache() const;
+	ImageDecoder &imageDecoder() const;
+	ImageCache &imageCache() const;
 	Font &defaultFont() const;
 	SharedMidiState &midiState() const;
 
 	sigslot::signal<> prepareDraw;
 
+	/* Jobs pushed from 'prepareDraw' handlers are built
+	 * concurrently once all handlers have run */
+	PrepareQueue &prepareQueue() const;
+
+	FrameProfiler &frameProfiler() const;
+
+	SpriteBatch &spriteBatch() const;
+
 	unsigned int genTimeStamp();
     
     // Returns time since SharedState was constructed in microseconds
@@ -107,4 +107,46 @@ writeDouble(char **dataP, double value)
 	*dataP += 8;
 }
 
+/* Bulk versions for element arrays (eg. Table cells),
+ * which are stored little endian like everything else.
+ * On little endian hosts these are plain copies; the
+ * byte swap loops are simple enough to be vectorized */
+static inline void
+readInt16Array(const char **dataP, int16_t *out, size_t count)
+{
+	memcpy(out, *dataP, count * 2);
+	*dataP += count * 2;
+
+#ifdef MKXPZ_BIG_ENDIAN
+	for (size_t i = 0; i < count; ++i)
+#  ifdef _MSC_VER
+		out[i] = (int16_t)_byteswap_ushort((unsigned short)out[i]);
+#  else
+		out[i] = (int16_t)__builtin_bswap16((uint16_t)out[i]);
+#  endif
+#endif
+}
+
+static inline void
+writeInt16Array(char **dataP, const int16_t *values, size_t count)
+{
+#ifdef MKXPZ_BIG_ENDIAN
+	char *dst = *dataP;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+#  ifdef _MSC_VER
+		uint16_t value = _byteswap_ushort((unsigned short)values[i]);
+#  else
+		uint16_t value = __builtin_bswap16((uint16_t)values[i]);
+#  endif
+		memcpy(dst + i * 2, &value, 2);
+	}
+#else
+	memcpy(*dataP, values, count * 2);
+#endif
+
+	*dataP += count * 2;
+}
+
 #endif // SERIALUTIL_H
@@ -0,0 +1,44 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+#
+# Measures the per call cost of methods whose arguments
+# are unpacked with RbArgs; compare against a build from
+# before that change to see the rb_get_args overhead.
+
+CALLS = 200000
+
+def bench(desc)
+	starttime = System.uptime
+
+	for i in 1..CALLS do
+		yield i
+	end
+
+	endtime = System.uptime
+
+	System::puts("%s: %.1f ns per call" % [desc, (endtime - starttime) * 1e9 / CALLS])
+end
+
+rect = Rect.new
+color = Color.new
+tone = Tone.new
+bmp = Bitmap.new(32, 32)
+src = Bitmap.new(32, 32)
+src_rect = Rect.new(0, 0, 4, 4)
+
+# Empty loop, to subtract from the figures below
+bench("Baseline") { |i| }
+
+bench("Rect#set") { |i| rect.set(i, 2, 3, 4) }
+bench("Rect#x=") { |i| rect.x = i }
+bench("Color#set") { |i| color.set(1.0, 2.0, 3.0) }
+bench("Color#red=") { |i| color.red = 12.0 }
+bench("Tone#set") { |i| tone.set(1.0, 2.0, 3.0, 4.0) }
+bench("Bitmap#get_pixel") { |i| bmp.get_pixel(i & 31, 7) }
+bench("Bitmap#set_pixel") { |i| bmp.set_pixel(i & 31, 7, color) }
+bench("Bitmap#blt") { |i| bmp.blt(i & 15, 0, src, src_rect) }
+
+exit
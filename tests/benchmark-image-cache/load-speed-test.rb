@@ -0,0 +1,27 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json,
+# with "gameFolder" pointing at an unpacked game.
+#
+# Loads every image in the game's Graphics folder and reports
+# the time taken. To compare cold and warm startup, run it
+# once with "imageCache" disabled, then twice with it enabled
+# (the first of those runs fills the cache, the second one
+# loads from it).
+
+paths = Dir.glob("Graphics/**/*.{png,PNG,jpg,JPG,jpeg,bmp,BMP}").sort
+
+starttime = System.uptime
+
+paths.each do |path|
+	bmp = Bitmap.new(path.sub(/\.[^.\/]+\z/, ""))
+	bmp.dispose
+end
+
+endtime = System.uptime
+
+System::puts("\n\nLoaded %d images in %s seconds\n\n" % [paths.size, endtime - starttime])
+
+exit
@@ -0,0 +1,43 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json,
+# from a game folder with map files in "Data".
+
+maps = Dir.glob("Data/Map[0-9]*.{rxdata,rvdata,rvdata2}")
+
+if maps.empty?
+	System::puts("No map files found in Data")
+	exit
+end
+
+# Sanity check that dumping and loading round trips
+t = Table.new(20, 15, 3)
+t[19, 14, 2] = -1234
+u = Marshal.load(Marshal.dump(t))
+System::puts((u[19, 14, 2] == -1234 ? "Passed" : "FAILED") + " Table round trip")
+
+starttime = System.uptime
+
+for i in 1..10 do
+	maps.each { |m| load_data(m) }
+end
+
+endtime = System.uptime
+
+System::puts("\n\nLoaded %d maps 10 times in: %s\n\n" % [maps.size, endtime - starttime])
+
+starttime = System.uptime
+
+data = maps.map { |m| load_data(m) }
+
+for i in 1..10 do
+	data.each { |d| Marshal.load(Marshal.dump(d)) }
+end
+
+endtime = System.uptime
+
+System::puts("\n\nDumped and reloaded them 10 times in: %s\n\n" % [endtime - starttime])
+
+exit
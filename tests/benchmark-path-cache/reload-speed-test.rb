@@ -0,0 +1,43 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json,
+# ideally with "gameFolder" pointing at a game with many
+# files and a few RTPs configured.
+#
+# Times rebuilding the path cache, and remounting one search
+# path entry (which should only list that entry). Run it with
+# "pathCacheSnapshot" on and off to compare.
+
+PASSES = 10
+
+ext = [".rxdata", ".rvdata", ".rvdata2"].find do |e|
+	System.file_exist?("Data/System" + e)
+end
+
+raise "No game data found" if ext.nil?
+
+starttime = System.uptime
+
+PASSES.times do
+	System.reload_cache
+end
+
+reloadtime = (System.uptime - starttime) / PASSES
+
+starttime = System.uptime
+
+PASSES.times do
+	System.unmount(".")
+	System.mount(".")
+end
+
+remounttime = (System.uptime - starttime) / PASSES
+
+raise "Game data missing after remounting" unless System.file_exist?("Data/System" + ext)
+
+System::puts("\n\nPath cache: %.1f ms per reload, %.1f ms per remount\n\n" %
+             [reloadtime * 1000, remounttime * 1000])
+
+exit
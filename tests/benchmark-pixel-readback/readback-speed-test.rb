@@ -0,0 +1,51 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+
+bmp = Bitmap.new(1024, 1024)
+bmp.fill_rect(0, 0, 1024, 1024, Color.new(0, 0, 255))
+
+# get_pixels has to agree with get_pixel, also around
+# regions that were modified after the first readback
+bmp.get_pixel(0, 0)
+bmp.fill_rect(100, 100, 10, 10, Color.new(255, 0, 0))
+bmp.set_pixel(500, 500, Color.new(0, 255, 0, 128))
+
+data = bmp.get_pixels(95, 95, 20, 20)
+for y in 0...20 do
+	for x in 0...20 do
+		c = bmp.get_pixel(95 + x, 95 + y)
+		px = data[(y * 20 + x) * 4, 4].unpack("C4")
+		if px != [c.red.to_i, c.green.to_i, c.blue.to_i, c.alpha.to_i]
+			System::puts("Mismatch at %d,%d: %s" % [95 + x, 95 + y, px.inspect])
+			exit
+		end
+	end
+end
+
+if bmp.get_pixels(Rect.new(500, 500, 1, 1)).unpack("C4") != [0, 255, 0, 128]
+	System::puts("set_pixel not reflected in get_pixels")
+	exit
+end
+
+if bmp.get_pixels(1023, 1023, 2, 2).unpack("C16")[4, 12].any? { |v| v != 0 }
+	System::puts("Out of bounds pixels are not zero")
+	exit
+end
+
+# Small edits between reads, like a game scanning a
+# bitmap it keeps drawing into
+starttime = System.uptime
+
+for i in 1..1000 do
+	bmp.fill_rect(i % 1000, i % 1000, 4, 4, Color.new(i % 256, 0, 0))
+	bmp.get_pixel((i * 7) % 1024, (i * 13) % 1024)
+end
+
+endtime = System.uptime
+
+System::puts("\n\nTotal readback time: %s\n\n" % [endtime - starttime])
+
+exit
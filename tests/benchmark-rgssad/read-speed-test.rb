@@ -0,0 +1,49 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json,
+# with "gameFolder" pointing at a game that ships an
+# encrypted archive (Game.rgssad, .rgss2a or .rgss3a).
+#
+# Reads the game's database and map files out of the archive
+# a number of times and reports the throughput. Run it on
+# builds with and without the change under test to compare.
+
+PASSES = 20
+
+ext = [".rxdata", ".rvdata", ".rvdata2"].find do |e|
+	System.file_exist?("Data/System" + e)
+end
+
+raise "No game data found" if ext.nil?
+
+names = %w[Actors Classes Skills Items Weapons Armors Enemies Troops
+           States Animations Tilesets CommonEvents System MapInfos Scripts]
+
+paths = names.map { |n| "Data/" + n + ext }.select { |p| System.file_exist?(p) }
+
+i = 1
+while System.file_exist?("Data/Map%03d%s" % [i, ext])
+	paths << "Data/Map%03d%s" % [i, ext]
+	i += 1
+end
+
+bytes = 0
+
+starttime = System.uptime
+
+PASSES.times do
+	paths.each do |path|
+		bytes += load_data(path, true).bytesize
+	end
+end
+
+endtime = System.uptime
+
+elapsed = endtime - starttime
+
+System::puts("\n\nRead %d files %d times (%.1f MB) in %s seconds: %.1f MB/s\n\n" %
+             [paths.size, PASSES, bytes / 1048576.0, elapsed, bytes / 1048576.0 / elapsed])
+
+exit
@@ -0,0 +1,40 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+#
+# Moves a thousand same-Z sprites vertically every frame, which
+# makes them change places in the draw order under RGSS2+ sorting,
+# and prints how long the script part of each frame takes.
+
+SPRITES = 1000
+FRAMES = 300
+
+bitmap = Bitmap.new(8, 8)
+bitmap.fill_rect(bitmap.rect, Color.new(255, 255, 255))
+
+sprites = Array.new(SPRITES) do
+	s = Sprite.new
+	s.bitmap = bitmap
+	s.x = rand(Graphics.width)
+	s.y = rand(Graphics.height)
+	s
+end
+
+Graphics.frame_profiler = true
+
+FRAMES.times do
+	sprites.each do |s|
+		s.y = (s.y + rand(-4..4)) % Graphics.height
+	end
+	Graphics.update
+end
+
+stats = Graphics.frame_stats(FRAMES)
+script = stats.sum { |frame| frame[:script] } / stats.size
+
+System::puts("\n\n#{SPRITES} sprites, #{FRAMES} frames")
+System::puts("Script: %.3f ms/frame\n\n" % script)
+
+exit
@@ -0,0 +1,50 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+#
+# Draws a couple thousand small sprites and prints the average
+# composite time per frame. Run once with "spriteBatching"
+# enabled and once disabled in mkxp.json to compare.
+
+SPRITES = 2000
+FRAMES = 300
+
+sheet = Bitmap.new(64, 16)
+4.times do |i|
+	sheet.fill_rect(i * 16, 0, 16, 16, Color.new(64 * i, 255 - 64 * i, 128))
+end
+
+sprites = Array.new(SPRITES) do |i|
+	s = Sprite.new
+	s.bitmap = sheet
+	s.src_rect.set((i % 4) * 16, 0, 16, 16)
+	s.x = rand(Graphics.width)
+	s.y = rand(Graphics.height)
+	s.angle = rand(360) if i % 5 == 0
+	s.opacity = 128 if i % 3 == 0
+	# Breaks up runs, like the odd effect sprite in a battle
+	s.tone = Tone.new(0, 0, 0, 255) if i % 100 == 0
+	s
+end
+
+Graphics.frame_profiler = true
+
+FRAMES.times do |f|
+	sprites.each_with_index do |s, i|
+		s.x = (s.x + 1 + i % 3) % Graphics.width
+		s.mirror = (f / 30 + i).odd?
+	end
+	Graphics.update
+end
+
+stats = Graphics.frame_stats(FRAMES)
+composite = stats.sum { |frame| frame[:composite] } / stats.size
+total = stats.sum { |frame| frame[:total] } / stats.size
+
+System::puts("\n\n#{SPRITES} sprites, #{FRAMES} frames")
+System::puts("Composite: %.3f ms/frame" % composite)
+System::puts("Total:     %.3f ms/frame\n\n" % total)
+
+exit
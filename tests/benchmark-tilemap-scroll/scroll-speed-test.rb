@@ -0,0 +1,69 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json
+# (RGSS1 only, as it uses the XP Tilemap).
+#
+# Scrolls a three layer map diagonally, then animates a few
+# tiles through the map data every frame, and prints how long
+# frame preparation takes in each case.
+
+MAP_W = 200
+MAP_H = 200
+FRAMES = 600
+
+tileset = Bitmap.new(256, 32 * 16)
+16.times do |y|
+	8.times do |x|
+		tileset.fill_rect(x * 32, y * 32, 32, 32, Color.new(x * 32, y * 16, 128))
+	end
+end
+
+priorities = Table.new(384 + 8 * 16)
+(384 + 8 * 8...384 + 8 * 16).each { |i| priorities[i] = 1 + i % 5 }
+
+data = Table.new(MAP_W, MAP_H, 3)
+MAP_H.times do |y|
+	MAP_W.times do |x|
+		data[x, y, 0] = 384 + rand(8 * 8)
+		data[x, y, 1] = 384 + 8 * 8 + rand(8 * 8) if rand(4) == 0
+	end
+end
+
+tilemap = Tilemap.new
+tilemap.tileset = tileset
+tilemap.priorities = priorities
+tilemap.map_data = data
+
+def prepare_time(frames)
+	stats = Graphics.frame_stats(frames)
+	stats.sum { |frame| frame[:prepare] + frame[:flush] } / stats.size
+end
+
+Graphics.frame_profiler = true
+
+FRAMES.times do |i|
+	tilemap.ox = i * 4
+	tilemap.oy = i * 3
+	Graphics.update
+end
+
+scroll = prepare_time(FRAMES)
+
+FRAMES.times do |i|
+	10.times do
+		x = tilemap.ox / 32 + rand(20)
+		y = tilemap.oy / 32 + rand(15)
+		data[x, y, 0] = 384 + rand(8 * 8)
+	end
+	Graphics.update
+end
+
+patch = prepare_time(FRAMES)
+
+System::puts("\n\n#{MAP_W}x#{MAP_H} map, #{FRAMES} frames each")
+System::puts("Scrolling:      %.3f ms/frame" % scroll)
+System::puts("Changing tiles: %.3f ms/frame\n\n" % patch)
+
+exit
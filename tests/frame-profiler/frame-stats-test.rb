@@ -0,0 +1,52 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+#
+# Profiles a couple of seconds of frames, prints the average
+# time per section and writes a Chrome trace next to the game.
+
+FRAMES = 120
+
+def assert(cond, msg)
+	raise "Assertion failed: #{msg}" unless cond
+end
+
+Graphics.frame_profiler = true
+
+sprite = Sprite.new
+sprite.bitmap = Bitmap.new(320, 240)
+
+FRAMES.times do |i|
+	sprite.bitmap.fill_rect(0, 0, 320, 240, Color.new(i * 2 % 256, 0, 0))
+	Graphics.update
+end
+
+stats = Graphics.frame_stats(FRAMES)
+
+assert(stats.size == FRAMES, "recorded #{stats.size} of #{FRAMES} frames")
+assert(stats.each_cons(2).all? { |a, b| b[:frame] == a[:frame] + 1 }, "frames in order")
+
+sections = [:script, :prepare, :flush, :composite, :submit, :swap, :sleep]
+
+stats.each do |frame|
+	sum = sections.sum { |s| frame[s] }
+	assert(sum <= frame[:total] + 0.01, "sections exceed frame time")
+end
+
+System::puts("\n\nAverage per frame over #{FRAMES} frames (ms):")
+
+(sections + [:total]).each do |s|
+	System::puts("  %-10s %.3f" % [s, stats.sum { |f| f[s] } / FRAMES])
+end
+
+Graphics.dump_frame_trace("frame-trace.json")
+System::puts("\nTrace written to frame-trace.json\n\n")
+
+Graphics.frame_profiler = false
+count = Graphics.frame_stats.size
+Graphics.update
+assert(Graphics.frame_stats.size == count, "no frames recorded while disabled")
+
+exit
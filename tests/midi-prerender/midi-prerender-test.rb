@@ -0,0 +1,58 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json,
+# with "midiPrerender" enabled and "midiSoundFont" set.
+#
+# Checks that a played midi file gets synthesized into the
+# MidiCache folder once, and that it plays from there after.
+
+def check(cond, desc)
+	System::puts((cond ? "Passed " : "FAILED ") + desc)
+end
+
+# Header written in front of the samples
+HEADER_SIZE = 48
+
+# Rendering happens on a worker thread, so wait for it
+def wait_for_entries(dir, count)
+	600.times do
+		entries = Dir.glob(dir + "/*.pcm")
+		return entries if entries.size >= count
+		Graphics.update
+	end
+	Dir.glob(dir + "/*.pcm")
+end
+
+dir = System.data_directory + "/MidiCache"
+check(File.directory?(dir), "cache folder exists")
+
+# Start from an empty cache
+Dir.glob(dir + "/*").each { |f| File.delete(f) }
+
+# The first play is synthesized live and queues the render
+Audio.bgm_play("Audio/BGM/arpeggio")
+entries = wait_for_entries(dir, 1)
+check(entries.size == 1, "first play renders an entry")
+
+# One second of 16 bit stereo at 44100 Hz, give or take the release
+size = entries.empty? ? 0 : File.size(entries[0])
+check(size > HEADER_SIZE + 44100 * 4, "entry holds the song")
+check(Dir.glob(dir + "/*.tmp").empty?, "no temporary files left")
+
+# Replaying streams the entry instead of rendering again
+Audio.bgm_stop
+Audio.bgm_play("Audio/BGM/arpeggio")
+60.times { Graphics.update }
+check(Dir.glob(dir + "/*.pcm").size == 1, "replay reuses the entry")
+check(File.size(entries[0]) == size, "replay leaves the entry alone") unless entries.empty?
+
+# Pitch doesn't take part in the key
+Audio.bgm_play("Audio/BGM/arpeggio", 100, 150)
+60.times { Graphics.update }
+check(Dir.glob(dir + "/*.pcm").size == 1, "pitch change reuses the entry")
+
+Audio.bgm_stop
+
+exit
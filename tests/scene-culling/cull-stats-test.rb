@@ -0,0 +1,75 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+#
+# Checks that elements outside the screen or their viewport are
+# culled, and that ones reaching into it are still drawn.
+
+def assert(cond, msg)
+	raise "Assertion failed: #{msg}" unless cond
+end
+
+def stats_after_update
+	Graphics.update
+	Graphics.cull_stats
+end
+
+bitmap = Bitmap.new(32, 32)
+bitmap.fill_rect(bitmap.rect, Color.new(255, 0, 0))
+
+def make_sprite(bitmap, x, y, viewport = nil)
+	s = Sprite.new(viewport)
+	s.bitmap = bitmap
+	s.x = x
+	s.y = y
+	s
+end
+
+base = stats_after_update
+
+on = make_sprite(bitmap, 10, 10)
+off = make_sprite(bitmap, -100, 10)
+edge = make_sprite(bitmap, -31, 10)
+far = make_sprite(bitmap, Graphics.width + 10, 10)
+
+stats = stats_after_update
+assert(stats[:drawn] == base[:drawn] + 2, "on screen and edge sprites drawn")
+assert(stats[:culled] == base[:culled] + 2, "off screen sprites culled")
+
+# Rotation and zoom move the bounds
+off.angle = 180
+off.x = 10
+off.zoom_x = 2
+stats = stats_after_update
+assert(stats[:culled] == base[:culled] + 1, "rotated sprite back on screen")
+
+# A wave can reach into the screen
+far.x = Graphics.width + 4
+far.wave_amp = 8
+stats = stats_after_update
+assert(stats[:culled] == base[:culled], "wave reaches into the screen")
+
+# Sprites outside their viewport, and viewports outside the screen
+viewport = Viewport.new(0, 0, 64, 64)
+inside = make_sprite(bitmap, 0, 0, viewport)
+outside = make_sprite(bitmap, 100, 0, viewport)
+
+stats = stats_after_update
+assert(stats[:culled] == base[:culled] + 1, "sprite outside viewport culled")
+
+viewport.rect.x = -200
+stats = stats_after_update
+assert(stats[:culled] == base[:culled] + 1, "viewport off screen culled as a whole")
+
+window = Window.new
+window.x = Graphics.width
+window.width = 64
+window.height = 64
+stats = stats_after_update
+assert(stats[:culled] == base[:culled] + 2, "window off screen culled")
+
+System::puts("\n\nCulling test passed: #{stats.inspect}\n\n")
+
+exit
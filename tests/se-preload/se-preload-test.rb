@@ -0,0 +1,67 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+#
+# Checks that Audio.se_preload decodes sounds into the cache
+# ahead of time, and that Audio.se_cache_stats reports it.
+
+def check(cond, desc)
+	System::puts((cond ? "Passed " : "FAILED ") + desc)
+end
+
+# Preloads decode on worker threads, so wait for the entry
+def wait_for_entries(count)
+	120.times do
+		stats = Audio.se_cache_stats
+		return stats if stats[:entries] >= count
+		Graphics.update
+	end
+	Audio.se_cache_stats
+end
+
+Audio.se_reset_cache_stats
+base = Audio.se_cache_stats
+
+check([:hits, :misses, :entries, :bytes, :limit].all? { |k| base.key?(k) }, "stats keys")
+check(base[:hits] == 0 && base[:misses] == 0, "reset stats")
+check(base[:limit] > 0, "cache limit")
+
+Audio.se_preload("Audio/SE/beep")
+stats = wait_for_entries(base[:entries] + 1)
+check(stats[:entries] == base[:entries] + 1, "preload adds an entry")
+check(stats[:bytes] > base[:bytes], "preload adds bytes")
+
+# Playing a preloaded sound is a cache hit
+Audio.se_play("Audio/SE/beep")
+stats = Audio.se_cache_stats
+check(stats[:hits] == 1, "play after preload hits")
+
+# Names may be nested in arrays; cached ones are skipped
+Audio.se_preload(["Audio/SE/beep"], "Audio/SE/beep")
+stats = wait_for_entries(base[:entries] + 2)
+check(stats[:entries] == base[:entries] + 1, "preload of cached sound")
+
+# Preloading a missing file only logs, playing it raises
+begin
+	Audio.se_preload("Audio/SE/does-not-exist")
+	check(true, "preload of missing file")
+rescue
+	check(false, "preload of missing file")
+end
+
+begin
+	Audio.se_play("Audio/SE/does-not-exist")
+	check(false, "play of missing file raises")
+rescue
+	check(true, "play of missing file raises")
+end
+
+Audio.se_reset_cache_stats
+stats = Audio.se_cache_stats
+check(stats[:hits] == 0 && stats[:entries] == base[:entries] + 1, "reset keeps entries")
+
+Audio.se_stop
+
+exit
@@ -0,0 +1,62 @@
+# Test suite for mkxp-z.
+# Copyright 2023-2024 Splendide Imaginarius.
+# License GPLv2+.
+#
+# Run the suite via the "customScript" field in mkxp.json.
+
+def check(cond, desc)
+	System::puts((cond ? "Passed " : "FAILED ") + desc)
+end
+
+t = Table.new(8, 8, 2)
+t.fill(3)
+check(t[7, 7, 1] == 3, "fill")
+
+for y in 0...8 do
+	for x in 0...8 do
+		t[x, y, 0] = y * 8 + x
+	end
+end
+
+# Overlapping copy within the same table
+t.copy_rect(1, 1, t, Rect.new(0, 0, 4, 4))
+check(t[1, 1] == 0 && t[4, 4] == 27 && t[5, 5] == 45, "copy_rect overlapping")
+
+# Clipped on every side
+u = Table.new(3, 3)
+u.copy_rect(-1, -1, t, Rect.new(0, 0, 10, 10))
+check(u[0, 0] == 0 && u[2, 2] == 18, "copy_rect clipped")
+
+data = t.raw_data
+check(data.bytesize == 8 * 8 * 2 * 2, "raw_data size")
+
+v = Table.new(8, 8, 2)
+v.raw_data = data
+check(v[4, 4] == 27 && v[7, 7, 1] == 3, "raw_data round trip")
+
+begin
+	v.raw_data = "abc"
+	check(false, "raw_data= size check")
+rescue
+	check(true, "raw_data= size check")
+end
+
+check(t[8, 0].nil? && t[0, -1].nil?, "out of bounds reads")
+
+# Element access speed, as in pathfinding loops
+map = Table.new(100, 100, 3)
+starttime = System.uptime
+
+for i in 1..20 do
+	for y in 0...100 do
+		for x in 0...100 do
+			map[x, y, 1] = map[x, y, 0] + map[x, y, 2]
+		end
+	end
+end
+
+endtime = System.uptime
+
+System::puts("\n\nTotal access time: %s\n\n" % [endtime - starttime])
+
+exit